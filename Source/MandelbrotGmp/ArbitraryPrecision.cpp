@@ -1,9 +1,33 @@
 #include "ArbitraryPrecision.hpp"
+#include <algorithm>
+#include <cstring>
+
+/// <summary>
+/// Sets the precision of a scratch register only if it differs, as changing
+/// it reallocates the mantissa.
+/// </summary>
+static void matchPrecision(mpf_t scratch, mp_bitcnt_t bits)
+{
+    if (mpf_get_prec(scratch) != bits)
+        mpf_set_prec(scratch, bits);
+}
+
+/// <summary>
+/// The precision a result of two operands is calculated at.
+/// </summary>
+static mp_bitcnt_t resultPrecision(const mpf_t a, const mpf_t b)
+{
+    return std::max(mpf_get_prec(a), mpf_get_prec(b));
+}
 
 /// <summary>
 /// Class wrapper around GNU Multi Precision (GMP)
 /// featuring operator overloads so that doubles and arbitrary precision
 /// numbers can be used interchangeably outside this class.
+/// Copying or moving a number, by construction or assignment, gives an
+/// identical number, precision included. Arithmetic is calculated at the
+/// greater precision of its operands, and compound assignment keeps the
+/// precision of the number assigned to. setPrecision() changes it.
 /// </summary>
 /// <param name="initialValue"></param>
 ArbitraryPrecision::ArbitraryPrecision(double initialValue)
@@ -18,18 +42,43 @@ ArbitraryPrecision::ArbitraryPrecision(double initialValue, unsigned long long b
     mpf_set_d(m_value, initialValue);
 }
 
+/// <summary>
+/// Parses a decimal number, such as one given on the command line, which
+/// may have more digits than a double can hold.
+/// Text which is not a number gives 0.
+/// </summary>
+ArbitraryPrecision::ArbitraryPrecision(const char* decimal, unsigned long long bits)
+{
+    mpf_init2(m_value, bits);
+
+    if (mpf_set_str(m_value, decimal, 10) != 0)
+        mpf_set_ui(m_value, 0);
+}
+
 ArbitraryPrecision::ArbitraryPrecision(const ArbitraryPrecision& copy)
 {
-    mpf_init(m_value);
+    mpf_init2(m_value, mpf_get_prec(copy.m_value));
     mpf_set(m_value, copy.m_value);
 }
 
+/// <summary>
+/// Takes the mantissa of a temporary rather than allocating a new one.
+/// The moved from number has no mantissa and may only be destroyed or
+/// assigned to.
+/// </summary>
+ArbitraryPrecision::ArbitraryPrecision(ArbitraryPrecision&& other) noexcept
+{
+    m_value[0] = other.m_value[0];
+    other.m_value->_mp_d = nullptr;
+}
+
 ArbitraryPrecision::~ArbitraryPrecision()
 {
-    mpf_clear(m_value);
+    if (m_value->_mp_d != nullptr)
+        mpf_clear(m_value);
 }
 
-unsigned long long ArbitraryPrecision::getPrecision()
+unsigned long long ArbitraryPrecision::getPrecision() const
 {
     return mpf_get_prec(m_value);
 }
@@ -39,47 +88,78 @@ void ArbitraryPrecision::setPrecision(unsigned long long bits)
     mpf_set_prec(m_value, bits);
 }
 
+/// <summary>
+/// Takes the value and precision of another number, like the copy
+/// constructor, only reallocating the mantissa if the precision differs.
+/// </summary>
 ArbitraryPrecision& ArbitraryPrecision::operator=(const ArbitraryPrecision& rhs)
 {
     if (this == &rhs)
         return *this;
 
+    if (m_value->_mp_d == nullptr)
+        mpf_init2(m_value, mpf_get_prec(rhs.m_value));
+    else
+        matchPrecision(m_value, mpf_get_prec(rhs.m_value));
+
     mpf_set(m_value, rhs.m_value);
 
     return *this;
 }
 
+/// <summary>
+/// Swaps mantissas with a temporary, which then frees the old one, so the
+/// precision is the temporary's, as for copy assignment.
+/// A moved from number can be assigned to, as it is given a new mantissa.
+/// </summary>
+ArbitraryPrecision& ArbitraryPrecision::operator=(ArbitraryPrecision&& rhs) noexcept
+{
+    if (this == &rhs)
+        return *this;
+
+    if (m_value->_mp_d == nullptr)
+    {
+        m_value[0] = rhs.m_value[0];
+        rhs.m_value->_mp_d = nullptr;
+        return *this;
+    }
+
+    mpf_swap(m_value, rhs.m_value);
+
+    return *this;
+}
+
 ArbitraryPrecision ArbitraryPrecision::operator-() const
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, mpf_get_prec(m_value));
     mpf_neg(result.m_value, this->m_value);
     return result;
 }
 
 ArbitraryPrecision operator+(const ArbitraryPrecision& a, const ArbitraryPrecision& b)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, resultPrecision(a.m_value, b.m_value));
     mpf_add(result.m_value, a.m_value, b.m_value);
     return result;
 }
 
 ArbitraryPrecision operator-(const ArbitraryPrecision& a, const ArbitraryPrecision & b)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, resultPrecision(a.m_value, b.m_value));
     mpf_sub(result.m_value, a.m_value, b.m_value);
     return result;
 }
 
 ArbitraryPrecision operator*(const ArbitraryPrecision& a, const ArbitraryPrecision& b)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, resultPrecision(a.m_value, b.m_value));
     mpf_mul(result.m_value, a.m_value, b.m_value);
     return result;
 }
 
 ArbitraryPrecision operator/(const ArbitraryPrecision& a, const ArbitraryPrecision& b)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, resultPrecision(a.m_value, b.m_value));
     mpf_div(result.m_value, a.m_value, b.m_value);
     return result;
 }
@@ -188,16 +268,143 @@ ArbitraryPrecision::operator int() const
     return static_cast<int>(mpf_get_si(this->m_value));
 }
 
+/// <summary>
+/// Formats the number as [-]0.mantissa@exponent, where the exponent is in
+/// the given base, like mpf_out_str.
+/// </summary>
+/// <param name="base">Base of the digits, from 2 to 62</param>
+/// <param name="digits">Maximum number of significant digits, or 0 for
+/// every digit of the mantissa, including the guard limb beyond the
+/// precision, so that fromString() reads back exactly the same number</param>
+/// <returns>Text of the number</returns>
+std::string ArbitraryPrecision::toString(int base, size_t digits) const
+{
+    // GMP only writes the digits the precision promises, so the mantissa is
+    // copied to a number whose precision covers every limb of it
+    if (digits == 0)
+    {
+        const mp_bitcnt_t bits = static_cast<mp_bitcnt_t>(std::abs(m_value->_mp_size) + 1) * GMP_NUMB_BITS;
+        ArbitraryPrecision exact(0.0, bits);
+        mpf_set(exact.m_value, m_value);
+        return exact.toString(base, static_cast<size_t>(bits) + 2);
+    }
+
+    mp_exp_t exponent;
+    char* mantissa = mpf_get_str(nullptr, &exponent, base, digits, m_value);
+
+    std::string text(mantissa);
+    const bool isNegative = !text.empty() && text[0] == '-';
+    if (isNegative)
+        text.erase(0, 1);
+
+    text = (isNegative ? "-0." : "0.") + text + "@" + std::to_string(exponent);
+
+    // The digits were allocated by GMP, so must be freed by it
+    void (*freeFunction)(void*, size_t);
+    mp_get_memory_functions(nullptr, nullptr, &freeFunction);
+    freeFunction(mantissa, strlen(mantissa) + 1);
+
+    return text;
+}
+
+/// <summary>
+/// Parses a number formatted by toString(), at the current precision, so a
+/// number written with every digit reads back exactly if the precision is
+/// enough for all of its digits.
+/// </summary>
+/// <param name="text">Text of the number, with the exponent in decimal</param>
+/// <param name="base">Base of the digits, from 2 to 62</param>
+/// <returns>True if the text was a number, otherwise the number is
+/// unchanged</returns>
+bool ArbitraryPrecision::fromString(const std::string& text, int base)
+{
+    // A negative base reads the exponent in decimal, as toString writes it
+    return mpf_set_str(m_value, text.c_str(), -base) == 0;
+}
+
 ArbitraryPrecision abs(const ArbitraryPrecision& a)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, mpf_get_prec(a.m_value));
     mpf_abs(result.m_value, a.m_value);
     return result;
 }
 
 ArbitraryPrecision pow(const ArbitraryPrecision& base, unsigned long power)
 {
-    ArbitraryPrecision result;
+    ArbitraryPrecision result(0.0, mpf_get_prec(base.m_value));
     mpf_pow_ui(result.m_value, base.m_value, power);
     return result;
 }
+
+/// <summary>
+/// Iterates the complex number x + yi with the Mandelbrot Set function
+/// z := z^2 + c in place. Intermediate values are held in registers owned
+/// by the calling thread, so no memory is allocated once they have grown to
+/// the operands' precision.
+/// </summary>
+/// <param name="x">Real part of z, overwritten</param>
+/// <param name="y">Imaginary part of z, overwritten</param>
+/// <param name="cx">Real part of c</param>
+/// <param name="cy">Imaginary part of c</param>
+void squareAdd(ArbitraryPrecision& x, ArbitraryPrecision& y,
+               const ArbitraryPrecision& cx, const ArbitraryPrecision& cy)
+{
+    thread_local ArbitraryPrecision xx;
+    thread_local ArbitraryPrecision yy;
+
+    const mp_bitcnt_t bits = resultPrecision(x.m_value, y.m_value);
+    matchPrecision(xx.m_value, bits);
+    matchPrecision(yy.m_value, bits);
+
+    mpf_mul(xx.m_value, x.m_value, x.m_value);
+    mpf_mul(yy.m_value, y.m_value, y.m_value);
+
+    // y := 2xy + cy
+    mpf_mul(y.m_value, x.m_value, y.m_value);
+    mpf_mul_2exp(y.m_value, y.m_value, 1);
+    mpf_add(y.m_value, y.m_value, cy.m_value);
+
+    // x := x^2 - y^2 + cx
+    mpf_sub(x.m_value, xx.m_value, yy.m_value);
+    mpf_add(x.m_value, x.m_value, cx.m_value);
+}
+
+/// <summary>
+/// Calculates x^2 + y^2 without allocating, rounded to a double.
+/// </summary>
+double normSquared(const ArbitraryPrecision& x, const ArbitraryPrecision& y)
+{
+    thread_local ArbitraryPrecision xx;
+    thread_local ArbitraryPrecision yy;
+
+    const mp_bitcnt_t bits = resultPrecision(x.m_value, y.m_value);
+    matchPrecision(xx.m_value, bits);
+    matchPrecision(yy.m_value, bits);
+
+    mpf_mul(xx.m_value, x.m_value, x.m_value);
+    mpf_mul(yy.m_value, y.m_value, y.m_value);
+    mpf_add(xx.m_value, xx.m_value, yy.m_value);
+
+    return mpf_get_d(xx.m_value);
+}
+
+/// <summary>
+/// Calculates the squared distance between two complex numbers without
+/// allocating, rounded to a double.
+/// </summary>
+double distanceSquared(const ArbitraryPrecision& x1, const ArbitraryPrecision& y1,
+                       const ArbitraryPrecision& x2, const ArbitraryPrecision& y2)
+{
+    thread_local ArbitraryPrecision dx;
+    thread_local ArbitraryPrecision dy;
+
+    const mp_bitcnt_t bits = std::max(resultPrecision(x1.m_value, y1.m_value),
+                                      resultPrecision(x2.m_value, y2.m_value));
+    matchPrecision(dx.m_value, bits);
+    matchPrecision(dy.m_value, bits);
+
+    mpf_sub(dx.m_value, x1.m_value, x2.m_value);
+    mpf_sub(dy.m_value, y1.m_value, y2.m_value);
+
+    return normSquared(dx, dy);
+}
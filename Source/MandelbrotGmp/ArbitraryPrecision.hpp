@@ -1,18 +1,22 @@
 #pragma once
 
 #include <gmp.h>
+#include <string>
 
 class ArbitraryPrecision
 {
 public:
     ArbitraryPrecision(double initialValue = 0);
     ArbitraryPrecision(double initialValue, unsigned long long bits);
+    ArbitraryPrecision(const char* decimal, unsigned long long bits);
     ArbitraryPrecision(const ArbitraryPrecision& copy);
+    ArbitraryPrecision(ArbitraryPrecision&& other) noexcept;
     ~ArbitraryPrecision();
 
-    unsigned long long getPrecision();
+    unsigned long long getPrecision() const;
     void setPrecision(unsigned long long bits);
     ArbitraryPrecision& operator=(const ArbitraryPrecision& rhs);
+    ArbitraryPrecision& operator=(ArbitraryPrecision&& rhs) noexcept;
     ArbitraryPrecision operator-() const;
     friend ArbitraryPrecision operator+(const ArbitraryPrecision& a, const ArbitraryPrecision& b);
     friend ArbitraryPrecision operator-(const ArbitraryPrecision& a, const ArbitraryPrecision& b);
@@ -38,8 +42,15 @@ public:
     explicit operator float() const;
     explicit operator long() const;
     explicit operator int() const;
+    std::string toString(int base, size_t digits) const;
+    bool fromString(const std::string& text, int base);
     friend ArbitraryPrecision abs(const ArbitraryPrecision& a);
     friend ArbitraryPrecision pow(const ArbitraryPrecision& base, unsigned long power);
+    friend void squareAdd(ArbitraryPrecision& x, ArbitraryPrecision& y,
+                          const ArbitraryPrecision& cx, const ArbitraryPrecision& cy);
+    friend double normSquared(const ArbitraryPrecision& x, const ArbitraryPrecision& y);
+    friend double distanceSquared(const ArbitraryPrecision& x1, const ArbitraryPrecision& y1,
+                                  const ArbitraryPrecision& x2, const ArbitraryPrecision& y2);
 
 private:
     mpf_t m_value;
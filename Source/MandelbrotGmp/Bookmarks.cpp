@@ -0,0 +1,170 @@
+#include "Bookmarks.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static const char HEADER[] = "# Mandelbrot bookmarks 1";
+
+
+/// <summary>
+/// Constructs the bookmarks kept in a file, loading any already saved.
+/// Each line of the file is a slot, from 1, then the iteration limit, which
+/// is 0 if it was chosen automatically, then the view from
+/// View::serialise(), so that a bookmarked location is exactly restored
+/// however deep it is. The file can also be written by hand, or given to
+/// the headless renderer to render a bookmark.
+/// </summary>
+/// <param name="path">The file of bookmarks, created when one is set</param>
+Bookmarks::Bookmarks(const std::string& path) : m_path(path)
+{
+    load();
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Bookmarks::~Bookmarks() {}
+
+
+/// <summary>
+/// Gets a bookmark.
+/// </summary>
+/// <param name="slot">The slot, from 1 to SLOT_COUNT</param>
+/// <param name="view">Set to the bookmarked view</param>
+/// <param name="maxIterations">Set to the iteration limit, or
+/// MandelbrotEngine::AUTO_ITERATIONS if it was chosen automatically</param>
+/// <returns>True if the slot has a bookmark</returns>
+bool Bookmarks::get(int slot, View& view, int& maxIterations) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (slot < 1 || slot > SLOT_COUNT || !m_bookmarks[slot - 1].isSet)
+        return false;
+
+    view = m_bookmarks[slot - 1].view;
+    maxIterations = m_bookmarks[slot - 1].maxIterations;
+    return true;
+}
+
+/// <summary>
+/// Bookmarks a view, replacing any bookmark in the slot, and saves the file.
+/// </summary>
+/// <param name="slot">The slot, from 1 to SLOT_COUNT</param>
+/// <param name="view">The view</param>
+/// <param name="maxIterations">The iteration limit, or
+/// MandelbrotEngine::AUTO_ITERATIONS if it is chosen automatically</param>
+/// <returns>True if the slot was valid and the file was saved</returns>
+bool Bookmarks::set(int slot, const View& view, int maxIterations)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (slot < 1 || slot > SLOT_COUNT)
+        return false;
+
+    m_bookmarks[slot - 1].isSet = true;
+    m_bookmarks[slot - 1].view = view;
+    m_bookmarks[slot - 1].maxIterations = maxIterations;
+    return save();
+}
+
+
+/// <summary>
+/// Formats a bookmark as a line of the file, without a newline.
+/// </summary>
+/// <param name="slot">The slot</param>
+/// <param name="view">The view</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <returns>The line</returns>
+std::string Bookmarks::format(int slot, const View& view, int maxIterations)
+{
+    return std::to_string(slot) + " " + std::to_string(maxIterations) + " " + view.serialise();
+}
+
+/// <summary>
+/// Parses a line of the file written by format().
+/// </summary>
+/// <param name="line">The line</param>
+/// <param name="slot">Set to the slot</param>
+/// <param name="view">Set to the view</param>
+/// <param name="maxIterations">Set to the iteration limit</param>
+/// <returns>True if the line was a bookmark</returns>
+bool Bookmarks::parse(const std::string& line, int& slot, View& view, int& maxIterations)
+{
+    std::istringstream in(line);
+    std::string rest;
+
+    if (!(in >> slot >> maxIterations) || slot < 1 || slot > SLOT_COUNT || maxIterations < 0)
+        return false;
+
+    std::getline(in, rest);
+    return view.deserialise(rest);
+}
+
+
+/// <summary>
+/// Loads the bookmarks from the file, if it exists. Comments, starting with
+/// #, and lines which are not bookmarks are skipped.
+/// </summary>
+void Bookmarks::load()
+{
+    std::ifstream file(m_path);
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        int slot, maxIterations;
+        View view;
+
+        if (line.empty() || line[0] == '#' || !parse(line, slot, view, maxIterations))
+            continue;
+
+        m_bookmarks[slot - 1].isSet = true;
+        m_bookmarks[slot - 1].view = view;
+        m_bookmarks[slot - 1].maxIterations = maxIterations;
+    }
+}
+
+/// <summary>
+/// Saves every bookmark to the file, writing a temporary file first so that
+/// the bookmarks are not lost if it cannot be written. The temporary file
+/// then replaces the file in one step, so the file is never missing, and if
+/// that fails both are left as they are.
+/// </summary>
+/// <returns>True if saved</returns>
+bool Bookmarks::save() const
+{
+    const std::string temporary = m_path + ".tmp";
+
+    {
+        std::ofstream file(temporary);
+        file << HEADER << "\n";
+
+        for (int slot = 1; slot <= SLOT_COUNT; ++slot)
+        {
+            const Bookmark& bookmark = m_bookmarks[slot - 1];
+            if (bookmark.isSet)
+                file << format(slot, bookmark.view, bookmark.maxIterations) << "\n";
+        }
+
+        if (!file.good())
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    // Renaming over an existing file fails on Windows, which replaces it
+    // with MoveFileEx instead
+#ifdef _WIN32
+    return MoveFileExA(temporary.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(temporary.c_str(), m_path.c_str()) == 0;
+#endif
+}
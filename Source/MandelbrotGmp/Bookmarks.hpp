@@ -0,0 +1,35 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include "View.hpp"
+
+class Bookmarks
+{
+public:
+    static constexpr int SLOT_COUNT = 9;
+
+    Bookmarks(const std::string& path);
+    ~Bookmarks();
+
+    bool get(int slot, View& view, int& maxIterations) const;
+    bool set(int slot, const View& view, int maxIterations);
+
+    static std::string format(int slot, const View& view, int maxIterations);
+    static bool parse(const std::string& line, int& slot, View& view, int& maxIterations);
+
+private:
+    struct Bookmark
+    {
+        bool isSet = false;
+        View view;
+        int maxIterations = 0;
+    };
+
+    std::string m_path;
+    mutable std::mutex m_mutex;
+    Bookmark m_bookmarks[SLOT_COUNT];
+
+    void load();
+    bool save() const;
+};
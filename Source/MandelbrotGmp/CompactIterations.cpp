@@ -0,0 +1,315 @@
+#include "CompactIterations.hpp"
+#include "MandelbrotEngine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+/// <summary>
+/// Constructs an empty block, with no counts.
+/// </summary>
+CompactIterations::CompactIterations() {}
+
+/// <summary>
+/// Encodes a block of iteration counts in about half the memory of floats
+/// or less, for keeping renders which are not being displayed.
+/// Counts are quantised to 16 bit steps above the lowest count of the
+/// block, of 1/256 of an iteration, or coarser by powers of two if the block
+/// spans more than 255 iterations, then run length encoded. The highest
+/// count, which is that of the interior when the block contains any, is
+/// kept exactly, as are unrendered pixels. A block whose counts span too
+/// many iterations for whole steps is kept as floats instead. Whole counts,
+/// which are all the engine renders, are therefore always kept exactly.
+/// </summary>
+/// <param name="iterations">The top left count of the block in the buffer</param>
+/// <param name="width">The width of the block</param>
+/// <param name="height">The height of the block</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+CompactIterations::CompactIterations(const float* iterations, int width, int height, int stride) :
+    m_width(width),
+    m_height(height)
+{
+    encode(iterations, stride);
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+CompactIterations::~CompactIterations() {}
+
+
+/// <summary>
+/// Getter for width.
+/// </summary>
+/// <returns>The width of the block</returns>
+int CompactIterations::getWidth() const { return m_width; }
+
+/// <summary>
+/// Getter for height.
+/// </summary>
+/// <returns>The height of the block</returns>
+int CompactIterations::getHeight() const { return m_height; }
+
+/// <summary>
+/// Getter for the size of the encoding.
+/// </summary>
+/// <returns>The number of bytes getData() points to</returns>
+size_t CompactIterations::getSizeBytes() const { return m_data.size(); }
+
+/// <summary>
+/// Getter for the encoding, so it can be written out and decoded later
+/// with the static decode().
+/// </summary>
+/// <returns>The encoded block</returns>
+const std::uint8_t* CompactIterations::getData() const { return m_data.data(); }
+
+
+/// <summary>
+/// Decodes the block into a buffer of iteration counts.
+/// </summary>
+/// <param name="iterations">Where the top left count of the block goes in
+/// the buffer</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+/// <returns>False if the block is empty</returns>
+bool CompactIterations::decode(float* iterations, int stride) const
+{
+    return decode(m_data.data(), m_data.size(), m_width, m_height, iterations, stride);
+}
+
+/// <summary>
+/// Decodes a block encoded by the constructor into a buffer of iteration
+/// counts. The encoding is checked throughout, as it may have been read back
+/// from a file.
+/// </summary>
+/// <param name="data">The encoding, from getData()</param>
+/// <param name="size">The size of the encoding in bytes</param>
+/// <param name="width">The width the block must have</param>
+/// <param name="height">The height the block must have</param>
+/// <param name="iterations">Where the top left count of the block goes in
+/// the buffer</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+/// <returns>True if the encoding was valid and of the given size, otherwise
+/// the buffer may be partly written</returns>
+bool CompactIterations::decode(const std::uint8_t* data, size_t size, int width, int height,
+                               float* iterations, int stride)
+{
+    Header header;
+    if (size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if (header.width != static_cast<std::uint32_t>(width) || header.height != static_cast<std::uint32_t>(height))
+        return false;
+
+    data += sizeof(header);
+    size -= sizeof(header);
+
+    const size_t count = static_cast<size_t>(width) * height;
+
+    if (header.fractionBits < 0)
+    {
+        if (size != count * sizeof(float))
+            return false;
+
+        for (int y = 0; y < height; ++y)
+            memcpy(iterations + static_cast<size_t>(y) * stride, data + y * width * sizeof(float), width * sizeof(float));
+
+        return true;
+    }
+
+    const float step = ldexp(1.0f, -header.fractionBits);
+    const size_t wordCount = size / sizeof(std::uint16_t);
+    if (size % sizeof(std::uint16_t) != 0)
+        return false;
+
+    auto word = [data](size_t i)
+    {
+        std::uint16_t w;
+        memcpy(&w, data + i * sizeof(w), sizeof(w));
+        return w;
+    };
+
+    auto value = [&header, step](std::uint16_t code)
+    {
+        return code == UNRENDERED_CODE ? MandelbrotEngine::UNRENDERED :
+               code == HIGHEST_CODE ? header.highest :
+               header.base + code * step;
+    };
+
+    size_t written = 0;
+    int x = 0;
+    int y = 0;
+    auto put = [&](float v)
+    {
+        iterations[static_cast<size_t>(y) * stride + x] = v;
+        ++written;
+
+        if (++x == width)
+        {
+            x = 0;
+            ++y;
+        }
+    };
+
+    for (size_t i = 0; i < wordCount;)
+    {
+        const std::uint16_t control = word(i++);
+        const size_t length = control & MAX_CHUNK;
+
+        if (control & RUN_FLAG)
+        {
+            if (i >= wordCount || length > count - written)
+                return false;
+
+            const float v = value(word(i++));
+            for (size_t n = 0; n < length; ++n)
+                put(v);
+        }
+        else
+        {
+            if (length > wordCount - i || length > count - written)
+                return false;
+
+            for (size_t n = 0; n < length; ++n)
+                put(value(word(i++)));
+        }
+    }
+
+    return written == count;
+}
+
+
+/// <summary>
+/// Quantises and run length encodes the counts into m_data, after a header.
+/// Runs of three or more equal codes are stored as a control word with
+/// RUN_FLAG set and the code, and other codes as a control word holding
+/// how many follow as they are, like PackBits.
+/// </summary>
+/// <param name="iterations">The top left count of the block in the buffer</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+void CompactIterations::encode(const float* iterations, int stride)
+{
+    Header header;
+    header.width = static_cast<std::uint32_t>(m_width);
+    header.height = static_cast<std::uint32_t>(m_height);
+    header.base = 0.0f;
+    header.highest = 0.0f;
+    header.fractionBits = 0;
+
+    bool isRendered = false;
+    for (int y = 0; y < m_height; ++y)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            const float v = iterations[static_cast<size_t>(y) * stride + x];
+            if (v >= 0.0f)
+            {
+                header.highest = isRendered ? std::max(header.highest, v) : v;
+                isRendered = true;
+            }
+        }
+    }
+
+    // The rest of the counts are steps above the lowest whole iteration
+    float lowest = header.highest;
+    float highestStep = 0.0f;
+    for (int y = 0; y < m_height; ++y)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            const float v = iterations[static_cast<size_t>(y) * stride + x];
+            if (v >= 0.0f && v < header.highest)
+            {
+                lowest = std::min(lowest, v);
+                highestStep = std::max(highestStep, v);
+            }
+        }
+    }
+
+    header.base = floor(lowest);
+    const double range = highestStep > header.base ? highestStep - header.base : 0.0;
+
+    m_data.resize(sizeof(header));
+
+    if (range > MAX_STEP_CODE)
+    {
+        header.fractionBits = -1;
+        memcpy(m_data.data(), &header, sizeof(header));
+
+        for (int y = 0; y < m_height; ++y)
+        {
+            const std::uint8_t* row = reinterpret_cast<const std::uint8_t*>(iterations + static_cast<size_t>(y) * stride);
+            m_data.insert(m_data.end(), row, row + m_width * sizeof(float));
+        }
+
+        return;
+    }
+
+    header.fractionBits = MAX_FRACTION_BITS;
+    while (header.fractionBits > 0 && ldexp(range, header.fractionBits) > MAX_STEP_CODE)
+        --header.fractionBits;
+
+    memcpy(m_data.data(), &header, sizeof(header));
+
+    const double scale = ldexp(1.0, header.fractionBits);
+    std::vector<std::uint16_t> codes;
+    codes.reserve(static_cast<size_t>(m_width) * m_height);
+
+    for (int y = 0; y < m_height; ++y)
+    {
+        for (int x = 0; x < m_width; ++x)
+        {
+            const float v = iterations[static_cast<size_t>(y) * stride + x];
+            codes.push_back(v < 0.0f ? UNRENDERED_CODE :
+                            v >= header.highest ? HIGHEST_CODE :
+                            static_cast<std::uint16_t>(std::min<double>(floor((v - header.base) * scale + 0.5), MAX_STEP_CODE)));
+        }
+    }
+
+    // Runs may continue across rows, as the interior often spans several
+    std::vector<std::uint16_t> words;
+    size_t literalStart = 0;
+    size_t literalCount = 0;
+
+    auto flushLiterals = [&]()
+    {
+        if (literalCount == 0)
+            return;
+
+        words.push_back(static_cast<std::uint16_t>(literalCount));
+        words.insert(words.end(), codes.begin() + literalStart, codes.begin() + literalStart + literalCount);
+        literalCount = 0;
+    };
+
+    for (size_t i = 0; i < codes.size();)
+    {
+        size_t run = 1;
+        while (i + run < codes.size() && run < MAX_CHUNK && codes[i + run] == codes[i])
+            ++run;
+
+        if (run >= 3)
+        {
+            flushLiterals();
+            words.push_back(static_cast<std::uint16_t>(RUN_FLAG | run));
+            words.push_back(codes[i]);
+            i += run;
+            continue;
+        }
+
+        for (size_t n = 0; n < run; ++n, ++i)
+        {
+            if (literalCount == MAX_CHUNK)
+                flushLiterals();
+
+            if (literalCount == 0)
+                literalStart = i;
+
+            ++literalCount;
+        }
+    }
+
+    flushLiterals();
+
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(words.data());
+    m_data.insert(m_data.end(), bytes, bytes + words.size() * sizeof(std::uint16_t));
+}
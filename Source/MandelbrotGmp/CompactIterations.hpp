@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CompactIterations
+{
+public:
+    static constexpr int MAX_FRACTION_BITS = 8;
+
+    CompactIterations();
+    CompactIterations(const float* iterations, int width, int height, int stride);
+    ~CompactIterations();
+
+    int getWidth() const;
+    int getHeight() const;
+    size_t getSizeBytes() const;
+    const std::uint8_t* getData() const;
+    bool decode(float* iterations, int stride) const;
+    static bool decode(const std::uint8_t* data, size_t size, int width, int height, float* iterations, int stride);
+
+private:
+    static constexpr std::uint16_t UNRENDERED_CODE = 0xFFFF;
+    static constexpr std::uint16_t HIGHEST_CODE = 0xFFFE;
+    static constexpr std::uint16_t MAX_STEP_CODE = 0xFFFD;
+    static constexpr std::uint16_t RUN_FLAG = 0x8000;
+    static constexpr int MAX_CHUNK = 0x7FFF;
+
+    struct Header
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        float base;
+        float highest;
+        std::int32_t fractionBits;
+    };
+
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<std::uint8_t> m_data;
+
+    void encode(const float* iterations, int stride);
+};
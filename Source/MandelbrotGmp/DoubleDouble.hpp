@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cmath>
+#include "ErrorFreeTransforms.hpp"
+
+/// <summary>
+/// A number held as the unevaluated sum of two doubles, giving 106 bits of
+/// mantissa with the exponent range of a double. It has the same operations
+/// as ArbitraryPrecision, so can be iterated in its place at depths it is
+/// precise enough for, where it is an order of magnitude faster than GMP.
+/// Everything is inline, as each operation is only a few instructions.
+/// The algorithms are those of the QD library by Hida, Li and Bailey.
+/// </summary>
+class DoubleDouble
+{
+public:
+    static constexpr unsigned long long PRECISION = 106;
+
+    DoubleDouble(double initialValue = 0) : m_high(initialValue), m_low(0.0) {}
+    DoubleDouble(double initialValue, unsigned long long) : m_high(initialValue), m_low(0.0) {}
+    DoubleDouble(const char* decimal, unsigned long long) : DoubleDouble(parseDecimal<DoubleDouble>(decimal)) {}
+
+    /// <summary>
+    /// Rounds a number of greater precision, such as an ArbitraryPrecision,
+    /// by peeling off one double at a time.
+    /// </summary>
+    template <typename T>
+    static DoubleDouble split(const T& value)
+    {
+        T remainder(value);
+        DoubleDouble result;
+
+        for (int i = 0; i < 2; ++i)
+        {
+            const double part = static_cast<double>(remainder);
+            result += part;
+            remainder -= T(part);
+        }
+
+        return result;
+    }
+
+    unsigned long long getPrecision() const { return PRECISION; }
+    void setPrecision(unsigned long long) {}
+
+    DoubleDouble operator-() const { return DoubleDouble(-m_high, -m_low, true); }
+
+    friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        double s2, t2;
+        double s1 = twoSum(a.m_high, b.m_high, s2);
+        const double t1 = twoSum(a.m_low, b.m_low, t2);
+        s2 += t1;
+        s1 = quickTwoSum(s1, s2, s2);
+        s2 += t2;
+        s1 = quickTwoSum(s1, s2, s2);
+        return DoubleDouble(s1, s2, true);
+    }
+
+    friend DoubleDouble operator+(const DoubleDouble& a, double b)
+    {
+        double s2;
+        double s1 = twoSum(a.m_high, b, s2);
+        s2 += a.m_low;
+        s1 = quickTwoSum(s1, s2, s2);
+        return DoubleDouble(s1, s2, true);
+    }
+
+    friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) { return a + -b; }
+
+    friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        double p2;
+        double p1 = twoProduct(a.m_high, b.m_high, p2);
+        p2 += a.m_high * b.m_low + a.m_low * b.m_high;
+        p1 = quickTwoSum(p1, p2, p2);
+        return DoubleDouble(p1, p2, true);
+    }
+
+    friend DoubleDouble operator*(const DoubleDouble& a, double b)
+    {
+        double p2;
+        double p1 = twoProduct(a.m_high, b, p2);
+        p2 += a.m_low * b;
+        p1 = quickTwoSum(p1, p2, p2);
+        return DoubleDouble(p1, p2, true);
+    }
+
+    /// <summary>
+    /// Long division, refining the quotient of the high parts twice.
+    /// </summary>
+    friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        double q1 = a.m_high / b.m_high;
+        DoubleDouble r = a - b * q1;
+        double q2 = r.m_high / b.m_high;
+        r -= b * q2;
+        const double q3 = r.m_high / b.m_high;
+        q1 = quickTwoSum(q1, q2, q2);
+        return DoubleDouble(q1, q2, true) + q3;
+    }
+
+    DoubleDouble& operator+=(const DoubleDouble& b) { return *this = *this + b; }
+    DoubleDouble& operator-=(const DoubleDouble& b) { return *this = *this - b; }
+    DoubleDouble& operator*=(const DoubleDouble& b) { return *this = *this * b; }
+    DoubleDouble& operator/=(const DoubleDouble& b) { return *this = *this / b; }
+
+    friend bool operator>(const DoubleDouble& a, const DoubleDouble& b)
+    {
+        return a.m_high > b.m_high || (a.m_high == b.m_high && a.m_low > b.m_low);
+    }
+
+    friend bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return b > a; }
+    friend bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(b > a); }
+    friend bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(a > b); }
+    friend bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.m_high == b.m_high && a.m_low == b.m_low; }
+    friend bool operator!=(const DoubleDouble& a, const DoubleDouble& b) { return !(a == b); }
+    friend bool operator>(const DoubleDouble& a, const double b) { return a > DoubleDouble(b); }
+    friend bool operator<(const DoubleDouble& a, const double b) { return a < DoubleDouble(b); }
+    friend bool operator>=(const DoubleDouble& a, const double b) { return a >= DoubleDouble(b); }
+    friend bool operator<=(const DoubleDouble& a, const double b) { return a <= DoubleDouble(b); }
+    friend bool operator==(const DoubleDouble& a, const double b) { return a == DoubleDouble(b); }
+    friend bool operator!=(const DoubleDouble& a, const double b) { return a != DoubleDouble(b); }
+
+    explicit operator double() const { return m_high; }
+    explicit operator float() const { return static_cast<float>(m_high); }
+    explicit operator int() const { return static_cast<int>(static_cast<long>(*this)); }
+
+    /// <summary>
+    /// Truncates towards zero, like mpf_get_si, including when the high part
+    /// is whole and the low part takes the number just below it.
+    /// </summary>
+    explicit operator long() const
+    {
+        const double whole = std::trunc(m_high);
+        if (whole == m_high && m_high > 0 && m_low < 0)
+            return static_cast<long>(whole) - 1;
+        if (whole == m_high && m_high < 0 && m_low > 0)
+            return static_cast<long>(whole) + 1;
+        return static_cast<long>(whole);
+    }
+
+    friend DoubleDouble abs(const DoubleDouble& a) { return a.m_high < 0 ? -a : a; }
+
+    friend DoubleDouble pow(const DoubleDouble& base, unsigned long power)
+    {
+        DoubleDouble result = 1.0;
+        DoubleDouble square = base;
+
+        for (; power != 0; power >>= 1)
+        {
+            if (power & 1)
+                result *= square;
+            square = sqr(square);
+        }
+
+        return result;
+    }
+
+    /// <summary>
+    /// z := z^2 + c, the same as for ArbitraryPrecision.
+    /// </summary>
+    friend void squareAdd(DoubleDouble& x, DoubleDouble& y, const DoubleDouble& cx, const DoubleDouble& cy)
+    {
+        const DoubleDouble xx = sqr(x);
+        const DoubleDouble yy = sqr(y);
+        y = x * y * 2.0 + cy;
+        x = xx - yy + cx;
+    }
+
+    /// <summary>
+    /// x^2 + y^2 rounded to a double, for which the high parts suffice.
+    /// </summary>
+    friend double normSquared(const DoubleDouble& x, const DoubleDouble& y)
+    {
+        return x.m_high * x.m_high + y.m_high * y.m_high;
+    }
+
+    /// <summary>
+    /// The squared distance between two complex numbers rounded to a double,
+    /// whose differences must be taken in full as the numbers may be close.
+    /// </summary>
+    friend double distanceSquared(const DoubleDouble& x1, const DoubleDouble& y1,
+                                  const DoubleDouble& x2, const DoubleDouble& y2)
+    {
+        return normSquared(x1 - x2, y1 - y2);
+    }
+
+private:
+    double m_high;
+    double m_low;
+
+    DoubleDouble(double high, double low, bool) : m_high(high), m_low(low) {}
+
+    friend DoubleDouble sqr(const DoubleDouble& a)
+    {
+        double p2;
+        double p1 = twoProduct(a.m_high, a.m_high, p2);
+        p2 += 2.0 * a.m_high * a.m_low;
+        p2 += a.m_low * a.m_low;
+        p1 = quickTwoSum(p1, p2, p2);
+        return DoubleDouble(p1, p2, true);
+    }
+};
@@ -0,0 +1,170 @@
+#include "EdgeSamples.hpp"
+#include "MandelbrotEngine.hpp"
+#include <cmath>
+
+
+/// <summary>
+/// The extra samples of the pixels which lie on edges in a rendered
+/// iteration buffer, for anti-aliasing.
+/// Only the pixels whose iteration counts differ from a neighbour's are
+/// supersampled, as flat bands of colour and the interior of the set would
+/// look the same however many samples they had. Every edge pixel is given
+/// its own slot of samples before any are rendered, so tiles can fill their
+/// samples in parallel without sharing anything.
+/// </summary>
+EdgeSamples::EdgeSamples() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+EdgeSamples::~EdgeSamples() {}
+
+
+/// <summary>
+/// Finds the edge pixels of a rendered iteration buffer and makes room for
+/// their samples, discarding any previous samples.
+/// A pixel is on an edge if it differs from the pixel above, below, left or
+/// right of it, see differ(), so both sides of an edge are supersampled.
+/// Pixels outside the buffer are only compared with the rows given above
+/// and below it, so a buffer which is one band of a larger image finds the
+/// edges on its first and last rows too.
+/// </summary>
+/// <param name="iterations">Fully rendered buffer of bounds.width *
+/// bounds.height counts, row by row</param>
+/// <param name="bounds">The pixels of the view the buffer holds</param>
+/// <param name="maxIterations">The iteration limit the buffer was rendered
+/// with</param>
+/// <param name="threshold">The difference in iterations which makes an
+/// edge</param>
+/// <param name="gridSize">The samples along each side of a pixel, so each
+/// edge pixel has gridSize * gridSize samples</param>
+/// <param name="rowAbove">The bounds.width counts of the row above the
+/// buffer, or nullptr if there is none</param>
+/// <param name="rowBelow">The bounds.width counts of the row below the
+/// buffer, or nullptr if there is none</param>
+void EdgeSamples::findEdges(const float* iterations, const PixelRect& bounds, int maxIterations,
+                            float threshold, int gridSize, const float* rowAbove, const float* rowBelow)
+{
+    m_bounds = bounds;
+    m_maxIterations = maxIterations;
+    m_threshold = threshold;
+    m_gridSize = gridSize;
+    m_edges.assign(static_cast<size_t>(bounds.width) * bounds.height, NOT_AN_EDGE);
+
+    const int width = bounds.width;
+    const int height = bounds.height;
+
+#pragma omp parallel for
+    for (int y = 0; y < height; ++y)
+    {
+        const float* above = y > 0 ? iterations + (y - 1) * width : rowAbove;
+        const float* below = y + 1 < height ? iterations + (y + 1) * width : rowBelow;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const float* p = iterations + y * width + x;
+
+            if ((x > 0 && differ(*p, p[-1])) || (x + 1 < width && differ(*p, p[1])) ||
+                (above != nullptr && differ(*p, above[x])) || (below != nullptr && differ(*p, below[x])))
+                m_edges[y * width + x] = 0;
+        }
+    }
+
+    // Number the edges in order, which is each one's slot of samples
+    m_edgeCount = 0;
+    for (int& edge : m_edges)
+        if (edge != NOT_AN_EDGE)
+            edge = m_edgeCount++;
+
+    m_samples.assign(static_cast<size_t>(m_edgeCount) * getSampleCount(), MandelbrotEngine::UNRENDERED);
+}
+
+/// <summary>
+/// Compares the iteration counts of two pixels or samples. They differ if
+/// one is bounded and the other is not, or if they are further apart than
+/// the threshold. Unrendered counts differ from nothing.
+/// </summary>
+/// <param name="a">One count</param>
+/// <param name="b">The other count</param>
+/// <returns>True if the counts would be coloured noticeably differently</returns>
+bool EdgeSamples::differ(float a, float b) const
+{
+    if (a == MandelbrotEngine::UNRENDERED || b == MandelbrotEngine::UNRENDERED)
+        return false;
+
+    return (a >= m_maxIterations) != (b >= m_maxIterations) || std::fabs(a - b) > m_threshold;
+}
+
+
+/// <summary>
+/// Discards every edge and sample, leaving no pixels to supersample.
+/// </summary>
+void EdgeSamples::clear()
+{
+    m_edgeCount = 0;
+    m_edges.clear();
+    m_samples.clear();
+}
+
+
+/// <summary>
+/// Getter for bounds.
+/// </summary>
+/// <returns>The pixels of the view the edges were found in</returns>
+const PixelRect& EdgeSamples::getBounds() const { return m_bounds; }
+
+/// <summary>
+/// Getter for gridSize.
+/// </summary>
+/// <returns>The samples along each side of an edge pixel</returns>
+int EdgeSamples::getGridSize() const { return m_gridSize; }
+
+/// <summary>
+/// The number of samples of each edge pixel.
+/// </summary>
+/// <returns>The square of the grid size</returns>
+int EdgeSamples::getSampleCount() const { return m_gridSize * m_gridSize; }
+
+/// <summary>
+/// Getter for edgeCount.
+/// </summary>
+/// <returns>The number of pixels to supersample</returns>
+int EdgeSamples::getEdgeCount() const { return m_edgeCount; }
+
+
+/// <summary>
+/// Looks up the edge at a pixel.
+/// </summary>
+/// <param name="x">Pixel coordinate x, within the bounds</param>
+/// <param name="y">Pixel coordinate y, within the bounds</param>
+/// <returns>The number of the edge, or NOT_AN_EDGE if the pixel is not
+/// supersampled</returns>
+int EdgeSamples::getEdge(int x, int y) const
+{
+    if (m_edges.empty())
+        return NOT_AN_EDGE;
+
+    return m_edges[(y - m_bounds.top) * m_bounds.width + (x - m_bounds.left)];
+}
+
+/// <summary>
+/// The samples of an edge pixel, row by row across the pixel, as iteration
+/// counts.
+/// </summary>
+/// <param name="edge">The number of the edge, from getEdge()</param>
+/// <returns>The first of getSampleCount() samples</returns>
+float* EdgeSamples::getSamples(int edge)
+{
+    return m_samples.data() + static_cast<size_t>(edge) * getSampleCount();
+}
+
+/// <summary>
+/// The samples of an edge pixel, row by row across the pixel, as iteration
+/// counts.
+/// </summary>
+/// <param name="edge">The number of the edge, from getEdge()</param>
+/// <returns>The first of getSampleCount() samples</returns>
+const float* EdgeSamples::getSamples(int edge) const
+{
+    return m_samples.data() + static_cast<size_t>(edge) * getSampleCount();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include "View.hpp"
+
+class EdgeSamples
+{
+public:
+    static constexpr int NOT_AN_EDGE = -1;
+    static constexpr int DEFAULT_GRID_SIZE = 4;
+    static constexpr int MAX_GRID_SIZE = 8;
+    static constexpr float DEFAULT_THRESHOLD = 2.0f;
+
+    EdgeSamples();
+    ~EdgeSamples();
+
+    void findEdges(const float* iterations, const PixelRect& bounds, int maxIterations, float threshold, int gridSize,
+                   const float* rowAbove, const float* rowBelow);
+    void clear();
+    bool differ(float a, float b) const;
+    const PixelRect& getBounds() const;
+    int getGridSize() const;
+    int getSampleCount() const;
+    int getEdgeCount() const;
+    int getEdge(int x, int y) const;
+    float* getSamples(int edge);
+    const float* getSamples(int edge) const;
+
+private:
+    PixelRect m_bounds;
+    int m_maxIterations = 0;
+    float m_threshold = DEFAULT_THRESHOLD;
+    int m_gridSize = 1;
+    int m_edgeCount = 0;
+    std::vector<int> m_edges;
+    std::vector<float> m_samples;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cctype>
+#include <cmath>
+#include "SimdKernel.hpp"
+
+#if defined(_MSC_VER) && !defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// The building blocks of double-double and quad-double arithmetic, which
+// return the rounded result of an operation on doubles together with its
+// rounding error, so that numbers held as unevaluated sums of doubles can be
+// added and multiplied without losing the lower parts.
+
+/// <summary>
+/// Knuth's two-sum: a + b = sum + error exactly, for any a and b.
+/// </summary>
+inline double twoSum(double a, double b, double& error)
+{
+    const double sum = a + b;
+    const double b1 = sum - a;
+    error = (a - (sum - b1)) + (b - b1);
+    return sum;
+}
+
+/// <summary>
+/// Dekker's fast two-sum: a + b = sum + error exactly, if |a| >= |b|.
+/// </summary>
+inline double quickTwoSum(double a, double b, double& error)
+{
+    const double sum = a + b;
+    error = b - (sum - a);
+    return sum;
+}
+
+/// <summary>
+/// a * b = product + error exactly, by a fused multiply-add where the target
+/// has one, otherwise by Dekker's product of halves of 26 bits. MSVC builds
+/// for targets without FMA, so there it is chosen at runtime, as MSVC allows
+/// its intrinsics in any function.
+/// </summary>
+inline double twoProduct(double a, double b, double& error)
+{
+    const double product = a * b;
+#if defined(__FMA__) || defined(__AVX2__)
+    error = std::fma(a, b, -product);
+#else
+#ifdef _MSC_VER
+    if (SimdKernel::FMA_IS_SUPPORTED)
+    {
+        error = _mm_cvtsd_f64(_mm_fmadd_sd(_mm_set_sd(a), _mm_set_sd(b), _mm_set_sd(-product)));
+        return product;
+    }
+#endif
+
+    constexpr double SPLITTER = 134217729.0; // 2^27 + 1
+    const double ta = SPLITTER * a;
+    const double aHigh = ta - (ta - a);
+    const double aLow = a - aHigh;
+    const double tb = SPLITTER * b;
+    const double bHigh = tb - (tb - b);
+    const double bLow = b - bHigh;
+    error = ((aHigh * bHigh - product) + aHigh * bLow + aLow * bHigh) + aLow * bLow;
+#endif
+    return product;
+}
+
+/// <summary>
+/// Three-sum of the QD library: a + b + c = a' + b' + c' with the terms
+/// decreasing in magnitude.
+/// </summary>
+inline void threeSum(double& a, double& b, double& c)
+{
+    double t2, t3;
+    const double t1 = twoSum(a, b, t2);
+    a = twoSum(c, t1, t3);
+    b = twoSum(t2, t3, c);
+}
+
+/// <summary>
+/// Three-sum of the QD library keeping two terms: a + b + c ~ a' + b'.
+/// </summary>
+inline void threeSumTwo(double& a, double& b, double c)
+{
+    double t2, t3;
+    const double t1 = twoSum(a, b, t2);
+    a = twoSum(c, t1, t3);
+    b = t2 + t3;
+}
+
+/// <summary>
+/// Parses a decimal number, such as one given on the command line, into a
+/// type holding a sum of doubles, at that type's precision.
+/// Text which is not a number gives 0.
+/// </summary>
+/// <param name="decimal">Decimal number, with an optional exponent</param>
+/// <returns>The number</returns>
+template <typename T>
+T parseDecimal(const char* decimal)
+{
+    static const T TEN = 10.0;
+    const char* c = decimal;
+
+    while (isspace(static_cast<unsigned char>(*c)))
+        ++c;
+
+    const bool isNegative = *c == '-';
+    if (*c == '-' || *c == '+')
+        ++c;
+
+    T value = 0.0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    for (; isdigit(static_cast<unsigned char>(*c)); ++c, hasDigits = true)
+        value = value * 10.0 + static_cast<double>(*c - '0');
+
+    if (*c == '.')
+        for (++c; isdigit(static_cast<unsigned char>(*c)); ++c, hasDigits = true, --exponent)
+            value = value * 10.0 + static_cast<double>(*c - '0');
+
+    if (!hasDigits)
+        return T(0.0);
+
+    if (*c == 'e' || *c == 'E')
+    {
+        const char* digits = c + 1;
+        const bool isNegativeExponent = *digits == '-';
+        if (*digits == '-' || *digits == '+')
+            ++digits;
+
+        int e = 0;
+        for (; isdigit(static_cast<unsigned char>(*digits)); ++digits)
+            e = 10 * e + (*digits - '0');
+
+        exponent += isNegativeExponent ? -e : e;
+    }
+
+    if (exponent > 0)
+        value *= pow(TEN, static_cast<unsigned long>(exponent));
+    else if (exponent < 0)
+        value /= pow(TEN, static_cast<unsigned long>(-exponent));
+
+    return isNegative ? -value : value;
+}
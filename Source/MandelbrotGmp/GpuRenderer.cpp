@@ -0,0 +1,207 @@
+#include "GpuRenderer.hpp"
+#include <iostream>
+
+/// <summary>
+/// Fragment shader iterating the Mandelbrot Set function for one pixel.
+/// Floats on the GPU only have 24 bits of precision, so each number is
+/// held as the unevaluated sum of two floats (hi + lo), which gives
+/// roughly 48 bits using only single precision arithmetic.
+/// The iteration count is encoded into the RGB channels of the output.
+/// </summary>
+static const char* const FRAGMENT_SHADER = R"glsl(#version 120
+
+    uniform vec2 centreX;
+    uniform vec2 centreY;
+    uniform vec2 pixelScale;
+    uniform vec2 screenSize;
+    uniform float maxIterations;
+
+    vec2 quickTwoSum(float a, float b)
+    {
+        float s = a + b;
+        return vec2(s, b - (s - a));
+    }
+
+    vec2 twoSum(float a, float b)
+    {
+        float s = a + b;
+        float v = s - a;
+        return vec2(s, (a - (s - v)) + (b - v));
+    }
+
+    vec2 split(float a)
+    {
+        float t = 4097.0 * a;
+        float hi = t - (t - a);
+        return vec2(hi, a - hi);
+    }
+
+    vec2 twoProduct(float a, float b)
+    {
+        float p = a * b;
+        vec2 as = split(a);
+        vec2 bs = split(b);
+        return vec2(p, ((as.x * bs.x - p) + as.x * bs.y + as.y * bs.x) + as.y * bs.y);
+    }
+
+    vec2 add(vec2 a, vec2 b)
+    {
+        vec2 s = twoSum(a.x, b.x);
+        return quickTwoSum(s.x, s.y + a.y + b.y);
+    }
+
+    vec2 multiply(vec2 a, vec2 b)
+    {
+        vec2 p = twoProduct(a.x, b.x);
+        return quickTwoSum(p.x, p.y + a.x * b.y + a.y * b.x);
+    }
+
+    void main()
+    {
+        // Texture coordinates are pixel coordinates from the top left
+        vec2 p = floor(gl_TexCoord[0].xy);
+
+        // See View::complexAtPixel
+        vec2 x0 = add(centreX, multiply(pixelScale, vec2(2.0 * p.x - screenSize.x, 0.0)));
+        vec2 y0 = add(centreY, multiply(pixelScale, vec2(2.0 * p.y - screenSize.y, 0.0)));
+
+        vec2 x = x0;
+        vec2 y = y0;
+        float n = 0.0;
+
+        // Main cardioid and period 2 bulb, see isInCardioidOrBulb
+        float shifted = x0.x - 0.25;
+        float y2 = y0.x * y0.x;
+        float q = shifted * shifted + y2;
+        if (q * (q + shifted) <= 0.25 * y2 || (x0.x + 1.0) * (x0.x + 1.0) + y2 <= 0.0625)
+            n = maxIterations;
+
+        for (; n < maxIterations; n += 1.0)
+        {
+            // z[n+1] := z[n]^2 + z[0]
+            vec2 xx = multiply(x, x);
+            vec2 yy = multiply(y, y);
+            vec2 xy = multiply(x, y);
+            x = add(add(xx, -yy), x0);
+            y = add(add(xy, xy), y0);
+
+            if (x.x * x.x + y.x * y.x > 16.0)
+                break;
+        }
+
+        float low = mod(n, 256.0);
+        float middle = mod(floor(n / 256.0), 256.0);
+        float high = floor(n / 65536.0);
+        gl_FragColor = vec4(low, middle, high, 255.0) / 255.0;
+    }
+)glsl";
+
+/// <summary>
+/// Splits a double into the nearest float and the float remainder.
+/// </summary>
+static sf::Glsl::Vec2 splitDouble(double d)
+{
+    float hi = static_cast<float>(d);
+    float lo = static_cast<float>(d - hi);
+    return sf::Glsl::Vec2(hi, lo);
+}
+
+
+/// <summary>
+/// Renders shallow views on the GPU with a fragment shader, emulating double
+/// precision with pairs of floats. The iteration counts are read back so
+/// they can be coloured like any other render.
+/// </summary>
+GpuRenderer::GpuRenderer() : m_quad(sf::Quads, 4) {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+GpuRenderer::~GpuRenderer() {}
+
+
+/// <summary>
+/// Compiles the shader and creates the offscreen target to render to.
+/// Must be called from the thread with the active OpenGL context.
+/// </summary>
+/// <param name="width">The width of the screen</param>
+/// <param name="height">The height of the screen</param>
+/// <returns>True if the GPU can be used to render</returns>
+bool GpuRenderer::create(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    m_isAvailable = sf::Shader::isAvailable() &&
+                    m_shader.loadFromMemory(FRAGMENT_SHADER, sf::Shader::Fragment) &&
+                    m_target.create(width, height);
+
+    if (!m_isAvailable)
+    {
+        std::cout << "GPU rendering is unavailable" << std::endl;
+        return false;
+    }
+
+    // A quad covering the screen, with texture coordinates in pixels
+    const float w = static_cast<float>(width);
+    const float h = static_cast<float>(height);
+    m_quad[0] = sf::Vertex(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+    m_quad[1] = sf::Vertex(sf::Vector2f(w, 0), sf::Vector2f(w, 0));
+    m_quad[2] = sf::Vertex(sf::Vector2f(w, h), sf::Vector2f(w, h));
+    m_quad[3] = sf::Vertex(sf::Vector2f(0, h), sf::Vector2f(0, h));
+
+    return true;
+}
+
+/// <summary>
+/// Getter for whether the shader and target were created successfully
+/// </summary>
+/// <returns>True if the GPU can be used to render</returns>
+bool GpuRenderer::isAvailable() const { return m_isAvailable; }
+
+/// <summary>
+/// Checks whether the view is shallow enough for the precision of the
+/// shader.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <returns>True if the view can be rendered on the GPU</returns>
+bool GpuRenderer::canRender(const View& view) const
+{
+    return m_isAvailable && view.getScale() > MIN_SCALE;
+}
+
+
+/// <summary>
+/// Renders every pixel of the view on the GPU and reads the iteration counts
+/// back into an iteration buffer.
+/// Must be called from the thread with the active OpenGL context.
+/// </summary>
+/// <param name="view">The view to render, which must satisfy canRender()</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <param name="iterations">The iteration buffer to fill, of width x height</param>
+void GpuRenderer::render(const View& view, int maxIterations, float* iterations)
+{
+    const Complex centre = view.getCentre();
+    const double pixelScale = static_cast<double>(view.getScale()) / m_height;
+
+    m_shader.setUniform("centreX", splitDouble(static_cast<double>(centre.x)));
+    m_shader.setUniform("centreY", splitDouble(static_cast<double>(centre.y)));
+    m_shader.setUniform("pixelScale", splitDouble(pixelScale));
+    m_shader.setUniform("screenSize", sf::Glsl::Vec2(static_cast<float>(m_width), static_cast<float>(m_height)));
+    m_shader.setUniform("maxIterations", static_cast<float>(maxIterations));
+
+    m_target.clear();
+    m_target.draw(m_quad, &m_shader);
+    m_target.display();
+
+    // Decode the iteration counts from the colour channels
+    sf::Image image = m_target.getTexture().copyToImage();
+    const sf::Uint8* pixels = image.getPixelsPtr();
+
+#pragma omp parallel for
+    for (int i = 0; i < m_width * m_height; ++i)
+    {
+        const sf::Uint8* pixel = pixels + 4 * i;
+        iterations[i] = static_cast<float>(pixel[0] | (pixel[1] << 8) | (pixel[2] << 16));
+    }
+}
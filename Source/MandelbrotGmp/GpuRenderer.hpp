@@ -0,0 +1,26 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "View.hpp"
+
+class GpuRenderer
+{
+public:
+    static constexpr double MIN_SCALE = 1e-6;
+
+    GpuRenderer();
+    ~GpuRenderer();
+
+    bool create(int width, int height);
+    bool isAvailable() const;
+    bool canRender(const View& view) const;
+    void render(const View& view, int maxIterations, float* iterations);
+
+private:
+    bool m_isAvailable = false;
+    int m_width = 0;
+    int m_height = 0;
+    sf::Shader m_shader;
+    sf::RenderTexture m_target;
+    sf::VertexArray m_quad;
+};
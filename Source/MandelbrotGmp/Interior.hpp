@@ -0,0 +1,29 @@
+#pragma once
+
+/// <summary>
+/// Closed form test for whether a point lies in the main cardioid or the
+/// period 2 bulb of the Mandelbrot Set, which together contain most of the
+/// interior of a typical view.
+/// Points inside either are bounded, so need not be iterated at all.
+/// </summary>
+/// <param name="x">Real part of the point</param>
+/// <param name="y">Imaginary part of the point</param>
+/// <returns>True if the point is inside the cardioid or the bulb</returns>
+template <typename T>
+bool isInCardioidOrBulb(const T& x, const T& y)
+{
+    static const T QUARTER = 0.25;
+    static const T SIXTEENTH = 0.0625;
+    static const T ONE = 1.0;
+
+    // Main cardioid: q(q + x - 1/4) <= y^2 / 4, where q = (x - 1/4)^2 + y^2
+    T shifted = x - QUARTER;
+    T y2 = y * y;
+    T q = shifted * shifted + y2;
+    if (q * (q + shifted) <= QUARTER * y2)
+        return true;
+
+    // Period 2 bulb: circle of radius 1/4 centred on -1
+    T bulb = x + ONE;
+    return bulb * bulb + y2 <= SIXTEENTH;
+}
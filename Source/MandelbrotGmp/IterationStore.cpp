@@ -0,0 +1,180 @@
+#include "IterationStore.hpp"
+#include <cstdio>
+
+
+/// <summary>
+/// Constructs an empty store of blocks of iteration counts, such as strips
+/// or tiles waiting to be written out in order. Blocks are kept compact in
+/// memory up to a budget, and the rest written to a spill file, which is
+/// only created if needed and is read back through a mapping.
+/// </summary>
+/// <param name="budgetBytes">The most memory the kept blocks may use</param>
+/// <param name="spillPath">The file to spill blocks to, which is truncated
+/// when first used and deleted with the store</param>
+IterationStore::IterationStore(size_t budgetBytes, const std::string& spillPath) :
+    m_budgetBytes(budgetBytes),
+    m_spillPath(spillPath)
+{
+}
+
+/// <summary>
+/// Destructor, which deletes the spill file.
+/// </summary>
+IterationStore::~IterationStore()
+{
+    clear();
+}
+
+
+/// <summary>
+/// Getter for the memory budget.
+/// </summary>
+/// <returns>The most memory the kept blocks may use, in bytes</returns>
+size_t IterationStore::getBudget() const { return m_budgetBytes; }
+
+/// <summary>
+/// Getter for the memory used.
+/// </summary>
+/// <returns>The bytes of the blocks kept in memory</returns>
+size_t IterationStore::getSizeBytes() const { return m_sizeBytes; }
+
+/// <summary>
+/// Getter for the spilled size.
+/// </summary>
+/// <returns>The bytes of the blocks in the spill file which have not been
+/// taken yet</returns>
+size_t IterationStore::getSpilledBytes() const { return m_spilledBytes; }
+
+/// <summary>
+/// Checks whether a block is stored, in memory or spilled.
+/// </summary>
+/// <param name="id">The number of the block</param>
+/// <returns>True if take() would find the block</returns>
+bool IterationStore::contains(int id) const { return m_blocks.count(id) != 0; }
+
+
+/// <summary>
+/// Encodes a block of iteration counts and stores it, replacing any block
+/// with the same number.
+/// When memory is over budget, the blocks with the highest numbers are
+/// spilled until it fits, as blocks are usually taken in order and those
+/// are needed last. If the spill file cannot be written, blocks are kept in
+/// memory over budget rather than lost.
+/// </summary>
+/// <param name="id">The number of the block</param>
+/// <param name="iterations">The top left count of the block in the buffer</param>
+/// <param name="width">The width of the block</param>
+/// <param name="height">The height of the block</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+void IterationStore::put(int id, const float* iterations, int width, int height, int stride)
+{
+    take(id, nullptr, 0);
+
+    Block& block = m_blocks[id];
+    block.compact = CompactIterations(iterations, width, height, stride);
+    block.width = width;
+    block.height = height;
+    block.isSpilled = false;
+    block.offset = 0;
+    block.sizeBytes = block.compact.getSizeBytes();
+    m_sizeBytes += block.sizeBytes;
+
+    for (auto last = m_blocks.rbegin(); m_sizeBytes > m_budgetBytes && last != m_blocks.rend(); ++last)
+        if (!last->second.isSpilled && !spill(last->second))
+            break;
+}
+
+/// <summary>
+/// Decodes a stored block into a buffer of iteration counts and removes it.
+/// The space it took in the spill file is only reused once the store is
+/// empty.
+/// </summary>
+/// <param name="id">The number of the block</param>
+/// <param name="iterations">Where the top left count of the block goes in
+/// the buffer, or null to discard the block</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+/// <returns>False if there is no such block, or it could not be read back</returns>
+bool IterationStore::take(int id, float* iterations, int stride)
+{
+    auto found = m_blocks.find(id);
+    if (found == m_blocks.end())
+        return false;
+
+    Block& block = found->second;
+    bool isDecoded = iterations == nullptr;
+
+    if (!block.isSpilled)
+    {
+        if (!isDecoded)
+            isDecoded = block.compact.decode(iterations, stride);
+
+        m_sizeBytes -= block.sizeBytes;
+    }
+    else
+    {
+        if (!isDecoded)
+        {
+            // Map the file again only if blocks have been spilled since
+            m_spillFile.flush();
+            if (m_mapping == nullptr || m_mapping->getSize() < block.offset + block.sizeBytes)
+                m_mapping.reset(new MappedFile(m_spillPath));
+
+            isDecoded = m_mapping->getSize() >= block.offset + block.sizeBytes &&
+                        CompactIterations::decode(reinterpret_cast<const std::uint8_t*>(m_mapping->getData()) + block.offset,
+                                                  block.sizeBytes, block.width, block.height, iterations, stride);
+        }
+
+        m_spilledBytes -= block.sizeBytes;
+    }
+
+    m_blocks.erase(found);
+
+    if (m_blocks.empty() && m_spillSize > 0)
+        clear();
+
+    return isDecoded;
+}
+
+/// <summary>
+/// Discards every block and deletes the spill file.
+/// </summary>
+void IterationStore::clear()
+{
+    m_blocks.clear();
+    m_sizeBytes = 0;
+    m_spilledBytes = 0;
+    m_mapping.reset();
+
+    if (m_spillFile.is_open())
+    {
+        m_spillFile.close();
+        std::remove(m_spillPath.c_str());
+    }
+
+    m_spillSize = 0;
+}
+
+
+/// <summary>
+/// Writes a block to the end of the spill file and frees its memory.
+/// </summary>
+/// <param name="block">The block, which is kept in memory if it cannot be
+/// written</param>
+/// <returns>True if the block was spilled</returns>
+bool IterationStore::spill(Block& block)
+{
+    if (!m_spillFile.is_open())
+        m_spillFile.open(m_spillPath, std::ios::binary | std::ios::trunc);
+
+    m_spillFile.write(reinterpret_cast<const char*>(block.compact.getData()), block.sizeBytes);
+    if (!m_spillFile.good())
+        return false;
+
+    block.isSpilled = true;
+    block.offset = m_spillSize;
+    block.compact = CompactIterations();
+    m_spillSize += block.sizeBytes;
+    m_sizeBytes -= block.sizeBytes;
+    m_spilledBytes += block.sizeBytes;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include "CompactIterations.hpp"
+#include "MappedFile.hpp"
+
+class IterationStore
+{
+public:
+    IterationStore(size_t budgetBytes, const std::string& spillPath);
+    ~IterationStore();
+
+    size_t getBudget() const;
+    size_t getSizeBytes() const;
+    size_t getSpilledBytes() const;
+    bool contains(int id) const;
+    void put(int id, const float* iterations, int width, int height, int stride);
+    bool take(int id, float* iterations, int stride);
+    void clear();
+
+private:
+    struct Block
+    {
+        CompactIterations compact;
+        int width;
+        int height;
+        bool isSpilled;
+        std::uint64_t offset;
+        size_t sizeBytes;
+    };
+
+    size_t m_budgetBytes;
+    size_t m_sizeBytes = 0;
+    size_t m_spilledBytes = 0;
+    std::string m_spillPath;
+    std::ofstream m_spillFile;
+    std::uint64_t m_spillSize = 0;
+    std::unique_ptr<MappedFile> m_mapping;
+    std::map<int, Block> m_blocks;
+
+    bool spill(Block& block);
+};
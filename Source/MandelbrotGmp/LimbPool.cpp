@@ -0,0 +1,119 @@
+#include "LimbPool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+thread_local LimbPool::FreeList LimbPool::s_freeLists[MAX_POOLED_LIMBS + 1];
+
+
+/// <summary>
+/// Makes GMP allocate mantissas from pools owned by each thread, rather than
+/// the global heap, whose lock every OpenMP thread contends for when
+/// arbitrary precision numbers are made and destroyed for every pixel.
+/// Freed blocks are kept on the freeing thread, in a list for their exact
+/// number of limbs, and handed out again without locking. As a view uses
+/// only a few precisions, nearly every allocation is then a pop from a list.
+/// Blocks are only reused once freed, so numbers may outlive any tile or
+/// thread, such as reference orbits and scratch registers.
+/// Every block comes from malloc, so blocks allocated before this call are
+/// freed correctly through the pool and the other way round.
+/// </summary>
+void LimbPool::install()
+{
+    mp_set_memory_functions(allocate, reallocate, release);
+}
+
+
+/// <summary>
+/// Allocates a block for GMP, from the thread's pool if it has one of the
+/// same number of limbs.
+/// </summary>
+/// <param name="bytes">The size GMP asked for</param>
+/// <returns>The block, which is never null as GMP cannot handle failure</returns>
+void* LimbPool::allocate(size_t bytes)
+{
+    const size_t limbs = limbsOf(bytes);
+
+    if (limbs <= MAX_POOLED_LIMBS)
+    {
+        FreeList& list = s_freeLists[limbs];
+
+        if (list.head != nullptr)
+        {
+            void* block = list.head;
+            memcpy(&list.head, block, sizeof(void*));
+            --list.count;
+            return block;
+        }
+    }
+
+    void* block = malloc(bytesOf(limbs));
+    if (block == nullptr)
+        abort();
+
+    return block;
+}
+
+/// <summary>
+/// Resizes a block for GMP, which keeps it as it is if it already has the
+/// number of limbs asked for.
+/// </summary>
+/// <param name="block">The block, from allocate()</param>
+/// <param name="oldBytes">The size it was allocated with</param>
+/// <param name="newBytes">The size GMP asked for</param>
+/// <returns>The resized block, holding the old contents up to the smaller
+/// of the sizes</returns>
+void* LimbPool::reallocate(void* block, size_t oldBytes, size_t newBytes)
+{
+    if (limbsOf(oldBytes) == limbsOf(newBytes))
+        return block;
+
+    void* resized = allocate(newBytes);
+    memcpy(resized, block, std::min(oldBytes, newBytes));
+    release(block, oldBytes);
+    return resized;
+}
+
+/// <summary>
+/// Frees a block for GMP onto the thread's pool, unless the pool already
+/// holds MAX_FREE_BLOCKS of its size or it is too large to pool.
+/// </summary>
+/// <param name="block">The block, from allocate()</param>
+/// <param name="bytes">The size it was allocated with</param>
+void LimbPool::release(void* block, size_t bytes)
+{
+    const size_t limbs = limbsOf(bytes);
+
+    if (limbs <= MAX_POOLED_LIMBS && s_freeLists[limbs].count < MAX_FREE_BLOCKS)
+    {
+        FreeList& list = s_freeLists[limbs];
+        memcpy(block, &list.head, sizeof(void*));
+        list.head = block;
+        ++list.count;
+        return;
+    }
+
+    free(block);
+}
+
+
+/// <summary>
+/// The number of limbs a size is rounded up to, which picks its pool.
+/// </summary>
+/// <param name="bytes">The size</param>
+/// <returns>The number of limbs</returns>
+size_t LimbPool::limbsOf(size_t bytes)
+{
+    return (bytes + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
+}
+
+/// <summary>
+/// The size of the blocks allocated for a number of limbs, which can always
+/// hold the pointer linking a free block to the next.
+/// </summary>
+/// <param name="limbs">The number of limbs</param>
+/// <returns>The size in bytes</returns>
+size_t LimbPool::bytesOf(size_t limbs)
+{
+    return std::max(limbs * sizeof(mp_limb_t), sizeof(void*));
+}
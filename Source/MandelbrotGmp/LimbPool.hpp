@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <gmp.h>
+
+class LimbPool
+{
+public:
+    static constexpr size_t MAX_POOLED_LIMBS = 1024;
+    static constexpr unsigned MAX_FREE_BLOCKS = 256;
+
+    static void install();
+    static void* allocate(size_t bytes);
+    static void* reallocate(void* block, size_t oldBytes, size_t newBytes);
+    static void release(void* block, size_t bytes);
+
+private:
+    struct FreeList
+    {
+        void* head;
+        unsigned count;
+    };
+
+    static thread_local FreeList s_freeLists[MAX_POOLED_LIMBS + 1];
+
+    static size_t limbsOf(size_t bytes);
+    static size_t bytesOf(size_t limbs);
+};
@@ -1,12 +1,44 @@
 #include "MandelbrotRenderer.hpp"
+#include "LimbPool.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
 
-int main()
+/// <summary>
+/// Explores the Mandelbrot Set in a window.
+/// Rendered tiles are only kept on disk with --cache DIR.
+/// </summary>
+int main(int argc, char* argv[])
 {
+    std::string cacheDirectory;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: MandelbrotGmp [--cache DIR]" << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef UseArbitraryPrecision
+    // Pool GMP's allocations on each thread, before rendering starts
+    LimbPool::install();
+#endif
+
     // Screen dimensions, width and height in pixels
     constexpr unsigned int SCREEN_W = 1200u;
     constexpr unsigned int SCREEN_H = 900u;
 
-    MandelbrotRenderer mandelbrot(SCREEN_W, SCREEN_H);
+    // Memory for keeping recently completed renders, at least 60 screens and
+    // usually over twice as many once compacted
+    constexpr size_t HISTORY_BUDGET_BYTES = 256u << 20;
+
+    MandelbrotRenderer mandelbrot(SCREEN_W, SCREEN_H, HISTORY_BUDGET_BYTES, cacheDirectory);
     mandelbrot.run();
 
     return 0;
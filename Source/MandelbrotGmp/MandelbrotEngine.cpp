@@ -0,0 +1,1183 @@
+#include "MandelbrotEngine.hpp"
+#include "Interior.hpp"
+#include "DoubleDouble.hpp"
+#include "QuadDouble.hpp"
+#include <algorithm>
+#include <omp.h>
+
+
+/// <summary>
+/// The compute core of the renderer: iterates regions of a view into a
+/// buffer of iteration counts, independently of any window.
+/// The buffer may cover only part of the view, so very large images can be
+/// rendered one band at a time.
+/// </summary>
+MandelbrotEngine::MandelbrotEngine() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+MandelbrotEngine::~MandelbrotEngine() {}
+
+
+/// <summary>
+/// The iteration limit to use for a view when none is given.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <returns>Iteration limit, increasing with the depth of the view</returns>
+int MandelbrotEngine::defaultMaxIterations(const View& view)
+{
+    return 120 - (10 * static_cast<int>(view.getZoom()));
+}
+
+
+/// <summary>
+/// Finds the iteration limit a view needs from a coarse sample of it, with
+/// the spacing of the coarsest pass.
+/// The limit is doubled while doing so lets more than a small share of the
+/// sampled pixels escape, which are the bounded pixels along the boundary
+/// of the set. It is then lowered as far as it can be with no more than
+/// that share of the escaped pixels becoming bounded.
+/// Raising the limit costs each round about twice the last, so it is only
+/// raised a few times before any pixel escapes, which is then at most the
+/// cost of rendering the view at the starting limit.
+/// The prepared view is replaced by the sample, so prepare() must be called
+/// again before rendering.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="maxIterations">The limit to start from</param>
+/// <param name="cancelling">Flag to stop sampling early</param>
+/// <returns>The iteration limit, or maxIterations if cancelled</returns>
+int MandelbrotEngine::estimateMaxIterations(const View& view, int maxIterations, const std::atomic<bool>& cancelling)
+{
+    const int width = std::max(MIN_SAMPLE_SIZE, view.getScreenSize().x / COARSEST_STEP);
+    const int height = std::max(MIN_SAMPLE_SIZE, view.getScreenSize().y / COARSEST_STEP);
+    const PixelRect whole(0, 0, width, height);
+    const int count = width * height;
+    const int allowed = static_cast<int>(SETTLED_SHARE * count);
+
+    // The same area with fewer pixels
+    View sample(view);
+    sample.resizeScreen(width, height);
+    sample.setScale(view.getScale());
+
+    // Samples are not tiles of the view, so are not cached
+    float* const target = m_iterations;
+    const PixelRect bounds = m_bounds;
+    const TileCache* const cache = m_tileCache;
+    m_tileCache = nullptr;
+
+    std::vector<float> iterations(count);
+    setTarget(iterations.data(), whole);
+
+    auto renderSample = [&](int limit)
+    {
+        prepare(sample, limit);
+        render(std::vector<PixelRect>(1, whole), Pixel(width / 2, height / 2), 1, cancelling, [](const PixelRect&) {});
+    };
+
+    auto countBounded = [&](int limit)
+    {
+        return static_cast<int>(std::count_if(iterations.begin(), iterations.end(),
+                                              [limit](float n) { return n >= limit; }));
+    };
+
+    const int start = std::min(std::max(maxIterations, MIN_ITERATION_LIMIT), MAX_ITERATION_LIMIT);
+    int limit = start;
+    renderSample(limit);
+
+    while (limit < MAX_ITERATION_LIMIT && !cancelling)
+    {
+        const int bounded = countBounded(limit);
+        if (bounded <= allowed)
+            break;
+
+        // With no escaped pixels there is no boundary to settle, only the
+        // interior of the set or pixels which escape beyond the limit, so the
+        // limit is raised anyway for a few doublings
+        const bool boundaryIsFound = count - bounded > allowed;
+        if (!boundaryIsFound && limit >= start << BLIND_DOUBLINGS)
+        {
+            limit = start;
+            break;
+        }
+
+        // Limits which are not a power of two would otherwise double past
+        // the largest the counts can hold
+        limit = std::min(2 * limit, MAX_ITERATION_LIMIT);
+        renderSample(limit);
+
+        if (boundaryIsFound && bounded - countBounded(limit) <= allowed)
+            break;
+    }
+
+    if (!cancelling)
+    {
+        // The highest escape counts, beyond the few allowed to become bounded
+        std::vector<float> escaped;
+        for (float n : iterations)
+            if (n < limit)
+                escaped.push_back(n);
+
+        if (static_cast<int>(escaped.size()) > allowed)
+        {
+            std::nth_element(escaped.begin(), escaped.begin() + allowed, escaped.end(), std::greater<float>());
+            limit = std::min(limit, std::max(MIN_ITERATION_LIMIT, static_cast<int>(escaped[allowed]) + 1));
+        }
+    }
+
+    m_tileCache = cache;
+    setTarget(target, bounds);
+    return cancelling ? maxIterations : limit;
+}
+
+
+/// <summary>
+/// Sets the view and iteration limit for the following renders, and does the
+/// work shared by every pixel of the view.
+/// In arbitrary precision, this includes iterating the reference orbit when
+/// doubles cannot resolve the view, so should be called off the UI thread.
+/// </summary>
+/// <param name="view">The view to render, including the size of the whole
+/// image in pixels</param>
+/// <param name="maxIterations">The iteration limit</param>
+void MandelbrotEngine::prepare(const View& view, int maxIterations)
+{
+    const auto start = RenderStats::Clock::now();
+    m_view = view;
+    m_width = view.getScreenSize().x;
+    m_height = view.getScreenSize().y;
+    m_maxIterations = maxIterations;
+
+    // Orbits returning to within a thousandth of a pixel of a previous point
+    // are periodic. This scales with the view so deep zooms are not affected.
+    // Forced full precision iterates bounded points to the limit instead.
+    const double pixelSize = 2.0 * static_cast<double>(view.getScale()) / m_height;
+    m_periodicityTolerance = m_fullPrecisionIsForced || !m_periodicityDetectionIsEnabled
+                                 ? 0 : 1e-6 * pixelSize * pixelSize;
+
+    // Only pay for arbitrary precision when doubles cannot resolve the pixels
+    m_doubleIsPrecise = view.getPrecision() <= std::numeric_limits<double>::digits;
+
+    // Half the width of a pixel in the complex plane, see View::complexAtPixel
+    m_pixelScale = static_cast<double>(view.getScale()) / m_height;
+
+    // Views doubles can resolve find their pixels in doubles too, as doing so
+    // in arbitrary precision would cost more than iterating them
+    m_doubleCentre = DeltaComplex(static_cast<double>(view.getCentre().x), static_cast<double>(view.getCentre().y));
+
+    m_secondaryReferences.clear();
+    const char* reference = "none";
+
+#ifdef UseArbitraryPrecision
+    // Iterate a point at full precision once, so that every pixel can be
+    // iterated relative to it in double precision. A reference kept from a
+    // nearby view is used if there is one, so panning and zooming only pay
+    // for the full precision iteration when moving somewhere new.
+    if (m_fullPrecisionIsForced)
+    {
+        reference = "none";
+    }
+    else if (!m_doubleIsPrecise && (!m_referenceIsLocked || m_referenceOrbit == nullptr))
+    {
+        m_referenceOrbit = m_referenceCache.find(view, m_maxIterations);
+        reference = "reused";
+
+        if (m_referenceOrbit == nullptr)
+        {
+            m_referenceOrbit = m_referenceCache.compute(view, m_maxIterations);
+            reference = "computed";
+        }
+    }
+    else if (!m_doubleIsPrecise)
+    {
+        reference = "locked";
+    }
+
+    if (!m_doubleIsPrecise && !m_fullPrecisionIsForced)
+    {
+        // Pixels are offset from the centre of the view, which the reference
+        // need not be at
+        const Complex centre = m_referenceOrbit->getCentre();
+        m_referenceOffset = DeltaComplex(static_cast<double>(view.getCentre().x - centre.x),
+                                         static_cast<double>(view.getCentre().y - centre.y));
+
+        // Skip the iterations every pixel has in common, checking the series
+        // against the corners and edge midpoints of the view, see
+        // mandelbrotPerturbed()
+        const double w = m_pixelScale * m_width;
+        const double h = m_pixelScale * m_height;
+        const DeltaComplex& o = m_referenceOffset;
+        const std::vector<DeltaComplex> probes = {
+            o + DeltaComplex(-w, -h), o + DeltaComplex(0, -h), o + DeltaComplex(w, -h), o + DeltaComplex(w, 0),
+            o + DeltaComplex(w, h), o + DeltaComplex(0, h), o + DeltaComplex(-w, h), o + DeltaComplex(-w, 0)
+        };
+
+        if (m_seriesApproximationIsEnabled)
+            m_referenceOrbit->approximate(probes, m_maxIterations);
+        else
+            m_referenceOrbit->clearApproximation();
+    }
+#endif
+
+    m_stats.reset(m_fullPrecisionIsForced ? "full" : m_doubleIsPrecise ? "double" : "perturbation",
+                  view.getPrecision(), omp_get_max_threads());
+    m_stats.setReference(reference);
+#ifdef UseArbitraryPrecision
+    if (!m_doubleIsPrecise && !m_fullPrecisionIsForced)
+        m_stats.setSkippedIterations(m_referenceOrbit->getSeriesLength());
+#endif
+    m_stats.addPrepareSeconds(RenderStats::secondsSince(start));
+}
+
+
+/// <summary>
+/// Sets the buffer that renders write their iteration counts to.
+/// </summary>
+/// <param name="iterations">Buffer of bounds.width * bounds.height counts,
+/// row by row</param>
+/// <param name="bounds">The pixels of the view the buffer holds</param>
+void MandelbrotEngine::setTarget(float* iterations, const PixelRect& bounds)
+{
+    m_iterations = iterations;
+    m_bounds = bounds;
+}
+
+
+/// <summary>
+/// Renders regions of the view to the target buffer in parallel tiles,
+/// starting from the tiles nearest the focus.
+/// Can be made to return early by setting cancelling to true, which is
+/// checked before each tile is started and between the pixels of a tile, so
+/// a cancelled render stops within about one pixel. The target buffer is
+/// then incomplete and the tile being rendered is partly written.
+/// </summary>
+/// <param name="regions">The regions to render, within the target bounds</param>
+/// <param name="focus">The pixel to render outwards from</param>
+/// <param name="coarsestStep">The spacing of the first of the progressively
+/// finer passes, or 1 to render every pixel in a single pass</param>
+/// <param name="cancelling">Flag to stop rendering early</param>
+/// <param name="tileRendered">Called after each pass of each tile finishes,
+/// from the thread which rendered it</param>
+void MandelbrotEngine::render(const std::vector<PixelRect>& regions, Pixel focus, int coarsestStep,
+                              const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered)
+{
+    m_cancelling = &cancelling;
+    m_tileScheduler.split(regions, focus);
+    loadCachedTiles(tileRendered);
+
+    if (m_boundaryTracingIsEnabled)
+    {
+        // Tiles are filled by subdivision instead of in passes
+        runPass(1, [this, &tileRendered](const PixelRect& tile)
+        {
+            traceRect(tile);
+            storeTile(tile);
+            tileRendered(tile);
+        }, cancelling);
+
+        return;
+    }
+
+    // Render progressively finer passes over the whole region, so a coarse
+    // image is available quickly. Each pass only samples the pixels which
+    // the previous passes did not.
+    for (int step = coarsestStep; step >= 1; step /= 2)
+    {
+        runPass(step, [this, step, coarsestStep, &tileRendered](const PixelRect& tile)
+        {
+            renderTile(tile, step, coarsestStep);
+
+            if (step == 1)
+                storeTile(tile);
+
+            tileRendered(tile);
+        }, cancelling);
+
+        if (cancelling)
+            break;
+    }
+}
+
+
+/// <summary>
+/// Renders only the pixels of the regions which a pass with step 2 would not
+/// sample, for when the pixels at even offsets from each tile corner are
+/// already in the target buffer.
+/// </summary>
+/// <param name="regions">The regions to render, within the target bounds and
+/// starting at even pixel coordinates</param>
+/// <param name="focus">The pixel to render outwards from</param>
+/// <param name="cancelling">Flag to stop rendering early</param>
+/// <param name="tileRendered">Called after each tile finishes, from the
+/// thread which rendered it</param>
+void MandelbrotEngine::refine(const std::vector<PixelRect>& regions, Pixel focus,
+                              const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered)
+{
+    m_cancelling = &cancelling;
+
+    // Boundary tracing already skips pixels which have been rendered
+    if (m_boundaryTracingIsEnabled)
+    {
+        render(regions, focus, 1, cancelling, tileRendered);
+        return;
+    }
+
+    m_tileScheduler.split(regions, focus);
+    runPass(1, [this, &tileRendered](const PixelRect& tile)
+    {
+        renderTile(tile, 1, 2);
+        tileRendered(tile);
+    }, cancelling);
+}
+
+
+/// <summary>
+/// Supersamples the edge pixels of the view, after the view has been fully
+/// rendered and its edges found. Each edge pixel is sampled on a grid of
+/// points jittered within their cells, so the edges are smoothed without
+/// the regular patterns a fixed grid leaves on fine filaments.
+/// The samples are rendered in tiles by the tile scheduler like any other
+/// pass, and can be cancelled the same way as render(), leaving the samples
+/// incomplete.
+/// </summary>
+/// <param name="samples">The edges to sample, whose samples are written</param>
+/// <param name="focus">The pixel to render outwards from</param>
+/// <param name="cancelling">Flag to stop rendering early</param>
+/// <param name="tileRendered">Called after each tile finishes, from the
+/// thread which rendered it</param>
+void MandelbrotEngine::antialias(EdgeSamples& samples, Pixel focus,
+                                 const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered)
+{
+    m_cancelling = &cancelling;
+    m_tileScheduler.split(std::vector<PixelRect>(1, samples.getBounds()), focus);
+
+    runPass(0, [this, &samples, &tileRendered](const PixelRect& tile)
+    {
+        sampleTile(samples, tile);
+        tileRendered(tile);
+    }, cancelling);
+}
+
+
+/// <summary>
+/// Getter for the iteration limit.
+/// </summary>
+/// <returns>The iteration limit of the prepared view</returns>
+int MandelbrotEngine::getMaxIterations() const { return m_maxIterations; }
+
+/// <summary>
+/// Getter for boundaryTracingIsEnabled.
+/// </summary>
+/// <returns>True if tiles are rendered by Mariani-Silver subdivision</returns>
+bool MandelbrotEngine::getBoundaryTracingIsEnabled() const { return m_boundaryTracingIsEnabled; }
+
+/// <summary>
+/// Setter for boundaryTracingIsEnabled.
+/// Output is the same either way, except where exterior detail thinner than
+/// a pixel slips between the pixels of a traced border.
+/// </summary>
+/// <param name="enabled">True to render tiles by Mariani-Silver subdivision
+/// instead of in progressive passes</param>
+void MandelbrotEngine::setBoundaryTracingIsEnabled(bool enabled) { m_boundaryTracingIsEnabled = enabled; }
+
+
+/// <summary>
+/// Getter for seriesApproximationIsEnabled.
+/// </summary>
+/// <returns>True if perturbed pixels skip the iterations covered by a
+/// series approximation</returns>
+bool MandelbrotEngine::getSeriesApproximationIsEnabled() const { return m_seriesApproximationIsEnabled; }
+
+/// <summary>
+/// Setter for seriesApproximationIsEnabled.
+/// Iteration counts are the same either way, bar pixels within rounding of
+/// escaping at a different iteration. Takes effect from the next prepare().
+/// </summary>
+/// <param name="enabled">True to skip iterations with a series
+/// approximation, false to iterate every pixel from the start</param>
+void MandelbrotEngine::setSeriesApproximationIsEnabled(bool enabled) { m_seriesApproximationIsEnabled = enabled; }
+
+/// <summary>
+/// Getter for interiorDetectionIsEnabled.
+/// </summary>
+/// <returns>True if points in the main cardioid or period 2 bulb are known
+/// to be bounded without being iterated</returns>
+bool MandelbrotEngine::getInteriorDetectionIsEnabled() const { return m_interiorDetectionIsEnabled; }
+
+/// <summary>
+/// Setter for interiorDetectionIsEnabled.
+/// Only points which are in the set are skipped, so iteration counts are the
+/// same either way, bar rounding of points on the border of the cardioid.
+/// </summary>
+/// <param name="enabled">True to skip points in the main cardioid or period
+/// 2 bulb, false to iterate them to the limit</param>
+void MandelbrotEngine::setInteriorDetectionIsEnabled(bool enabled) { m_interiorDetectionIsEnabled = enabled; }
+
+
+/// <summary>
+/// Getter for periodicityDetectionIsEnabled.
+/// </summary>
+/// <returns>True if orbits found to be periodic stop being iterated</returns>
+bool MandelbrotEngine::getPeriodicityDetectionIsEnabled() const { return m_periodicityDetectionIsEnabled; }
+
+/// <summary>
+/// Setter for periodicityDetectionIsEnabled.
+/// An orbit which comes within the tolerance of a previous point without
+/// being periodic is taken to be bounded, so a few pixels which would escape
+/// late may differ. Takes effect from the next prepare().
+/// </summary>
+/// <param name="enabled">True to stop iterating orbits which have become
+/// periodic, false to iterate them to the limit</param>
+void MandelbrotEngine::setPeriodicityDetectionIsEnabled(bool enabled) { m_periodicityDetectionIsEnabled = enabled; }
+
+
+/// <summary>
+/// Getter for the instruction set of the SIMD kernel.
+/// </summary>
+/// <returns>The instruction set pixels iterated in doubles are iterated with</returns>
+SimdKernel::Level MandelbrotEngine::getSimdLevel() const { return m_simdKernel.getLevel(); }
+
+/// <summary>
+/// Setter for the instruction set of the SIMD kernel, which is the widest
+/// the CPU supports unless set otherwise. Every level gives the same
+/// iteration counts, so this is for measuring them against each other.
+/// </summary>
+/// <param name="level">The instruction set, which the CPU must support,
+/// see SimdKernel::detectLevel()</param>
+void MandelbrotEngine::setSimdLevel(SimdKernel::Level level) { m_simdKernel = SimdKernel(level); }
+
+
+/// <summary>
+/// Getter for stats. Only complete once the last render of the prepared
+/// view has returned.
+/// </summary>
+/// <returns>The measurements of the prepared view's renders</returns>
+const RenderStats& MandelbrotEngine::getStats() const { return m_stats; }
+
+
+/// <summary>
+/// Getter for fullPrecisionIsForced.
+/// </summary>
+/// <returns>True if every pixel is iterated at the full precision of the
+/// view, with none of the shortcuts</returns>
+bool MandelbrotEngine::getFullPrecisionIsForced() const { return m_fullPrecisionIsForced; }
+
+/// <summary>
+/// Setter for fullPrecisionIsForced.
+/// Forcing it iterates each pixel with mandelbrot() in Real, so at the full
+/// precision of the view in the Arbitrary build, without perturbation, the
+/// SIMD kernel, DoubleDouble or QuadDouble, and without detecting interior
+/// points by the cardioid test or periodicity. It is far too slow to
+/// explore with, but is the ground truth the fast paths are measured
+/// against. Boundary tracing still fills what it traces, so should be
+/// disabled too. Takes effect from the next prepare().
+/// </summary>
+/// <param name="forced">True to iterate every pixel in full, false to use
+/// the fastest method which suits the view</param>
+void MandelbrotEngine::setFullPrecisionIsForced(bool forced) { m_fullPrecisionIsForced = forced; }
+
+
+/// <summary>
+/// Getter for referenceIsLocked.
+/// </summary>
+/// <returns>True if prepare() keeps the current reference orbit</returns>
+bool MandelbrotEngine::getReferenceIsLocked() const { return m_referenceIsLocked; }
+
+/// <summary>
+/// Setter for referenceIsLocked.
+/// A series of views with the same centre can share one reference orbit by
+/// preparing the deepest view, then locking the reference.
+/// </summary>
+/// <param name="locked">True to keep the current reference orbit for every
+/// following view</param>
+void MandelbrotEngine::setReferenceIsLocked(bool locked) { m_referenceIsLocked = locked; }
+
+/// <summary>
+/// Getter for the reference orbit, so it can be shared with other engines.
+/// </summary>
+/// <returns>The orbit used by the last prepare() of a view too deep for
+/// doubles, or set by setReferenceOrbit(), otherwise null</returns>
+const ReferenceOrbit* MandelbrotEngine::getReferenceOrbit() const { return m_referenceOrbit; }
+
+/// <summary>
+/// Uses an orbit computed by another engine, and locks it so that prepare()
+/// does not replace it.
+/// </summary>
+/// <param name="centre">The reference point of the orbit</param>
+/// <param name="orbit">The orbit from getReferenceOrbit().getOrbit()</param>
+void MandelbrotEngine::setReferenceOrbit(const Complex& centre, const std::vector<DeltaComplex>& orbit)
+{
+    m_referenceOrbit = m_referenceCache.add(centre, orbit);
+    m_referenceIsLocked = true;
+}
+
+/// <summary>
+/// Discards the kept reference orbits, so the next prepare() iterates a new
+/// one, such as to time it. The reference is unlocked.
+/// </summary>
+void MandelbrotEngine::clearReferences()
+{
+    m_referenceCache.clear();
+    m_referenceOrbit = nullptr;
+    m_referenceIsLocked = false;
+}
+
+
+/// <summary>
+/// Setter for tileCache.
+/// </summary>
+/// <param name="cache">The cache to load tiles from and store finished
+/// tiles in, or null to render every tile</param>
+void MandelbrotEngine::setTileCache(const TileCache* cache) { m_tileCache = cache; }
+
+
+/// <summary>
+/// The iteration count of a pixel of the view in the target buffer.
+/// </summary>
+/// <param name="x">Pixel coordinate x, within the target bounds</param>
+/// <param name="y">Pixel coordinate y, within the target bounds</param>
+/// <returns>Reference to the count</returns>
+float& MandelbrotEngine::iterationsAt(int x, int y)
+{
+    return m_iterations[(y - m_bounds.top) * m_bounds.width + (x - m_bounds.left)];
+}
+
+/// <summary>
+/// Checks the cancelling flag of the render in progress.
+/// </summary>
+/// <returns>True if the render should stop as soon as possible</returns>
+bool MandelbrotEngine::isCancelled() const
+{
+    return m_cancelling != nullptr && *m_cancelling;
+}
+
+
+/// <summary>
+/// Runs one pass over the scheduled tiles, timing each tile and the pass
+/// as a whole.
+/// </summary>
+/// <param name="step">The spacing between sampled pixels in the pass</param>
+/// <param name="renderTile">Renders one tile, called from any thread</param>
+/// <param name="cancelling">Flag to stop rendering early</param>
+void MandelbrotEngine::runPass(int step, const std::function<void(const PixelRect&)>& renderTile,
+                               const std::atomic<bool>& cancelling)
+{
+    const auto start = RenderStats::Clock::now();
+
+    m_tileScheduler.run([this, &renderTile](const PixelRect& tile)
+    {
+        const auto tileStart = RenderStats::Clock::now();
+        renderTile(tile);
+        m_stats.addTile(omp_get_thread_num(), RenderStats::secondsSince(tileStart));
+    }, cancelling);
+
+    m_stats.addPass(step, RenderStats::secondsSince(start));
+}
+
+
+/// <summary>
+/// Copies every tile which is in the tile cache into the target buffer, and
+/// removes it from the tiles to be rendered.
+/// </summary>
+/// <param name="tileRendered">Called after each tile is loaded</param>
+void MandelbrotEngine::loadCachedTiles(const std::function<void(const PixelRect&)>& tileRendered)
+{
+    if (m_tileCache == nullptr)
+        return;
+
+    m_tileScheduler.removeTiles([this, &tileRendered](const PixelRect& tile)
+    {
+        const std::string key = TileCache::makeKey(m_view, *this, tile);
+
+        if (!m_tileCache->load(key, tile.width, tile.height, &iterationsAt(tile.left, tile.top), m_bounds.width))
+            return false;
+
+        m_stats.addCachedTile();
+        tileRendered(tile);
+        return true;
+    });
+}
+
+
+/// <summary>
+/// Saves a fully rendered tile to the tile cache, if there is one.
+/// </summary>
+/// <param name="tile">The tile to save</param>
+void MandelbrotEngine::storeTile(const PixelRect& tile)
+{
+    // A cancelled tile may have been abandoned part way through
+    if (m_tileCache == nullptr || isCancelled())
+        return;
+
+    const std::string key = TileCache::makeKey(m_view, *this, tile);
+    m_tileCache->store(key, tile.width, tile.height, &iterationsAt(tile.left, tile.top), m_bounds.width);
+}
+
+
+/// <summary>
+/// Renders one pass of one tile of pixels to the target iteration buffer.
+/// One pixel is sampled in every step x step block of the tile and the whole
+/// block is filled with it, skipping the pixels already sampled by the
+/// coarser pass with twice the step, unless this is the first pass.
+/// Blocks are measured from the corner of the tile and clipped to it, so
+/// no pixels outside the tile are written.
+/// </summary>
+/// <param name="tile">The region of the screen to render</param>
+/// <param name="step">The spacing between sampled pixels in this pass</param>
+/// <param name="coarsestStep">The spacing of the first pass</param>
+void MandelbrotEngine::renderTile(const PixelRect& tile, int step, int coarsestStep)
+{
+    const int previousStep = 2 * step;
+
+    for (int y = tile.top; y < tile.top + tile.height; y += step)
+    {
+        // Rows sampled by the previous pass only need the pixels in between
+        if (step < coarsestStep && (y - tile.top) % previousStep == 0)
+            renderRow(tile, y, tile.left + step, previousStep, step);
+        else
+            renderRow(tile, y, tile.left, step, step);
+    }
+}
+
+
+/// <summary>
+/// Renders evenly spaced pixels along one row of a tile to the
+/// target iteration buffer, filling a block of pixels for each.
+/// When doubles can resolve the view, the pixels are iterated together by
+/// the SIMD kernel, otherwise each is iterated relative to the reference
+/// orbit.
+/// </summary>
+/// <param name="tile">The tile being rendered</param>
+/// <param name="y">Pixel coordinate y of the row</param>
+/// <param name="left">Pixel coordinate x of the first pixel to render</param>
+/// <param name="stride">The spacing between the pixels to render</param>
+/// <param name="blockSize">The size of the block to fill for each pixel</param>
+void MandelbrotEngine::renderRow(const PixelRect& tile, int y, int left, int stride, int blockSize)
+{
+    const int right = tile.left + tile.width;
+    const int blockHeight = std::min(blockSize, tile.top + tile.height - y);
+
+    if (m_fullPrecisionIsForced)
+    {
+        for (int x = left; x < right && !isCancelled(); x += stride)
+            setIterations(x, y, static_cast<float>(mandelbrot(m_view.complexAtPixel(x, y))),
+                          std::min(blockSize, right - x), blockHeight);
+
+        return;
+    }
+
+#ifdef UseArbitraryPrecision
+    if (!m_doubleIsPrecise)
+    {
+        for (int x = left; x < right && !isCancelled(); x += stride)
+            setIterations(x, y, static_cast<float>(mandelbrotPerturbed(x, y)), std::min(blockSize, right - x), blockHeight);
+
+        return;
+    }
+#endif
+
+    // Convert screen pixel coordinates (x,y) to complex numbers z in the
+    // view (x + yi) and apply the Mandelbrot set to them together
+    const int width = m_simdKernel.getWidth();
+    double packetX[SimdKernel::MAX_WIDTH];
+    int packetIterations[SimdKernel::MAX_WIDTH];
+    const double imaginary = pointAtPixel(0, y).y;
+
+    for (int x = left; x < right && !isCancelled(); x += width * stride)
+    {
+        // Lanes past the end of the row repeat the last pixel
+        int count = 0;
+        for (int i = 0; i < width; ++i)
+        {
+            if (x + i * stride < right)
+                count = i + 1;
+
+            packetX[i] = pointAtPixel(x + (count - 1) * stride, y).x;
+        }
+
+        m_simdKernel.mandelbrot(packetX, imaginary, m_maxIterations, m_interiorDetectionIsEnabled,
+                                m_periodicityTolerance, packetIterations);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int pixelX = x + i * stride;
+            setIterations(pixelX, y, static_cast<float>(packetIterations[i]),
+                          std::min(blockSize, right - pixelX), blockHeight);
+        }
+    }
+}
+
+
+/// <summary>
+/// Converts pixel coordinates to the complex number there in double
+/// precision, as View::complexAtPixel() does when Real is double, for views
+/// which doubles can resolve.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <returns>The point of the pixel in the complex plane</returns>
+DeltaComplex MandelbrotEngine::pointAtPixel(int x, int y) const
+{
+    return DeltaComplex(m_doubleCentre.x + m_pixelScale * (2 * x - m_width),
+                        m_doubleCentre.y + m_pixelScale * (2 * y - m_height));
+}
+
+/// <summary>
+/// A repeatable pseudorandom offset for one sample of a pixel, so the same
+/// view always anti-aliases the same way whichever thread samples it.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <param name="sample">Which offset of the pixel to make</param>
+/// <returns>The offset, in the range 0:1</returns>
+double MandelbrotEngine::jitter(int x, int y, int sample)
+{
+    unsigned hash = static_cast<unsigned>(x) * 73856093u ^ static_cast<unsigned>(y) * 19349663u ^
+                    static_cast<unsigned>(sample) * 83492791u;
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+    return (hash & 0xFFFFFF) / 16777216.0;
+}
+
+
+/// <summary>
+/// Samples the edge pixels within one tile.
+/// </summary>
+/// <param name="samples">The edges to sample, whose samples are written</param>
+/// <param name="tile">The region of the screen to sample</param>
+void MandelbrotEngine::sampleTile(EdgeSamples& samples, const PixelRect& tile)
+{
+    for (int y = tile.top; y < tile.top + tile.height && !isCancelled(); ++y)
+    {
+        for (int x = tile.left; x < tile.left + tile.width; ++x)
+        {
+            const int edge = samples.getEdge(x, y);
+
+            if (edge != EdgeSamples::NOT_AN_EDGE)
+                samplePixel(x, y, samples.getGridSize(), samples.getSamples(edge));
+        }
+    }
+}
+
+
+/// <summary>
+/// Iterates a grid of points spread over a pixel, each jittered within its
+/// cell of the grid. The points of each row of the grid share one jittered
+/// offset down the pixel, so that the SIMD kernel can iterate them together.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <param name="gridSize">The points along each side of the pixel, at most
+/// EdgeSamples::MAX_GRID_SIZE</param>
+/// <param name="iterations">Buffer of gridSize * gridSize iteration counts
+/// to write, row by row</param>
+void MandelbrotEngine::samplePixel(int x, int y, int gridSize, float* iterations)
+{
+    // Offsets from the pixel's own point, which is in the middle of its area
+    double offsetX[EdgeSamples::MAX_GRID_SIZE];
+
+    for (int j = 0; j < gridSize && !isCancelled(); ++j)
+    {
+        const double offsetY = (j + jitter(x, y, gridSize * gridSize + j)) / gridSize - 0.5;
+
+        for (int i = 0; i < gridSize; ++i)
+            offsetX[i] = (i + jitter(x, y, j * gridSize + i)) / gridSize - 0.5;
+
+        sampleRow(x, y, offsetY, offsetX, gridSize, iterations + j * gridSize);
+    }
+}
+
+
+/// <summary>
+/// Iterates points along one row within a pixel, all at the same offset
+/// down the pixel.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <param name="offsetY">The offset of the row down from the pixel's own
+/// point, in pixels</param>
+/// <param name="offsetX">The offsets of the points right of the pixel's own
+/// point, in pixels</param>
+/// <param name="count">The number of points</param>
+/// <param name="iterations">Buffer of count iteration counts to write</param>
+void MandelbrotEngine::sampleRow(int x, int y, double offsetY, const double* offsetX, int count, float* iterations)
+{
+    if (m_fullPrecisionIsForced)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            Complex z = m_view.complexAtPixel(x, y);
+            z.x += Real(2 * m_pixelScale * offsetX[i]);
+            z.y += Real(2 * m_pixelScale * offsetY);
+            iterations[i] = static_cast<float>(mandelbrot(z));
+        }
+
+        return;
+    }
+
+#ifdef UseArbitraryPrecision
+    if (!m_doubleIsPrecise)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            DeltaComplex dc(m_referenceOffset.x + m_pixelScale * (2 * (x + offsetX[i]) - m_width),
+                            m_referenceOffset.y + m_pixelScale * (2 * (y + offsetY) - m_height));
+            int n = m_referenceOrbit->iterate(dc, m_maxIterations);
+
+            if (n == ReferenceOrbit::GLITCHED)
+            {
+                m_stats.addGlitch(omp_get_thread_num());
+                Complex z = m_view.complexAtPixel(x, y);
+                z.x += Real(2 * m_pixelScale * offsetX[i]);
+                z.y += Real(2 * m_pixelScale * offsetY);
+                n = iterateGlitched(dc, z);
+            }
+
+            iterations[i] = static_cast<float>(n);
+        }
+
+        return;
+    }
+#endif
+
+    const DeltaComplex z = pointAtPixel(x, y);
+    const double imaginary = z.y + 2 * m_pixelScale * offsetY;
+    const int width = m_simdKernel.getWidth();
+    double packetX[SimdKernel::MAX_WIDTH];
+    int packetIterations[SimdKernel::MAX_WIDTH];
+
+    for (int i = 0; i < count; i += width)
+    {
+        // Lanes past the end of the row repeat the last point
+        for (int lane = 0; lane < width; ++lane)
+            packetX[lane] = z.x + 2 * m_pixelScale * offsetX[std::min(i + lane, count - 1)];
+
+        m_simdKernel.mandelbrot(packetX, imaginary, m_maxIterations, m_interiorDetectionIsEnabled,
+                                m_periodicityTolerance, packetIterations);
+
+        for (int lane = 0; lane < width && i + lane < count; ++lane)
+            iterations[i + lane] = static_cast<float>(packetIterations[lane]);
+    }
+}
+
+
+/// <summary>
+/// Renders a rectangle of the target iteration buffer by Mariani-Silver
+/// subdivision. The Mandelbrot Set is connected, so if every pixel on the
+/// border of a rectangle is in the set then so is every pixel inside it,
+/// which is filled without being iterated. Otherwise the rectangle is split
+/// into quarters, until it is small enough to iterate every pixel.
+/// </summary>
+/// <param name="rect">The region of the screen to render</param>
+void MandelbrotEngine::traceRect(const PixelRect& rect)
+{
+    if (isCancelled())
+        return;
+
+    if (rect.width <= SMALLEST_TRACED_SIZE || rect.height <= SMALLEST_TRACED_SIZE)
+    {
+        for (int y = rect.top; y < rect.top + rect.height && !isCancelled(); ++y)
+            for (int x = rect.left; x < rect.left + rect.width; ++x)
+                if (iterationsAt(x, y) == UNRENDERED)
+                    setIterations(x, y, static_cast<float>(iteratePixel(x, y)), 1, 1);
+
+        return;
+    }
+
+    if (traceBorder(rect))
+    {
+        setIterations(rect.left + 1, rect.top + 1, static_cast<float>(m_maxIterations),
+                      rect.width - 2, rect.height - 2);
+        return;
+    }
+
+    const int halfWidth = rect.width / 2;
+    const int halfHeight = rect.height / 2;
+    traceRect(PixelRect(rect.left, rect.top, halfWidth, halfHeight));
+    traceRect(PixelRect(rect.left + halfWidth, rect.top, rect.width - halfWidth, halfHeight));
+    traceRect(PixelRect(rect.left, rect.top + halfHeight, halfWidth, rect.height - halfHeight));
+    traceRect(PixelRect(rect.left + halfWidth, rect.top + halfHeight,
+                        rect.width - halfWidth, rect.height - halfHeight));
+}
+
+
+/// <summary>
+/// Iterates the pixels on the border of a rectangle which have not already
+/// been iterated by an enclosing rectangle.
+/// </summary>
+/// <param name="rect">The rectangle whose border to iterate</param>
+/// <returns>True if every pixel on the border is in the set</returns>
+bool MandelbrotEngine::traceBorder(const PixelRect& rect)
+{
+    const int right = rect.left + rect.width - 1;
+    const int bottom = rect.top + rect.height - 1;
+    const float inside = static_cast<float>(m_maxIterations);
+    bool isUniform = true;
+
+    auto trace = [&](int x, int y)
+    {
+        float& iterations = iterationsAt(x, y);
+
+        if (iterations == UNRENDERED && !isCancelled())
+            iterations = static_cast<float>(iteratePixel(x, y));
+
+        if (iterations != inside)
+            isUniform = false;
+    };
+
+    for (int x = rect.left; x <= right; ++x)
+    {
+        trace(x, rect.top);
+        trace(x, bottom);
+    }
+
+    for (int y = rect.top + 1; y < bottom; ++y)
+    {
+        trace(rect.left, y);
+        trace(right, y);
+    }
+
+    return isUniform;
+}
+
+
+/// <summary>
+/// Iterates a single pixel with whichever method suits the view.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <returns>Iterations until unbounded, or the maximum number of iterations
+/// if the pixel remained bounded</returns>
+int MandelbrotEngine::iteratePixel(int x, int y)
+{
+    if (m_fullPrecisionIsForced)
+        return mandelbrot(m_view.complexAtPixel(x, y));
+
+#ifdef UseArbitraryPrecision
+    if (!m_doubleIsPrecise)
+        return mandelbrotPerturbed(x, y);
+#endif
+
+    // Every lane iterates the same pixel
+    const DeltaComplex z = pointAtPixel(x, y);
+    double packetX[SimdKernel::MAX_WIDTH];
+    int packetIterations[SimdKernel::MAX_WIDTH];
+
+    for (int i = 0; i < m_simdKernel.getWidth(); ++i)
+        packetX[i] = z.x;
+
+    m_simdKernel.mandelbrot(packetX, z.y, m_maxIterations, m_interiorDetectionIsEnabled,
+                            m_periodicityTolerance, packetIterations);
+    return packetIterations[0];
+}
+
+
+/// <summary>
+/// Stores the number of iterations a pixel took to become unbounded in a
+/// block of the target iteration buffer.
+/// </summary>
+/// <param name="x">Pixel coordinate x of the top left of the block</param>
+/// <param name="y">Pixel coordinate y of the top left of the block</param>
+/// <param name="iterations">Iterations until unbounded, or the iteration
+/// limit if bounded</param>
+/// <param name="blockWidth">The width of the block</param>
+/// <param name="blockHeight">The height of the block</param>
+void MandelbrotEngine::setIterations(int x, int y, float iterations, int blockWidth, int blockHeight)
+{
+    for (int j = y; j < y + blockHeight; ++j)
+        for (int i = x; i < x + blockWidth; ++i)
+            iterationsAt(i, j) = iterations;
+}
+
+
+/// <summary>
+/// Iterates a complex number z using the Mandelbrot Set function
+/// z[n+1] := z[n]^2 + z[0]
+/// and returns the number of iterations until the number becomes unbounded.
+/// Points known to be bounded, either in closed form or by their orbit
+/// becoming periodic, return early.
+/// Down to the depths they can represent, points are iterated as a
+/// DoubleDouble or QuadDouble rather than at full precision.
+/// Forcing full precision skips both, see setFullPrecisionIsForced().
+/// </summary>
+/// <param name="z0">The complex number to evaluate</param>
+/// <returns>Iterations until unbounded, or the maximum number of iterations
+/// if the number remained bounded</returns>
+int MandelbrotEngine::mandelbrot(const Complex z0)
+{
+    if (m_fullPrecisionIsForced)
+        return mandelbrot(z0.x, z0.y);
+
+    // Most of the interior lies in the main cardioid or period 2 bulb,
+    // which need not be iterated
+    if (m_interiorDetectionIsEnabled && isInCardioidOrBulb(z0.x, z0.y))
+        return m_maxIterations;
+
+#ifdef UseArbitraryPrecision
+    if (m_view.getPrecision() <= DoubleDouble::PRECISION)
+        return mandelbrot(DoubleDouble::split(z0.x), DoubleDouble::split(z0.y));
+
+    if (m_view.getPrecision() <= QuadDouble::PRECISION)
+        return mandelbrot(QuadDouble::split(z0.x), QuadDouble::split(z0.y));
+#endif
+
+    return mandelbrot(z0.x, z0.y);
+}
+
+/// <summary>
+/// Iterates a complex number in whichever type mandelbrot() chose.
+/// </summary>
+/// <param name="x0">Real part of the number to evaluate</param>
+/// <param name="y0">Imaginary part of the number to evaluate</param>
+/// <returns>Iterations until unbounded, or the maximum number of iterations
+/// if the number remained bounded</returns>
+template <typename T>
+int MandelbrotEngine::mandelbrot(const T& x0, const T& y0)
+{
+    const int MAX_ITERATIONS = m_maxIterations;
+    constexpr double THRESHOLD = 16.0;
+
+    // Initialise the iterated complex number at z0
+    T x(x0);
+    T y(y0);
+
+    // Brent's method: compare z against a saved point, which is moved
+    // forward at doubling intervals so cycles of any period are found
+    T savedX(x0);
+    T savedY(y0);
+    int checkpoint = 1;
+
+    // Track the number of iterations until z becomes unbounded
+    for (int n = 0; n < MAX_ITERATIONS; n++)
+    {
+        // The Mandelbrot set is given by iteration of:
+        // z[n+1] := z[n]^2 + z[0]
+#ifdef UseArbitraryPrecision
+        // In place, as temporaries would allocate every iteration
+        squareAdd(x, y, x0, y0);
+        const double magnitude = normSquared(x, y);
+        const double distance = distanceSquared(x, y, savedX, savedY);
+#else
+        // Handling the real and imaginary parts separately:
+        const T xx = x * x - y * y + x0;
+        y = 2.0 * x * y + y0;
+        x = xx;
+        const double magnitude = x * x + y * y;
+        const double distance = (x - savedX) * (x - savedX) + (y - savedY) * (y - savedY);
+#endif
+
+        // z is approximately unbounded if its magnitude exceeds some threshold
+        if (magnitude > THRESHOLD)
+            return n;
+
+        // z is bounded if its orbit has become periodic
+        if (distance < m_periodicityTolerance)
+            break;
+
+        if (n == checkpoint)
+        {
+            savedX = x;
+            savedY = y;
+            checkpoint *= 2;
+        }
+
+        // Deep pixels can take long enough to be worth abandoning
+        if (n % CANCELLATION_INTERVAL == 0 && isCancelled())
+            break;
+    }
+
+    return MAX_ITERATIONS;
+}
+
+
+/// <summary>
+/// Iterates the pixel (x, y) relative to the reference orbit, falling back to
+/// iterateGlitched() if the perturbation loses precision.
+/// </summary>
+/// <param name="x">Pixel coordinate x</param>
+/// <param name="y">Pixel coordinate y</param>
+/// <returns>Iterations until unbounded, or the maximum number of iterations
+/// if the pixel remained bounded</returns>
+int MandelbrotEngine::mandelbrotPerturbed(int x, int y)
+{
+    // Offset of the pixel from the reference, which is offset from the
+    // centre of the view, see View::complexAtPixel
+    DeltaComplex dc(m_referenceOffset.x + m_pixelScale * (2 * x - m_width),
+                    m_referenceOffset.y + m_pixelScale * (2 * y - m_height));
+
+    int n = m_referenceOrbit->iterate(dc, m_maxIterations);
+
+    if (n == ReferenceOrbit::GLITCHED)
+    {
+        m_stats.addGlitch(omp_get_thread_num());
+        return iterateGlitched(dc, m_view.complexAtPixel(x, y));
+    }
+
+    return n;
+}
+
+
+/// <summary>
+/// Iterates a point the reference orbit lost precision for relative to a
+/// secondary reference instead. Points which glitch tend to be clustered,
+/// so the first in a cluster is iterated at full precision as a new
+/// secondary reference, and the rest are iterated relative to the nearest.
+/// Secondary references last until the next prepare(), and once there are
+/// MAX_SECONDARY_REFERENCES, points are iterated with mandelbrot().
+/// </summary>
+/// <param name="dc">Offset of the point from the reference</param>
+/// <param name="z">The point, at full precision</param>
+/// <returns>Iterations until unbounded, or the maximum number of iterations
+/// if the point remained bounded</returns>
+int MandelbrotEngine::iterateGlitched(const DeltaComplex& dc, const Complex& z)
+{
+    const SecondaryReference* nearest = nullptr;
+    bool isFull;
+    {
+        std::lock_guard<std::mutex> lock(m_secondaryMutex);
+        double nearestDistance = 0;
+
+        for (const std::unique_ptr<SecondaryReference>& secondary : m_secondaryReferences)
+        {
+            const DeltaComplex d = dc - secondary->offset;
+            const double distance = d.x * d.x + d.y * d.y;
+
+            if (nearest == nullptr || distance < nearestDistance)
+            {
+                nearest = secondary.get();
+                nearestDistance = distance;
+            }
+        }
+
+        isFull = m_secondaryReferences.size() >= MAX_SECONDARY_REFERENCES;
+    }
+
+    // References are only added while tiles are rendered, so one can be used
+    // without the lock once it is found
+    if (nearest != nullptr)
+    {
+        const int n = nearest->orbit.iterate(dc - nearest->offset, m_maxIterations);
+        if (n != ReferenceOrbit::GLITCHED)
+            return n;
+    }
+
+    if (isFull)
+        return mandelbrot(z);
+
+    // The point's own orbit is its iteration at full precision
+    std::unique_ptr<SecondaryReference> secondary(new SecondaryReference());
+    secondary->orbit.compute(z, m_maxIterations, m_view.getPrecision());
+    secondary->offset = dc;
+    const int n = secondary->orbit.iterate(DeltaComplex(0.0, 0.0), m_maxIterations);
+
+    std::lock_guard<std::mutex> lock(m_secondaryMutex);
+    if (m_secondaryReferences.size() < MAX_SECONDARY_REFERENCES)
+    {
+        m_secondaryReferences.push_back(std::move(secondary));
+        m_stats.addSecondaryReference();
+    }
+
+    return n;
+}
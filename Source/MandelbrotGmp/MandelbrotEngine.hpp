@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "View.hpp"
+#include "ReferenceOrbit.hpp"
+#include "ReferenceCache.hpp"
+#include "SimdKernel.hpp"
+#include "TileScheduler.hpp"
+#include "TileCache.hpp"
+#include "RenderStats.hpp"
+#include "EdgeSamples.hpp"
+
+class MandelbrotEngine
+{
+public:
+    static constexpr int COARSEST_STEP = 8;
+    static constexpr float UNRENDERED = -1.0f;
+    static constexpr int AUTO_ITERATIONS = 0;
+    static constexpr int MIN_ITERATION_LIMIT = 16;
+    static constexpr int MAX_ITERATION_LIMIT = (1 << 24) - 1;
+
+    MandelbrotEngine();
+    ~MandelbrotEngine();
+
+    static int defaultMaxIterations(const View& view);
+    int estimateMaxIterations(const View& view, int maxIterations, const std::atomic<bool>& cancelling);
+    void prepare(const View& view, int maxIterations);
+    void setTarget(float* iterations, const PixelRect& bounds);
+    void render(const std::vector<PixelRect>& regions, Pixel focus, int coarsestStep,
+                const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered);
+    void refine(const std::vector<PixelRect>& regions, Pixel focus,
+                const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered);
+    void antialias(EdgeSamples& samples, Pixel focus,
+                   const std::atomic<bool>& cancelling, const std::function<void(const PixelRect&)>& tileRendered);
+    bool getReferenceIsLocked() const;
+    void setReferenceIsLocked(bool locked);
+    const ReferenceOrbit* getReferenceOrbit() const;
+    void setReferenceOrbit(const Complex& centre, const std::vector<DeltaComplex>& orbit);
+    void clearReferences();
+    void setTileCache(const TileCache* cache);
+    int getMaxIterations() const;
+    bool getBoundaryTracingIsEnabled() const;
+    void setBoundaryTracingIsEnabled(bool enabled);
+    bool getSeriesApproximationIsEnabled() const;
+    void setSeriesApproximationIsEnabled(bool enabled);
+    bool getFullPrecisionIsForced() const;
+    void setFullPrecisionIsForced(bool forced);
+    bool getInteriorDetectionIsEnabled() const;
+    void setInteriorDetectionIsEnabled(bool enabled);
+    bool getPeriodicityDetectionIsEnabled() const;
+    void setPeriodicityDetectionIsEnabled(bool enabled);
+    SimdKernel::Level getSimdLevel() const;
+    void setSimdLevel(SimdKernel::Level level);
+    const RenderStats& getStats() const;
+
+private:
+    static constexpr int SMALLEST_TRACED_SIZE = 8;
+    static constexpr int CANCELLATION_INTERVAL = 1024;
+    static constexpr int MIN_SAMPLE_SIZE = 16;
+    static constexpr double SETTLED_SHARE = 0.001;
+    static constexpr int BLIND_DOUBLINGS = 6;
+    static constexpr int MAX_SECONDARY_REFERENCES = 16;
+
+    struct SecondaryReference
+    {
+        ReferenceOrbit orbit;
+        DeltaComplex offset;
+    };
+
+    View m_view;
+    int m_width = 1;
+    int m_height = 1;
+    float* m_iterations = nullptr;
+    PixelRect m_bounds;
+    TileScheduler m_tileScheduler;
+    SimdKernel m_simdKernel;
+    ReferenceCache m_referenceCache{ ReferenceCache::DEFAULT_CAPACITY };
+    ReferenceOrbit* m_referenceOrbit = nullptr;
+    DeltaComplex m_referenceOffset;
+    std::vector<std::unique_ptr<SecondaryReference>> m_secondaryReferences;
+    std::mutex m_secondaryMutex;
+    double m_pixelScale = 0;
+    DeltaComplex m_doubleCentre;
+    int m_maxIterations = 0;
+    double m_periodicityTolerance = 0;
+    bool m_doubleIsPrecise = true;
+    bool m_boundaryTracingIsEnabled = false;
+    bool m_seriesApproximationIsEnabled = true;
+    bool m_fullPrecisionIsForced = false;
+    bool m_interiorDetectionIsEnabled = true;
+    bool m_periodicityDetectionIsEnabled = true;
+    bool m_referenceIsLocked = false;
+    const TileCache* m_tileCache = nullptr;
+    const std::atomic<bool>* m_cancelling = nullptr;
+    RenderStats m_stats;
+
+    float& iterationsAt(int x, int y);
+    bool isCancelled() const;
+    void runPass(int step, const std::function<void(const PixelRect&)>& renderTile, const std::atomic<bool>& cancelling);
+    void loadCachedTiles(const std::function<void(const PixelRect&)>& tileRendered);
+    void storeTile(const PixelRect& tile);
+    void renderTile(const PixelRect& tile, int step, int coarsestStep);
+    void renderRow(const PixelRect& tile, int y, int left, int stride, int blockSize);
+    DeltaComplex pointAtPixel(int x, int y) const;
+    static double jitter(int x, int y, int sample);
+    void sampleTile(EdgeSamples& samples, const PixelRect& tile);
+    void samplePixel(int x, int y, int gridSize, float* iterations);
+    void sampleRow(int x, int y, double offsetY, const double* offsetX, int count, float* iterations);
+    void traceRect(const PixelRect& rect);
+    bool traceBorder(const PixelRect& rect);
+    int iteratePixel(int x, int y);
+    void setIterations(int x, int y, float iterations, int blockWidth, int blockHeight);
+    int mandelbrot(const Complex z0);
+    template <typename T>
+    int mandelbrot(const T& x0, const T& y0);
+    int mandelbrotPerturbed(int x, int y);
+    int iterateGlitched(const DeltaComplex& dc, const Complex& z);
+};
@@ -1,6 +1,8 @@
 #include "MandelbrotRenderer.hpp"
 #include <iostream>
 #include <functional>
+#include <algorithm>
+#include <cmath>
 
 
 /// <summary>
@@ -9,7 +11,12 @@
 /// </summary>
 /// <param name="width">The width of the window to create</param>
 /// <param name="height">The height of the window to create</param>
-MandelbrotRenderer::MandelbrotRenderer(int width, int height) :
+/// <param name="historyBudgetBytes">The most memory to keep recently
+/// completed renders in, so they are not rendered again</param>
+/// <param name="cacheDirectory">The directory to load and store rendered
+/// tiles in, or empty to keep none on disk</param>
+MandelbrotRenderer::MandelbrotRenderer(int width, int height, size_t historyBudgetBytes,
+                                       const std::string& cacheDirectory) :
     m_width(width),
     m_height(height),
     m_bufferSizeBytes(4 * width * height),
@@ -17,23 +24,61 @@ MandelbrotRenderer::MandelbrotRenderer(int width, int height) :
              "Mandelbrot Set Rendered in SFML with OpenMP and GMP",
              sf::Style::Titlebar | sf::Style::Close/* | sf::Style::Resize*/),
     m_drawingThread(&MandelbrotRenderer::draw, this),
-    m_renderingThread(&MandelbrotRenderer::render, this),
-    m_renderingView(-0.5, 0.0, 1.0, width, height)
+    m_renderingThread(&MandelbrotRenderer::renderLoop, this),
+    m_renderingView(-0.5, 0.0, 1.0, width, height),
+    m_history(historyBudgetBytes),
+    m_finishedTiles(FINISHED_TILE_CAPACITY),
+    m_bookmarks("Bookmarks.txt")
 {
     m_window.setFramerateLimit(60);
     m_window.setActive(false);
+
+    // Views visited before, such as the initial view, are loaded from disk.
+    // The cache has no size limit, so it is only kept when asked for.
+    if (!cacheDirectory.empty())
+    {
+        m_tileCache.reset(new TileCache(cacheDirectory));
+        m_engine.setTileCache(m_tileCache.get());
+    }
+
+    // No font is shipped, so the overlay uses a system font if one is found,
+    // otherwise it only draws the thread bars
+    static const char* const FONT_PATHS[] = {
+        "C:/Windows/Fonts/consola.ttf",
+        "C:/Windows/Fonts/cour.ttf",
+        "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"
+    };
+
+    for (const char* path : FONT_PATHS)
+    {
+        if (m_statsFont.loadFromFile(path))
+        {
+            m_statsFontIsLoaded = true;
+            break;
+        }
+    }
+
+    m_statsText.setFont(m_statsFont);
+    m_statsText.setCharacterSize(STATS_CHARACTER_SIZE);
+    m_statsText.setFillColor(sf::Color::White);
 }
 
 
 MandelbrotRenderer::~MandelbrotRenderer()
 {
-    // Note: m_renderingPixels and m_completedPixels are usually freed at the end
-    // of MandelbrotRenderer::draw()
+    // Note: the pixel and iteration buffers are usually freed at the end of
+    // MandelbrotRenderer::draw()
     if (m_renderingPixels != nullptr)
         delete[] m_renderingPixels;
 
     if (m_completedPixels != nullptr)
         delete[] m_completedPixels;
+
+    if (m_renderingIterations != nullptr)
+        delete[] m_renderingIterations;
+
+    if (m_completedIterations != nullptr)
+        delete[] m_completedIterations;
 }
 
 
@@ -55,11 +100,16 @@ void MandelbrotRenderer::run()
 
 
 /// <summary>
-/// Polls events from the window and directs them to the appropriate handlers
+/// Polls events from the window and directs them to the appropriate handlers.
+/// The view, palette and cursor they change are shared with the drawing
+/// thread, so the handlers change them under m_inputMutex, and the drawing
+/// thread works from a snapshot of them taken under it.
 /// </summary>
 void MandelbrotRenderer::handleEvents()
 {
     static sf::Event event;
+    float wheelDelta = 0;
+
     while (m_window.pollEvent(event))
     {
         switch (event.type)
@@ -81,12 +131,19 @@ void MandelbrotRenderer::handleEvents()
             handleMouseMoved(event);
             break;
 
+        case sf::Event::MouseLeft:
+        {
+            std::lock_guard<std::mutex> lock(m_inputMutex);
+            m_cursorIsShown = false;
+            break;
+        }
+
         case sf::Event::MouseButtonReleased:
             handleMouseReleased(event);
             break;
 
         case sf::Event::MouseWheelScrolled:
-            handleMouseWheel(event);
+            wheelDelta += event.mouseWheelScroll.delta;
             break;
 
         case::sf::Event::Resized:
@@ -97,6 +154,11 @@ void MandelbrotRenderer::handleEvents()
             break;
         }
     }
+
+    // Zoom once for every wheel event queued since the last poll, so only
+    // the latest view is rendered
+    if (wheelDelta != 0)
+        handleMouseWheel(wheelDelta);
 }
 
 
@@ -104,32 +166,71 @@ void MandelbrotRenderer::handleEvents()
 /// Handles key pressed events.
 /// Pans the view with arrow keys / WASD
 /// Resets to initial view with R
+/// Cycles the colours with C, changes the palette with P and toggles how
+/// iterations are spread over the palette with N, without re-rendering
+/// Toggles rendering shallow views on the GPU with G
+/// Toggles Mariani-Silver subdivision of tiles with M
+/// Steps back and forward through the visited views with Ctrl+Z and Ctrl+Y
+/// Toggles the overlay of the last frame's render statistics with F3
+/// Doubles or halves the iteration limit with + and -, and switches between
+/// choosing the limit automatically and by zoom with I
+/// Bookmarks the view and its iteration limit with Ctrl+1 to Ctrl+9, and
+/// returns to the bookmark with 1 to 9
 /// </summary>
 /// <param name="event">Key Pressed Event Union</param>
 void MandelbrotRenderer::handleKeys(const sf::Event& event)
 {
-    static const Real MOVEMENT_AMOUNT = 0.25;
+    // Pan by a whole number of pixels, so the previous render can be reused
+    static const double MOVEMENT_AMOUNT = 0.25;
+    const int MOVEMENT_PIXELS = static_cast<int>(MOVEMENT_AMOUNT * m_height / 2);
+    static const double PALETTE_CYCLE_AMOUNT = 1.0 / 12.0;
+    View visited;
+    int visitedIterations;
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+
+    // The view being rendered is only known to the drawing thread, so it
+    // saves the bookmark
+    if (event.key.code >= sf::Keyboard::Num1 && event.key.code <= sf::Keyboard::Num9)
+    {
+        const int slot = event.key.code - sf::Keyboard::Num1 + 1;
+
+        if (event.key.control)
+        {
+            m_bookmarkToSave = slot;
+        }
+        else if (m_bookmarks.get(slot, visited, visitedIterations))
+        {
+            m_renderingView.jumpTo(visited);
+            m_iterationSteps = 0;
+            m_manualMaxIterations = visitedIterations;
+
+            if (visitedIterations == MandelbrotEngine::AUTO_ITERATIONS)
+                m_iterationsAreAuto = true;
+        }
+
+        return;
+    }
 
     switch (event.key.code)
     {
     case sf::Keyboard::Left:
     case sf::Keyboard::A:
-        m_renderingView.moveBy(-MOVEMENT_AMOUNT, 0);
+        m_renderingView.moveByPixels(-MOVEMENT_PIXELS, 0);
         break;
 
     case sf::Keyboard::Right:
     case sf::Keyboard::D:
-        m_renderingView.moveBy(MOVEMENT_AMOUNT, 0);
+        m_renderingView.moveByPixels(MOVEMENT_PIXELS, 0);
         break;
 
     case sf::Keyboard::Up:
     case sf::Keyboard::W:
-        m_renderingView.moveBy(0, -MOVEMENT_AMOUNT);
+        m_renderingView.moveByPixels(0, -MOVEMENT_PIXELS);
         break;
 
     case sf::Keyboard::Down:
     case sf::Keyboard::S:
-        m_renderingView.moveBy(0, MOVEMENT_AMOUNT);
+        m_renderingView.moveByPixels(0, MOVEMENT_PIXELS);
         break;
 
     case sf::Keyboard::R:
@@ -137,6 +238,75 @@ void MandelbrotRenderer::handleKeys(const sf::Event& event)
         m_renderingView.zoomTo(1);
         break;
 
+    case sf::Keyboard::Z:
+        if (event.key.control && m_history.back(visited))
+        {
+            m_renderingView.jumpTo(visited);
+        }
+        break;
+
+    case sf::Keyboard::Y:
+        if (event.key.control && m_history.forward(visited))
+        {
+            m_renderingView.jumpTo(visited);
+        }
+        break;
+
+    case sf::Keyboard::C:
+        m_palette.cycle(PALETTE_CYCLE_AMOUNT);
+        m_paletteChanged = true;
+        break;
+
+    case sf::Keyboard::P:
+        m_palette.nextStyle();
+        m_paletteChanged = true;
+        break;
+
+    case sf::Keyboard::N:
+        m_palette.nextNormalisation();
+        m_paletteChanged = true;
+        break;
+
+    case sf::Keyboard::G:
+        // Render everything again with the other backend
+        m_gpuIsEnabled = !m_gpuIsEnabled;
+        m_completedIsValid = false;
+        m_history.clear();
+        m_renderingView.isDirty(true);
+        break;
+
+    case sf::Keyboard::M:
+        // Output is the same either way bar sub-pixel detail, so the
+        // completed render is kept. The engine is only set up by the
+        // rendering thread, when it starts the next job.
+        m_boundaryTracingIsEnabled = !m_boundaryTracingIsEnabled;
+        m_renderingView.isDirty(true);
+        break;
+
+    case sf::Keyboard::I:
+        // Also drops any limit set with + and -
+        m_iterationsAreAuto = !m_iterationsAreAuto;
+        m_manualMaxIterations = 0;
+        m_renderingView.isDirty(true);
+        break;
+
+    case sf::Keyboard::Equal:
+    case sf::Keyboard::Add:
+        ++m_iterationSteps;
+        m_renderingView.isDirty(true);
+        break;
+
+    case sf::Keyboard::Dash:
+    case sf::Keyboard::Subtract:
+        --m_iterationSteps;
+        m_renderingView.isDirty(true);
+        break;
+
+    case sf::Keyboard::F3:
+        m_statsAreShown = !m_statsAreShown;
+        m_statsToggled = true;
+        break;
+
     default:
         break;
     }
@@ -150,6 +320,8 @@ void MandelbrotRenderer::handleKeys(const sf::Event& event)
 /// <param name="event">Mouse Pressed Event Union</param>
 void MandelbrotRenderer::handleMousePressed(const sf::Event& event)
 {
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+
     switch (event.mouseButton.button)
     {
     case sf::Mouse::Left:
@@ -167,11 +339,17 @@ void MandelbrotRenderer::handleMousePressed(const sf::Event& event)
 
 /// <summary>
 /// When the mouse is moved, continue the box zoom so that it's updated
-/// shape can be drawn.
+/// shape can be drawn, and track the cursor position.
 /// </summary>
 /// <param name="event">Mouse Moved Event Union</param>
 void MandelbrotRenderer::handleMouseMoved(const sf::Event& event)
 {
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+
+    // Remember where the user is looking so it can be rendered first
+    m_cursor = Pixel(event.mouseMove.x, event.mouseMove.y);
+    m_cursorIsShown = true;
+
     m_renderingView.zoomBoxContinue(event.mouseMove.x, event.mouseMove.y);
 }
 
@@ -181,19 +359,24 @@ void MandelbrotRenderer::handleMouseMoved(const sf::Event& event)
 /// <param name="event">Mouse Released Event Union</param>
 void MandelbrotRenderer::handleMouseReleased(const sf::Event& event)
 {
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+
     if (event.mouseButton.button == sf::Mouse::Left)
         m_renderingView.zoomBoxEnd(event.mouseButton.x, event.mouseButton.y);
 }
 
 
 /// <summary>
-/// Zooms the view in and out with the mouse wheel.
+/// Zooms the view in and out with the mouse wheel. The drawing thread
+/// animates the zoom, see animate(), so each step is seen as a smooth zoom
+/// rather than a jump.
 /// </summary>
-/// <param name="event"></param>
-void MandelbrotRenderer::handleMouseWheel(const sf::Event& event)
+/// <param name="delta">The total wheel movement of the coalesced events</param>
+void MandelbrotRenderer::handleMouseWheel(float delta)
 {
     static const double ZOOM_AMOUNT = -1;
-    m_renderingView.zoomBy(event.mouseWheelScroll.delta * ZOOM_AMOUNT);
+    std::lock_guard<std::mutex> lock(m_inputMutex);
+    m_renderingView.zoomBy(delta * ZOOM_AMOUNT);
 }
 
 
@@ -222,9 +405,9 @@ void MandelbrotRenderer::handleResize(const sf::Event& event)
 /// <summary>
 /// Drawing Thread Entry Point
 /// Creates a pixel array and buffer to be rendered to.
-/// Creates several rendering threads to update the pixel array.
-/// Then in the drawing loop, terminates and launches rendering threads
-/// whenever the view is dirty and displays the pixel array in the window.
+/// Launches the rendering thread to update the pixel array.
+/// Then in the drawing loop, hands the rendering thread a new job whenever
+/// the view is dirty and displays the pixel array in the window.
 /// </summary>
 void MandelbrotRenderer::draw()
 {
@@ -237,60 +420,230 @@ void MandelbrotRenderer::draw()
     // The pixel array is created on the heap, otherwise stack overflow occurs.
     m_renderingPixels = new sf::Uint8[m_bufferSizeBytes];
     m_completedPixels = new sf::Uint8[m_bufferSizeBytes];
-    m_buffer.create(m_width, m_height);
-    m_sprite.setTexture(m_buffer);
-    m_completedView = m_renderingView;
+
+    // The iteration counts behind each pixel are kept so that the pixels can
+    // be coloured again without rendering them again
+    m_renderingIterations = new float[m_width * m_height];
+    m_completedIterations = new float[m_width * m_height];
+    m_engine.setTarget(m_renderingIterations, PixelRect(0, 0, m_width, m_height));
+    m_renderingTexture.create(m_width, m_height);
+    m_renderingSprite.setTexture(m_renderingTexture);
+    m_completedTexture.create(m_width, m_height);
+    m_completedSprite.setTexture(m_completedTexture);
+    m_completedIsStale = true;
+    m_tilePixels.reserve(4 * TileScheduler::TILE_SIZE * TileScheduler::TILE_SIZE);
+    m_gpuRenderer.create(m_width, m_height);
+    {
+        std::lock_guard<std::mutex> lock(m_inputMutex);
+        m_completedView = m_renderingView;
+        m_colouringPalette = m_palette;
+    }
+
+    for (Backdrop& backdrop : m_backdrops)
+    {
+        backdrop.texture.create(m_width, m_height);
+        backdrop.sprite.setTexture(backdrop.texture, true);
+    }
+
+    clearBackdrops();
+    m_displayedZoom = 0;
+    m_displayedOffset = DeltaComplex(0.0, 0.0);
+    m_animationTick = RenderStats::Clock::now();
+
+    // The rendering thread waits for jobs until the drawing loop ends
+    m_renderingIsStopping = false;
+    m_renderingIsIdle = true;
+    m_renderingThread.launch();
 
     // Drawing Loop
     while (m_window.isOpen() && !m_resizing)
     {
-        // Dirty view means changes have occured.
-        // Kill off any currently running rendering threads and relaunch
-        // them for the updated view
-        if (m_renderingView.isDirty())
+        // The event thread goes on changing the view, palette and cursor, so
+        // this loop works from a snapshot of them
+        View requestedView;
+        bool viewIsDirty;
+        bool zoomBoxIsShown;
+        sf::RectangleShape zoomBox;
+        bool paletteIsChanged;
+        Pixel focus;
         {
-            // Prevent rendering threads being relaunched every loop
-            m_renderingView.isDirty(false);
+            std::lock_guard<std::mutex> lock(m_inputMutex);
+            viewIsDirty = m_renderingView.isDirty();
+            if (viewIsDirty)
+            {
+                // Prevent rendering being restarted every loop
+                requestedView = m_renderingView;
+                m_renderingView.isDirty(false);
+            }
+
+            zoomBoxIsShown = m_renderingView.getZoomBoxIsShown();
+            if (zoomBoxIsShown)
+                zoomBox = m_renderingView.getZoomBoxShape();
+
+            paletteIsChanged = m_paletteChanged.exchange(false);
+            if (paletteIsChanged)
+                m_colouringPalette = m_palette;
+
+            // Render from the mouse if it is over the window, otherwise from
+            // the centre
+            focus = m_cursorIsShown ? m_cursor : Pixel(m_width / 2, m_height / 2);
+        }
 
+        // Dirty view means changes have occured.
+        // Abandon any rendering in progress and render the updated view
+        if (viewIsDirty)
+        {
             // Log the view of each rendering
-            std::cout << m_renderingView << std::endl;
+            std::cout << requestedView << std::endl;
+            m_history.visit(requestedView);
 
-            // No point running rendering threads for an outdated view
+            // No point rendering an outdated view. This returns straight
+            // away, and tiles the old rendering still finishes are ignored.
             cancelRendering();
-
-            // Do a rough draw before relaunching rendering threads
+            retargetAnimation(requestedView);
+            m_renderedView = requestedView;
+            const int iterationSetting = chooseIterationSetting(m_renderedView);
+            m_renderedIterationSetting = iterationSetting;
+            m_frameUploadSeconds = 0;
+            m_frameStatsArePending = true;
+
+            // Do a rough draw before rendering
             roughDraw();
             m_window.display();
 
             // Repeat the draw because of GL double buffering
-            m_window.clear();
-            m_window.draw(m_sprite);
+            roughDraw();
             m_window.display();
 
-            // Make pixels transparent until rendering threads set them
-#pragma omp parallel for
-            for (int i = 0; i < m_bufferSizeBytes; ++i)
-                m_renderingPixels[i] = 0;
+            const bool isKept = m_history.contains(m_renderedView, iterationSetting);
+            const bool isOnGpu = !isKept && m_gpuIsEnabled && m_gpuRenderer.canRender(m_renderedView);
+
+            if (isKept || (isOnGpu && iterationSetting != MandelbrotEngine::AUTO_ITERATIONS))
+            {
+                // Writing the rendering buffers from this thread has to wait
+                // for the abandoned rendering to stop, which is within about
+                // a pixel
+                waitUntilIdle();
+
+                if (isKept)
+                {
+                    // Recently completed views only need colouring again
+                    m_frameIsRenderedByEngine = false;
+                    m_frameStats.reset("history", m_renderedView.getPrecision(), 0);
+                    const auto start = RenderStats::Clock::now();
+                    m_history.load(m_renderedView, iterationSetting, m_renderingIterations, m_maxIterations);
+
+                    // The whole screen is a single pass
+                    m_frameStats.addPass(1, RenderStats::secondsSince(start));
+
+                    colourise(m_renderingIterations, m_renderingPixels, m_maxIterations, m_colouringPalette);
+                    m_renderingIsStale = true;
+                    m_renderingState = RenderingState::Completed;
+                }
+                else
+                {
+                    m_maxIterations = iterationSetting;
+                    renderOnGpu();
+                }
+            }
+            else
+            {
+                // Begin rendering, once the rendering thread has abandoned
+                // the last job. An automatic limit for the GPU is estimated
+                // there too, so this thread carries on drawing meanwhile.
+                Job job;
+                job.view = m_renderedView;
+                job.iterationSetting = iterationSetting;
+                job.palette = m_colouringPalette;
+                job.focus = focus;
+                job.boundaryTracingIsEnabled = m_boundaryTracingIsEnabled;
+                job.isEstimateOnly = isOnGpu;
+                startRendering(job);
+                m_frameIsRenderedByEngine = !isOnGpu;
+                m_renderingState = isOnGpu ? RenderingState::Estimating : RenderingState::Rendering;
+            }
+        }
+
+        // Shallow views are rendered on the GPU from this thread, which owns
+        // the GL context, once the rendering thread has chosen their limit
+        if (m_renderingState == RenderingState::Estimating && m_estimatedGeneration == m_generation)
+        {
+            waitUntilIdle();
+            renderOnGpu();
+        }
+
+        // While the displayed view is catching up with the rendered one,
+        // every tick is drawn, however long the rendering takes
+        const bool isAnimating = animate();
 
-            // Begin rendering
-            m_renderingState = RenderingState::Rendering;
-            m_renderingThread.launch();
+        const int bookmark = m_bookmarkToSave.exchange(0);
+        if (bookmark != 0)
+            saveBookmark(bookmark);
+
+        // Palette changes only need the stored iterations to be coloured again
+        if (paletteIsChanged)
+        {
+            colourise(m_completedIterations, m_completedPixels, m_completedMaxIterations, m_colouringPalette);
+            m_completedIsStale = true;
+            clearBackdrops();
+
+            // The rendering buffers are still being written by the rendering
+            // threads, so are recoloured once they finish
+            if (m_renderingState == RenderingState::Rendering || m_renderingState == RenderingState::Estimating)
+            {
+                m_recolourWhenCompleted = true;
+            }
+            else
+            {
+                colourise(m_renderingIterations, m_renderingPixels, m_maxIterations, m_colouringPalette);
+                m_renderingIsStale = true;
+
+                // Display the recoloured pixels again
+                if (m_renderingState == RenderingState::Displayed)
+                    m_renderingState = RenderingState::Completed;
+            }
+        }
+
+        // The rendering thread can finish at any moment, so the state is read
+        // once. Tiles it finished before it completed are then all in
+        // m_finishedTiles.
+        if (m_renderingState == RenderingState::Rendering && m_completedGeneration == m_generation)
+            m_renderingState = RenderingState::Completed;
+
+        const RenderingState state = m_renderingState;
+
+        if (state == RenderingState::Completed && m_recolourWhenCompleted)
+        {
+            m_recolourWhenCompleted = false;
+            colourise(m_renderingIterations, m_renderingPixels, m_maxIterations, m_colouringPalette);
+            m_renderingIsStale = true;
         }
 
         // Can avoid drawing anything if nothing has changed.
         bool shouldDisplay = false;
 
+        // Showing or hiding the overlay needs the displayed render drawn
+        // again underneath it
+        if (m_statsToggled.exchange(false) && state == RenderingState::Displayed && !zoomBoxIsShown)
+        {
+            m_window.clear();
+            drawReprojected(m_renderingSprite, m_renderedView);
+            shouldDisplay = true;
+        }
+
         // Draw the last completed view if anything will be superimposed on top of it
         // In other words, if the current rendering is incomplete so partially transparent,
         // or if the zoom box will require a redraw of the background.
-        if (m_renderingState == RenderingState::Rendering || m_renderingView.getZoomBoxIsShown())
+        if (state == RenderingState::Rendering || state == RenderingState::Estimating || zoomBoxIsShown || isAnimating)
         {
             roughDraw();
             shouldDisplay = true;
         }
 
-        // Draw the rendering buffer, unless it has already been displayed with no changes since.
-        if (m_renderingState != RenderingState::Displayed)
+        // Draw the rendering buffer, unless it has already been displayed with
+        // no changes since, or still holds the last view while its limit is
+        // estimated
+        if ((state != RenderingState::Displayed || isAnimating) && state != RenderingState::Estimating)
         {
             // Draw the partial or complete render
             detailedDraw();
@@ -298,26 +651,51 @@ void MandelbrotRenderer::draw()
         }
 
         // If the render has just been completed, copy it to the completed buffer
-        if (m_renderingState == RenderingState::Completed)
+        if (state == RenderingState::Completed)
         {
+            // Only the first completion of a frame is measured, not it being
+            // recoloured
+            if (m_frameStatsArePending)
+                recordStats();
+
+            // The render it replaces stays on the GPU, to be drawn around
+            // it when zooming out
+            if (m_completedIsValid && !(m_completedView == m_renderedView))
+                retireCompleted();
+
             // Keep a copy of this completed render for rough drawing when
             // moving the view
 #pragma omp parallel for
             for (int i = 0; i < m_bufferSizeBytes; ++i)
                 m_completedPixels[i] = m_renderingPixels[i];
 
+#pragma omp parallel for
+            for (int i = 0; i < m_width * m_height; ++i)
+                m_completedIterations[i] = m_renderingIterations[i];
+
             // Store the view for the last completed view, so it can be
             // correctly transformed when rough drawing
-            m_completedView = m_renderingView;
+            m_completedView = m_renderedView;
+            m_completedMaxIterations = m_maxIterations;
+            m_completedIterationSetting = m_renderedIterationSetting;
+            m_completedIsValid = true;
+            m_completedIsStale = true;
+
+            // Keep it for returning to this view later, which marks it as
+            // recently used if it was loaded from the history
+            m_history.store(m_completedView, m_completedIterationSetting, m_completedMaxIterations, m_completedIterations);
 
             // Prevent the completed buffer from being repeatedly displayed
             m_renderingState = RenderingState::Displayed;
         }
 
+        if (shouldDisplay && m_statsAreShown)
+            drawStats();
+
         // Display zoom box on top of everything if it should be shown
-        if (m_renderingView.getZoomBoxIsShown())
+        if (zoomBoxIsShown)
         {
-            m_window.draw(m_renderingView.getZoomBoxShape());
+            m_window.draw(zoomBox);
             shouldDisplay = true;
         }
 
@@ -325,107 +703,416 @@ void MandelbrotRenderer::draw()
             m_window.display();
     }
 
+    // Stop the rendering thread before freeing the buffers it writes to
+    stopRendering();
+
     // Free the buffers
     delete[] m_renderingPixels;
     delete[] m_completedPixels;
+    delete[] m_renderingIterations;
+    delete[] m_completedIterations;
 
     m_renderingPixels = nullptr;
     m_completedPixels = nullptr;
+    m_renderingIterations = nullptr;
+    m_completedIterations = nullptr;
 
     m_window.setActive(false);
 }
 
 
 /// <summary>
-/// Renders to the m_renderingPixels buffer.
-/// Can be made to return early by setting m_cancelling to true.
-/// This function increments m_renderingState when it finishes.
+/// Chooses the iteration limit to request for a view: the limit last set
+/// with + and -, otherwise either automatic or by zoom.
+/// Each + and - pressed since the last view doubles or halves the limit set
+/// before, or else the limit of the last completed render.
 /// </summary>
-void MandelbrotRenderer::render()
+/// <param name="view">The view to be rendered</param>
+/// <returns>The iteration limit, or MandelbrotEngine::AUTO_ITERATIONS to
+/// choose one when rendering</returns>
+int MandelbrotRenderer::chooseIterationSetting(const View& view)
 {
-    // Colour every pixel based on the Mandelbrot set
+    const int steps = m_iterationSteps.exchange(0);
+
+    if (steps != 0)
+    {
+        const int manual = m_manualMaxIterations;
+        long long limit = manual > 0 ? manual :
+                          m_completedIsValid ? m_completedMaxIterations :
+                          MandelbrotEngine::defaultMaxIterations(view);
+        const int shift = std::min(std::abs(steps), 24);
+        limit = steps > 0 ? limit << shift : limit >> shift;
+
+        m_manualMaxIterations = static_cast<int>(std::min<long long>(std::max<long long>(
+            limit, MandelbrotEngine::MIN_ITERATION_LIMIT), MandelbrotEngine::MAX_ITERATION_LIMIT));
+    }
+
+    if (m_manualMaxIterations > 0)
+        return m_manualMaxIterations;
+
+    return m_iterationsAreAuto ? MandelbrotEngine::AUTO_ITERATIONS : MandelbrotEngine::defaultMaxIterations(view);
+}
+
+
+/// <summary>
+/// Finds how far a view has been panned from the last completed render,
+/// if it has only moved by a whole number of pixels and still overlaps it.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="shift">Set to the pixel of the completed view at pixel
+/// (0, 0) of the view</param>
+/// <returns>True if the completed pixels can be shifted into place</returns>
+bool MandelbrotRenderer::getPanShift(const View& view, Pixel& shift) const
+{
+    return m_completedIsValid &&
+           view.getPixelShift(m_completedView, shift) &&
+           abs(shift.x) < m_width && abs(shift.y) < m_height;
+}
+
+
+/// <summary>
+/// Prepares the rendering buffers and m_renderingRegions for a new rendering.
+/// If the view has only moved by a whole number of pixels since the last
+/// completed render, the completed iterations are shifted into place so that
+/// only the newly exposed strips need to be rendered. Otherwise the whole
+/// screen is made transparent and will be rendered.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="palette">The palette to colour the shifted pixels with</param>
+void MandelbrotRenderer::prepareRendering(const View& view, const Palette& palette)
+{
+    Pixel shift;
+    m_renderingRegions.clear();
+
+    if (!getPanShift(view, shift) || m_completedMaxIterations != m_maxIterations)
+    {
+#pragma omp parallel for
+        for (int i = 0; i < m_width * m_height; ++i)
+            m_renderingIterations[i] = MandelbrotEngine::UNRENDERED;
+
+#pragma omp parallel for
+        for (int i = 0; i < m_bufferSizeBytes; ++i)
+            m_renderingPixels[i] = 0;
+
+        m_renderingRegions.push_back(PixelRect(0, 0, m_width, m_height));
+        return;
+    }
+
+    // Pixel (x, y) of the new view is pixel (x, y) + shift of the completed view
 #pragma omp parallel for
     for (int y = 0; y < m_height; ++y)
     {
-        // Check early exit flag
-        if (m_cancelling)
-            break;
+        float* row = m_renderingIterations + y * m_width;
+        const int sourceY = y + shift.y;
 
         for (int x = 0; x < m_width; ++x)
         {
-            // Convert screen pixel coordinate (x,y) to a complex number z
-            // in the view (x + yi)
-            Complex z = m_renderingView.complexAtPixel(x, y);
-
-            // Apply the Mandelbrot set to the complex number and get the
-            // proportion of iterations to the maximum until divergence.
-            // If m == 1, the number remained bounded, i.e. in the set.
-            double m = mandelbrot(z);
-
-            // Colour each pixel in the view based on the number of
-            // iterations to unbounded
-            // Default black colour if reached max iterations
-            sf::Color c;
-            if (m < 1)
-                c = hueToRGB(360 * m);
+            const int sourceX = x + shift.x;
+
+            if (sourceX >= 0 && sourceX < m_width && sourceY >= 0 && sourceY < m_height)
+                row[x] = m_completedIterations[sourceY * m_width + sourceX];
+            else
+                row[x] = MandelbrotEngine::UNRENDERED;
+        }
+    }
+
+    // The completed render has the same iteration limit
+    colourise(m_renderingIterations, m_renderingPixels, m_completedMaxIterations, palette);
+
+    // Exposed columns, over the full height
+    const int exposedWidth = abs(shift.x);
+    const int exposedLeft = shift.x > 0 ? m_width - exposedWidth : 0;
+    if (exposedWidth > 0)
+        m_renderingRegions.push_back(PixelRect(exposedLeft, 0, exposedWidth, m_height));
+
+    // Exposed rows, excluding the columns already covered
+    const int exposedHeight = abs(shift.y);
+    const int exposedTop = shift.y > 0 ? m_height - exposedHeight : 0;
+    const int rowsLeft = shift.x < 0 ? exposedWidth : 0;
+    if (exposedHeight > 0 && exposedWidth < m_width)
+        m_renderingRegions.push_back(PixelRect(rowsLeft, exposedTop, m_width - exposedWidth, exposedHeight));
+}
+
+
+/// <summary>
+/// Rendering Thread Entry Point
+/// Waits for jobs from startRendering() and renders each in turn, until
+/// stopRendering() is called. A job which is replaced while it is being
+/// rendered is abandoned as soon as the rendering threads notice.
+/// </summary>
+void MandelbrotRenderer::renderLoop()
+{
+    while (true)
+    {
+        Job job;
+        unsigned generation;
+
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_renderingIsIdle = true;
+            m_jobChanged.notify_all();
+
+            m_jobChanged.wait(lock, [this] { return m_renderingIsStopping || m_jobIsPending; });
+            if (m_renderingIsStopping)
+                return;
+
+            job = m_job;
+            generation = m_generation;
+
+            // Only a later job can cancel this one
+            m_jobIsPending = false;
+            m_renderingIsIdle = false;
+            m_cancelling = false;
+        }
+
+        render(job, generation);
+    }
+}
+
+
+/// <summary>
+/// Hands the rendering thread a job, replacing any job already in progress.
+/// Returns without waiting for the old job to stop.
+/// </summary>
+/// <param name="job">The view to render and everything it is rendered with,
+/// which the rendering thread takes its own copy of</param>
+void MandelbrotRenderer::startRendering(const Job& job)
+{
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    m_job = job;
+    m_jobIsPending = true;
+    ++m_generation;
+    m_cancelling = true;
+    m_jobChanged.notify_all();
+}
+
+
+/// <summary>
+/// Renders a job to the m_renderingIterations buffer, colouring each tile
+/// into m_renderingPixels as it finishes and queueing it to be drawn.
+/// Returns early if m_cancelling is set, which the rendering threads check
+/// between pixels. A job for the GPU only chooses its iteration limit.
+/// </summary>
+/// <param name="job">The view to render and everything it is rendered with</param>
+/// <param name="generation">The number of the job, which tags its tiles</param>
+void MandelbrotRenderer::render(const Job& job, unsigned generation)
+{
+    const View& view = job.view;
+    const int iterationSetting = job.iterationSetting;
+
+    // The buffers are only written by this thread until the job completes.
+    // A panned view keeps the automatic limit of the completed render, so
+    // that its pixels can be reused.
+    Pixel shift;
+    if (iterationSetting != MandelbrotEngine::AUTO_ITERATIONS)
+        m_maxIterations = iterationSetting;
+    else if (m_completedIterationSetting == MandelbrotEngine::AUTO_ITERATIONS && getPanShift(view, shift))
+        m_maxIterations = m_completedMaxIterations;
+    else
+        m_maxIterations = m_engine.estimateMaxIterations(view, MandelbrotEngine::defaultMaxIterations(view), m_cancelling);
+
+    if (m_cancelling)
+        return;
+
+    if (job.isEstimateOnly)
+    {
+        m_estimatedGeneration = generation;
+        return;
+    }
+
+    // Reuse the last completed render if possible, otherwise make
+    // pixels transparent until the rendering threads set them
+    prepareRendering(view, job.palette);
+
+    // Every pixel may have changed
+    if (!m_finishedTiles.push(PixelRect(0, 0, m_width, m_height), generation))
+        m_overflowedGeneration = generation;
+
+    m_engine.setBoundaryTracingIsEnabled(job.boundaryTracingIsEnabled);
+    m_engine.prepare(view, m_maxIterations);
+
+    // Colour every pixel based on the Mandelbrot set, starting from where
+    // the mouse was when the job was started
+    m_engine.render(m_renderingRegions, job.focus, MandelbrotEngine::COARSEST_STEP, m_cancelling,
+                    [this, &job, generation](const PixelRect& tile)
+                    {
+                        colourRegion(tile, m_renderingIterations, m_renderingPixels, m_maxIterations, job.palette);
+
+                        // Should the drawing thread fall behind, it uploads
+                        // every pixel instead
+                        if (!m_finishedTiles.push(tile, generation))
+                            m_overflowedGeneration = generation;
+                    });
+
+    // Rendering now complete, unless it was abandoned
+    if (!m_cancelling)
+        m_completedGeneration = generation;
+}
+
+
+/// <summary>
+/// Colours a region of a pixel buffer from the iteration buffer using the
+/// given palette. Pixels which have not been rendered are transparent.
+/// Each thread colours with its own copy of the palette, as the event
+/// thread may change m_palette at any time.
+/// </summary>
+/// <param name="region">The region of the screen to colour</param>
+/// <param name="iterations">The iteration buffer to read</param>
+/// <param name="pixels">The pixel buffer to write</param>
+/// <param name="maxIterations">The iteration limit the region was rendered
+/// with</param>
+/// <param name="palette">The palette to colour with</param>
+void MandelbrotRenderer::colourRegion(const PixelRect& region, const float* iterations,
+                                      sf::Uint8* pixels, int maxIterations, const Palette& palette) const
+{
+    for (int y = region.top; y < region.top + region.height; ++y)
+    {
+        for (int x = region.left; x < region.left + region.width; ++x)
+        {
+            const int i = y * m_width + x;
+            sf::Uint8* currentPixel = pixels + 4 * i;
+
+            if (iterations[i] == MandelbrotEngine::UNRENDERED)
+            {
+                currentPixel[0] = currentPixel[1] = currentPixel[2] = currentPixel[3] = 0;
+                continue;
+            }
 
             // Colour in the buffer
-            sf::Uint8 *currentPixel = m_renderingPixels + 4 * (y * m_width + x);
+            sf::Color c = palette.colour(iterations[i], maxIterations);
             currentPixel[0] = c.r;
             currentPixel[1] = c.g;
             currentPixel[2] = c.b;
             currentPixel[3] = 0xFFu;
         }
     }
+}
+
+/// <summary>
+/// Colours the whole of a pixel buffer from the iteration buffer in parallel.
+/// </summary>
+/// <param name="iterations">The iteration buffer to read</param>
+/// <param name="pixels">The pixel buffer to write</param>
+/// <param name="maxIterations">The iteration limit the buffer was rendered
+/// with</param>
+/// <param name="palette">The palette to colour with</param>
+void MandelbrotRenderer::colourise(const float* iterations, sf::Uint8* pixels, int maxIterations,
+                                   const Palette& palette) const
+{
+#pragma omp parallel for
+    for (int y = 0; y < m_height; ++y)
+        colourRegion(PixelRect(0, y, m_width, 1), iterations, pixels, maxIterations, palette);
+}
+
 
-    // Rendering now complete
+/// <summary>
+/// Renders the rendered view on the GPU with m_maxIterations, colours it and
+/// marks it completed. Must be called from the drawing thread, which owns
+/// the GL context, with the rendering thread idle.
+/// </summary>
+void MandelbrotRenderer::renderOnGpu()
+{
+    m_frameIsRenderedByEngine = false;
+    m_frameStats.reset("gpu", m_renderedView.getPrecision(), 0);
+    const auto start = RenderStats::Clock::now();
+
+    m_gpuRenderer.render(m_renderedView, m_maxIterations, m_renderingIterations);
+
+    // The whole screen is a single pass
+    m_frameStats.addPass(1, RenderStats::secondsSince(start));
+
+    colourise(m_renderingIterations, m_renderingPixels, m_maxIterations, m_colouringPalette);
+    m_renderingIsStale = true;
     m_renderingState = RenderingState::Completed;
 }
 
 
 /// <summary>
-/// Sets a flag to cause the rendering thread to exit early and waits for it to finish.
+/// Sets a flag to cause the rendering thread to abandon its job, without
+/// waiting for it to do so.
 /// </summary>
 void MandelbrotRenderer::cancelRendering()
 {
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    m_jobIsPending = false;
+    ++m_generation;
     m_cancelling = true;
-    m_renderingThread.wait();
-    m_cancelling = false;
 }
 
 
 /// <summary>
-/// Iterates a complex number z using the Mandelbrot Set function
-/// z[n+1] := z[n]^2 + z[0]
-/// and returns the number of iterations until the number becomes unbounded,
-/// divided by the maximum number of iterations.
+/// Waits for the rendering thread to finish or abandon its job, so that the
+/// rendering buffers can be written from another thread.
 /// </summary>
-/// <param name="z0">The complex number to evaluate</param>
-/// <returns>Ratio of iterations until unbounded</returns>
-double MandelbrotRenderer::mandelbrot(const Complex z0)
+void MandelbrotRenderer::waitUntilIdle()
 {
-    const int MAX_ITERATIONS = 120 - (10 * static_cast<int>(m_renderingView.getZoom()));
-    constexpr double THRESHOLD = 16.0;
-    static const Real TWO = 2.0;
+    std::unique_lock<std::mutex> lock(m_jobMutex);
+    m_jobChanged.wait(lock, [this] { return m_renderingIsIdle && !m_jobIsPending; });
+}
 
-    // Initialise the iterated complex number at z0
-    Complex z(z0);
 
-    // Track the number of iterations until z becomes unbounded
-    for (int n = 0; n < MAX_ITERATIONS; n++)
+/// <summary>
+/// Abandons any job and waits for the rendering thread to exit.
+/// </summary>
+void MandelbrotRenderer::stopRendering()
+{
     {
-        // The Mandelbrot set is given by iteration of:
-        // z[n+1] := z[n]^2 + z[0]
-        // Handling the real and imaginary parts separately:
-        z = Complex(z.x * z.x - z.y * z.y + z0.x,
-                    TWO * z.x * z.y + z0.y);
-
-        // z is approximately unbounded if its magnitude exceeds some threshold
-        if (z.x * z.x + z.y * z.y > THRESHOLD)
-            return static_cast<double>(n) / static_cast<double>(MAX_ITERATIONS);
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_renderingIsStopping = true;
+        m_cancelling = true;
+        m_jobChanged.notify_all();
     }
 
-    return 1.0;
+    m_renderingThread.wait();
+}
+
+
+/// <summary>
+/// Uploads the changed rendering pixels to the rendering texture.
+/// Only the tiles finished since the last upload are copied, unless every
+/// pixel has changed. A texture can only be updated from contiguous pixels,
+/// so the rows of each tile are gathered into m_tilePixels first.
+/// </summary>
+void MandelbrotRenderer::uploadRendering()
+{
+    if (m_overflowedGeneration.exchange(0) == m_generation)
+        m_renderingIsStale = true;
+
+    if (m_renderingIsStale)
+    {
+        // Any tiles queued so far are included
+        m_renderingIsStale = false;
+        m_finishedTiles.clear();
+        m_renderingTexture.update(m_renderingPixels);
+        return;
+    }
+
+    PixelRect tile;
+    unsigned generation;
+    while (m_finishedTiles.pop(tile, generation))
+    {
+        // Tiles of abandoned renderings may be partly written
+        if (generation != m_generation)
+            continue;
+
+        // Whole rows are already contiguous
+        if (tile.width == m_width)
+        {
+            m_renderingTexture.update(m_renderingPixels + 4 * tile.top * m_width, tile.width, tile.height, 0, tile.top);
+            continue;
+        }
+
+        const int rowBytes = 4 * tile.width;
+        m_tilePixels.resize(rowBytes * tile.height);
+
+        for (int y = 0; y < tile.height; ++y)
+        {
+            const sf::Uint8* row = m_renderingPixels + 4 * ((tile.top + y) * m_width + tile.left);
+            std::copy(row, row + rowBytes, m_tilePixels.data() + y * rowBytes);
+        }
+
+        m_renderingTexture.update(m_tilePixels.data(), tile.width, tile.height, tile.left, tile.top);
+    }
 }
 
 
@@ -436,61 +1123,268 @@ double MandelbrotRenderer::mandelbrot(const Complex z0)
 /// </summary>
 void MandelbrotRenderer::detailedDraw()
 {
-    m_buffer.update(m_renderingPixels);
-    m_sprite.setPosition(0, 0);
-    m_sprite.setScale(1, 1);
-    m_window.draw(m_sprite);
+    const auto start = RenderStats::Clock::now();
+    uploadRendering();
+    m_frameUploadSeconds += RenderStats::secondsSince(start);
+    drawReprojected(m_renderingSprite, m_renderedView);
 }
 
 
 /// <summary>
-/// Draw the pixels from the last completed rendering.
-/// The image will be offset and scaled from the completed view to the current view.
+/// Draw the pixels from the last completed rendering, over the backdrops of
+/// renders completed before it.
+/// Each is offset and scaled from its own view to the displayed view.
 /// </summary>
 void MandelbrotRenderer::roughDraw()
 {
-    m_buffer.update(m_completedPixels);
+    // Only upload the completed pixels after they change
+    if (m_completedIsStale)
+    {
+        const auto start = RenderStats::Clock::now();
+        m_completedTexture.update(m_completedPixels);
+        m_completedIsStale = false;
+        m_frameUploadSeconds += RenderStats::secondsSince(start);
+    }
 
-    Pixel roughPosition = m_renderingView.pixelAtComplex(
-        m_completedView.getViewport().left,
-        m_completedView.getViewport().top);
+    m_window.clear();
 
-    m_sprite.setPosition(static_cast<float>(roughPosition.x),
-                         static_cast<float>(roughPosition.y));
+    // The widest backdrops go underneath, so the most detailed one of any
+    // region is the one on top
+    std::array<Backdrop*, BACKDROP_COUNT> backdrops;
+    int count = 0;
+    for (Backdrop& backdrop : m_backdrops)
+        if (backdrop.isValid)
+            backdrops[count++] = &backdrop;
 
-    Real roughScale = m_completedView.getScale() / m_renderingView.getScale();
+    std::sort(backdrops.begin(), backdrops.begin() + count, [](const Backdrop* a, const Backdrop* b) {
+        return a->view.getScale() > b->view.getScale();
+    });
 
-    m_sprite.setScale(static_cast<float>(roughScale),
-                      static_cast<float>(roughScale));
+    for (int i = 0; i < count; ++i)
+        drawReprojected(backdrops[i]->sprite, backdrops[i]->view);
 
-    m_window.clear();
-    m_window.draw(m_sprite);
+    drawReprojected(m_completedSprite, m_completedView);
 }
 
 
 /// <summary>
-/// Converts a value for hue at max saturation and brightness to RGB format
+/// Starts animating from the displayed view to a view about to be rendered.
+/// The displayed view is held as a zoom and offset from the rendered view,
+/// in doubles, so it can be moved every tick without touching arbitrary
+/// precision. Views too far from the displayed one to zoom or pan to
+/// smoothly, such as bookmarks, are jumped to.
+/// </summary>
+/// <param name="view">The view which is about to be rendered</param>
+void MandelbrotRenderer::retargetAnimation(const View& view)
+{
+    const Real scale = view.getScale();
+    const double ratio = static_cast<double>(m_renderedView.getScale() / scale);
+
+    // The displayed view relative to the new view, rather than the old one
+    m_displayedZoom += std::log2(ratio);
+    m_displayedOffset = DeltaComplex(
+        static_cast<double>((m_renderedView.getCentre().x - view.getCentre().x) / scale) + ratio * m_displayedOffset.x,
+        static_cast<double>((m_renderedView.getCentre().y - view.getCentre().y) / scale) + ratio * m_displayedOffset.y);
+
+    if (view.getScreenSize() != m_renderedView.getScreenSize() ||
+        !(std::abs(m_displayedZoom) <= MAX_ANIMATED_OCTAVES) ||
+        !(std::abs(m_displayedOffset.x) <= MAX_ANIMATED_OFFSET) ||
+        !(std::abs(m_displayedOffset.y) <= MAX_ANIMATED_OFFSET))
+    {
+        m_displayedZoom = 0;
+        m_displayedOffset = DeltaComplex(0.0, 0.0);
+    }
+
+    m_animationTick = RenderStats::Clock::now();
+}
+
+/// <summary>
+/// Moves the displayed view towards the rendered view by the time since the
+/// last tick, closing the same share of the distance in each
+/// ZOOM_ANIMATION_SECONDS, so the animation keeps pace with the display
+/// whatever the frame rate. Once within a fraction of a pixel, the rendered
+/// view is displayed as it is.
 /// </summary>
-/// <param name="h">Hue value for the colour, range 0:360</param>
-/// <returns>Colour in RGB format</returns>
-sf::Color hueToRGB(double h) {
-    sf::Uint8 x = static_cast<sf::Uint8>(0xFF * (1 - abs(fmod((h / 60.0), 2) - 1.0)));
+/// <returns>True if the displayed view moved, so has to be drawn</returns>
+bool MandelbrotRenderer::animate()
+{
+    const double elapsed = RenderStats::secondsSince(m_animationTick);
+    m_animationTick = RenderStats::Clock::now();
+
+    if (m_displayedZoom == 0 && m_displayedOffset == DeltaComplex(0.0, 0.0))
+        return false;
+
+    const double remaining = std::exp(-elapsed / ZOOM_ANIMATION_SECONDS);
+    m_displayedZoom *= remaining;
+    m_displayedOffset *= remaining;
 
-    switch (static_cast<int>(h) / 60)
+    // The offset is in half heights of the screen, and the screen's edge
+    // moves by about a pixel for each 1 / height of an octave
+    if (std::abs(m_displayedZoom) * m_height < 0.5 &&
+        std::abs(m_displayedOffset.x) * m_height < 0.5 && std::abs(m_displayedOffset.y) * m_height < 0.5)
     {
-    case 0:
-        return sf::Color(0xFF, x, 0);
-    case 1:
-        return sf::Color(x, 0xFF, 0);
-    case 2:
-        return sf::Color(0, 0xFF, x);
-    case 3:
-        return sf::Color(0, x, 0xFF);
-    case 4:
-        return sf::Color(x, 0, 0xFF);
-    case 5:
-        return sf::Color(0xFF, 0, x);
-    default:
-        return sf::Color();
+        m_displayedZoom = 0;
+        m_displayedOffset = DeltaComplex(0.0, 0.0);
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Draws a sprite of a frame rendered for one view where that view lies in
+/// the displayed view, which the GPU scales it to. Frames too far in or out
+/// to be drawn meaningfully are skipped.
+/// </summary>
+/// <param name="sprite">The sprite of the frame, the size of the screen</param>
+/// <param name="view">The view the frame was rendered for</param>
+/// <returns>True if the frame was drawn</returns>
+bool MandelbrotRenderer::drawReprojected(sf::Sprite& sprite, const View& view)
+{
+    const Real renderedScale = m_renderedView.getScale();
+    const double toDisplayed = std::exp2(-m_displayedZoom);
+    const double scale = static_cast<double>(view.getScale() / renderedScale) * toDisplayed;
+
+    // Offset of the frame's centre from the displayed centre, in half heights
+    const double offsetX = (static_cast<double>((view.getCentre().x - m_renderedView.getCentre().x) / renderedScale) -
+                            m_displayedOffset.x) * toDisplayed;
+    const double offsetY = (static_cast<double>((view.getCentre().y - m_renderedView.getCentre().y) / renderedScale) -
+                            m_displayedOffset.y) * toDisplayed;
+
+    if (!(scale <= MAX_SPRITE_SCALE && scale * MAX_SPRITE_SCALE >= 1) ||
+        !(std::abs(offsetX) <= MAX_SPRITE_SCALE) || !(std::abs(offsetY) <= MAX_SPRITE_SCALE))
+        return false;
+
+    sprite.setOrigin(m_width / 2.0f, m_height / 2.0f);
+    sprite.setPosition(static_cast<float>(m_width / 2.0 + offsetX * m_height / 2.0),
+                       static_cast<float>(m_height / 2.0 + offsetY * m_height / 2.0));
+    sprite.setScale(static_cast<float>(scale), static_cast<float>(scale));
+    m_window.draw(sprite);
+    return true;
+}
+
+/// <summary>
+/// Keeps the completed render, which is about to be replaced, as a backdrop.
+/// It replaces the backdrop within an octave of its zoom, so one is kept for
+/// each level zoomed in through, otherwise the one retired longest ago.
+/// </summary>
+void MandelbrotRenderer::retireCompleted()
+{
+    Backdrop* replaced = &m_backdrops[0];
+
+    for (Backdrop& backdrop : m_backdrops)
+    {
+        if (!backdrop.isValid)
+        {
+            replaced = &backdrop;
+            break;
+        }
+
+        const double ratio = static_cast<double>(backdrop.view.getScale() / m_completedView.getScale());
+        if (ratio > 0.5 && ratio < 2.0)
+        {
+            replaced = &backdrop;
+            break;
+        }
+
+        if (backdrop.retired < replaced->retired)
+            replaced = &backdrop;
     }
+
+    const auto start = RenderStats::Clock::now();
+    replaced->texture.update(m_completedPixels);
+    m_frameUploadSeconds += RenderStats::secondsSince(start);
+
+    replaced->view = m_completedView;
+    replaced->retired = ++m_backdropsRetired;
+    replaced->isValid = true;
+}
+
+/// <summary>
+/// Discards the backdrops, such as when the palette changes, as they could
+/// not be coloured again.
+/// </summary>
+void MandelbrotRenderer::clearBackdrops()
+{
+    for (Backdrop& backdrop : m_backdrops)
+        backdrop.isValid = false;
+}
+
+
+/// <summary>
+/// Completes the statistics of the frame which has just finished rendering
+/// and writes them to the log.
+/// The rendering thread has finished with the engine's statistics by then,
+/// and cannot start on them again until the next job is started from this
+/// thread.
+/// </summary>
+void MandelbrotRenderer::recordStats()
+{
+    m_frameStatsArePending = false;
+
+    if (m_frameIsRenderedByEngine)
+        m_frameStats = m_engine.getStats();
+
+    m_frameStats.addUploadSeconds(m_frameUploadSeconds);
+    m_frameStats.countIterations(m_renderingIterations, m_width * m_height, m_maxIterations);
+    m_frameStats.log(std::cout);
+}
+
+
+/// <summary>
+/// Draws the statistics of the last completed frame over the top left of
+/// the window, with a bar for each rendering thread showing the share of
+/// the frame it was busy for.
+/// </summary>
+void MandelbrotRenderer::drawStats()
+{
+    const std::string summary = m_frameStats.summary();
+    const std::vector<RenderStats::Thread>& threads = m_frameStats.getThreads();
+    const int lines = m_statsFontIsLoaded ? static_cast<int>(std::count(summary.begin(), summary.end(), '\n')) : 0;
+    const float textHeight = lines * STATS_LINE_HEIGHT;
+    const float barsHeight = threads.size() * 2 * STATS_BAR_HEIGHT;
+
+    sf::RectangleShape background(sf::Vector2f(2 * STATS_BAR_WIDTH + 2 * STATS_MARGIN,
+                                               textHeight + barsHeight + 2 * STATS_MARGIN));
+    background.setFillColor(sf::Color(0, 0, 0, 160));
+    m_window.draw(background);
+
+    if (m_statsFontIsLoaded)
+    {
+        m_statsText.setString(summary);
+        m_statsText.setPosition(STATS_MARGIN, STATS_MARGIN);
+        m_window.draw(m_statsText);
+    }
+
+    sf::RectangleShape idle(sf::Vector2f(STATS_BAR_WIDTH, STATS_BAR_HEIGHT));
+    idle.setFillColor(sf::Color(96, 96, 96));
+    sf::RectangleShape busy;
+    busy.setFillColor(sf::Color(64, 192, 64));
+
+    for (int i = 0; i < static_cast<int>(threads.size()); ++i)
+    {
+        const float y = STATS_MARGIN + textHeight + i * 2 * STATS_BAR_HEIGHT;
+        const double total = threads[i].busySeconds + m_frameStats.getIdleSeconds(i);
+        const double share = total > 0 ? threads[i].busySeconds / total : 0;
+
+        idle.setPosition(STATS_MARGIN, y);
+        m_window.draw(idle);
+
+        busy.setSize(sf::Vector2f(static_cast<float>(share * STATS_BAR_WIDTH), STATS_BAR_HEIGHT));
+        busy.setPosition(STATS_MARGIN, y);
+        m_window.draw(busy);
+    }
+}
+
+
+/// <summary>
+/// Bookmarks the view last given to the rendering thread with the iteration
+/// limit it was given, and logs the bookmark so it can be copied.
+/// </summary>
+/// <param name="slot">The slot, from 1 to Bookmarks::SLOT_COUNT</param>
+void MandelbrotRenderer::saveBookmark(int slot)
+{
+    if (m_bookmarks.set(slot, m_renderedView, m_renderedIterationSetting))
+        std::cout << "Bookmark " << Bookmarks::format(slot, m_renderedView, m_renderedIterationSetting) << std::endl;
+    else
+        std::cout << "Could not save bookmark " << slot << std::endl;
 }
@@ -1,55 +1,175 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "View.hpp"
+#include "Bookmarks.hpp"
+#include "Palette.hpp"
+#include "GpuRenderer.hpp"
+#include "MandelbrotEngine.hpp"
+#include "RenderHistory.hpp"
+#include "RenderStats.hpp"
+#include "TileQueue.hpp"
 
 class MandelbrotRenderer
 {
 public:
-    MandelbrotRenderer(int width, int height);
+    MandelbrotRenderer(int width, int height, size_t historyBudgetBytes, const std::string& cacheDirectory);
     ~MandelbrotRenderer();
     void run();
 
 private:
+    static constexpr int FINISHED_TILE_CAPACITY = 4096;
+    static constexpr unsigned STATS_CHARACTER_SIZE = 12;
+    static constexpr float STATS_LINE_HEIGHT = 15.0f;
+    static constexpr float STATS_MARGIN = 8.0f;
+    static constexpr float STATS_BAR_WIDTH = 200.0f;
+    static constexpr float STATS_BAR_HEIGHT = 6.0f;
+    static constexpr double ZOOM_ANIMATION_SECONDS = 0.12;
+    static constexpr double MAX_ANIMATED_OCTAVES = 8.0;
+    static constexpr double MAX_ANIMATED_OFFSET = 4.0;
+    static constexpr double MAX_SPRITE_SCALE = 4096.0;
+    static constexpr int BACKDROP_COUNT = 4;
+
     enum class RenderingState
     {
+        Estimating,
         Rendering,
         Completed,
         Displayed
     };
 
+    struct Backdrop
+    {
+        sf::Texture texture;
+        sf::Sprite sprite;
+        View view;
+        unsigned retired = 0;
+        bool isValid = false;
+    };
+
+    struct Job
+    {
+        View view;
+        int iterationSetting = 0;
+        Palette palette;
+        Pixel focus;
+        bool boundaryTracingIsEnabled = false;
+        bool isEstimateOnly = false;
+    };
+
     int m_width;
     int m_height;
     int m_bufferSizeBytes;
     sf::RenderWindow m_window;
     sf::Thread m_drawingThread;
     sf::Thread m_renderingThread;
-    sf::Texture m_buffer;
-    sf::Sprite m_sprite;
+    sf::Texture m_renderingTexture;
+    sf::Sprite m_renderingSprite;
+    sf::Texture m_completedTexture;
+    sf::Sprite m_completedSprite;
     sf::Uint8* m_renderingPixels;
     sf::Uint8* m_completedPixels;
+    float* m_renderingIterations;
+    float* m_completedIterations;
+    std::mutex m_inputMutex;
+    Palette m_palette;
+    Palette m_colouringPalette;
+    std::atomic<bool> m_paletteChanged{ false };
+    bool m_recolourWhenCompleted = false;
     View m_renderingView;
     View m_completedView;
-    bool m_cancelling = false;
-    bool m_resizing = false;
-    RenderingState m_renderingState = RenderingState::Rendering;
+    std::atomic<bool> m_completedIsValid{ false };
+    View m_renderedView;
+    double m_displayedZoom = 0;
+    DeltaComplex m_displayedOffset;
+    RenderStats::Clock::time_point m_animationTick;
+    std::array<Backdrop, BACKDROP_COUNT> m_backdrops;
+    unsigned m_backdropsRetired = 0;
+    RenderHistory m_history;
+    std::vector<PixelRect> m_renderingRegions;
+    TileQueue m_finishedTiles;
+    bool m_renderingIsStale = true;
+    std::atomic<unsigned> m_overflowedGeneration{ 0 };
+    bool m_completedIsStale = true;
+    std::vector<sf::Uint8> m_tilePixels;
+    GpuRenderer m_gpuRenderer;
+    std::atomic<bool> m_gpuIsEnabled{ true };
+    std::atomic<bool> m_boundaryTracingIsEnabled{ false };
+    std::unique_ptr<TileCache> m_tileCache;
+    MandelbrotEngine m_engine;
+    int m_maxIterations = 0;
+    int m_completedMaxIterations = 0;
+    int m_renderedIterationSetting = 0;
+    int m_completedIterationSetting = 0;
+    std::atomic<bool> m_iterationsAreAuto{ true };
+    std::atomic<int> m_manualMaxIterations{ 0 };
+    std::atomic<int> m_iterationSteps{ 0 };
+    Pixel m_cursor;
+    bool m_cursorIsShown = false;
+    std::atomic<bool> m_cancelling{ false };
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobChanged;
+    Job m_job;
+    bool m_jobIsPending = false;
+    bool m_renderingIsIdle = true;
+    bool m_renderingIsStopping = false;
+    std::atomic<unsigned> m_generation{ 0 };
+    std::atomic<unsigned> m_completedGeneration{ 0 };
+    std::atomic<unsigned> m_estimatedGeneration{ 0 };
+    std::atomic<bool> m_resizing{ false };
+    std::atomic<RenderingState> m_renderingState{ RenderingState::Rendering };
+    RenderStats m_frameStats;
+    bool m_frameStatsArePending = false;
+    bool m_frameIsRenderedByEngine = false;
+    double m_frameUploadSeconds = 0;
+    sf::Font m_statsFont;
+    bool m_statsFontIsLoaded = false;
+    sf::Text m_statsText;
+    std::atomic<bool> m_statsAreShown{ false };
+    std::atomic<bool> m_statsToggled{ false };
+    Bookmarks m_bookmarks;
+    std::atomic<int> m_bookmarkToSave{ 0 };
 
     void handleEvents();
     void handleKeys(const sf::Event& event);
     void handleMousePressed(const sf::Event& event);
     void handleMouseMoved(const sf::Event& event);
     void handleMouseReleased(const sf::Event& event);
-    void handleMouseWheel(const sf::Event& event);
+    void handleMouseWheel(float delta);
     void handleResize(const sf::Event& event);
 
     void draw();
-    void render();
+    int chooseIterationSetting(const View& view);
+    bool getPanShift(const View& view, Pixel& shift) const;
+    void prepareRendering(const View& view, const Palette& palette);
+    void renderLoop();
+    void startRendering(const Job& job);
+    void render(const Job& job, unsigned generation);
+    void renderOnGpu();
+    void colourRegion(const PixelRect& region, const float* iterations, sf::Uint8* pixels, int maxIterations,
+                      const Palette& palette) const;
+    void colourise(const float* iterations, sf::Uint8* pixels, int maxIterations, const Palette& palette) const;
     void cancelRendering();
-    double mandelbrot(const Complex z0);
+    void waitUntilIdle();
+    void stopRendering();
+    void uploadRendering();
     void detailedDraw();
     void roughDraw();
+    void retargetAnimation(const View& view);
+    bool animate();
+    bool drawReprojected(sf::Sprite& sprite, const View& view);
+    void retireCompleted();
+    void clearBackdrops();
+    void recordStats();
+    void drawStats();
+    void saveBookmark(int slot);
 
 
 };
-
-sf::Color hueToRGB(double h);
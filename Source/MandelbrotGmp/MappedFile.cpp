@@ -0,0 +1,85 @@
+#include "MappedFile.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/// <summary>
+/// Maps a file read only into memory, so it is read through the mapping
+/// rather than copied into a buffer by the C runtime. The file may still be
+/// open for writing elsewhere, but only what it held when mapped is seen.
+/// </summary>
+/// <param name="path">The file to map, which is empty if it cannot be</param>
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        return;
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+        return;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data != nullptr)
+        m_size = static_cast<size_t>(size.QuadPart);
+#else
+    m_file = open(path.c_str(), O_RDONLY);
+    if (m_file < 0)
+        return;
+
+    struct stat status;
+    if (fstat(m_file, &status) != 0 || status.st_size == 0)
+        return;
+
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data != MAP_FAILED)
+    {
+        m_data = data;
+        m_size = static_cast<size_t>(status.st_size);
+    }
+#endif
+}
+
+/// <summary>
+/// Unmaps and closes the file.
+/// </summary>
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+#else
+    if (m_data != nullptr)
+        munmap(m_data, m_size);
+    if (m_file >= 0)
+        close(m_file);
+#endif
+}
+
+
+/// <summary>
+/// Getter for the mapped contents.
+/// </summary>
+/// <returns>The start of the file, or null if it could not be mapped</returns>
+const char* MappedFile::getData() const { return static_cast<const char*>(m_data); }
+
+/// <summary>
+/// Getter for the mapped size.
+/// </summary>
+/// <returns>The size of the file in bytes, or 0 if it could not be mapped</returns>
+size_t MappedFile::getSize() const { return m_size; }
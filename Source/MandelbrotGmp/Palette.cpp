@@ -0,0 +1,146 @@
+#include "Palette.hpp"
+#include <cmath>
+
+
+/// <summary>
+/// Maps iteration counts to colours. Colouring is kept separate from
+/// rendering so that the palette can be changed without iterating any pixels
+/// again.
+/// </summary>
+Palette::Palette() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Palette::~Palette() {}
+
+
+/// <summary>
+/// Converts the number of iterations a pixel took to become unbounded to
+/// its colour.
+/// </summary>
+/// <param name="iterations">Number of iterations until unbounded</param>
+/// <param name="maxIterations">The iteration limit the pixel was rendered
+/// with</param>
+/// <returns>Colour of the pixel, black if it remained bounded</returns>
+sf::Color Palette::colour(float iterations, int maxIterations) const
+{
+    // Default black colour if reached max iterations
+    if (iterations >= maxIterations)
+        return sf::Color();
+
+    // Position in the palette in the range 0:1
+    double t = m_normalisation == Normalisation::MaxIterations
+             ? static_cast<double>(iterations) / static_cast<double>(maxIterations)
+             : static_cast<double>(iterations) / FIXED_PERIOD;
+    t += m_offset;
+    t -= floor(t);
+
+    switch (m_style)
+    {
+    case Style::Fire:
+    {
+        // Black through red and yellow to white
+        auto channel = [t](double start)
+        {
+            return static_cast<sf::Uint8>(0xFF * fmin(fmax(3 * t - start, 0.0), 1.0));
+        };
+        return sf::Color(channel(0), channel(1), channel(2));
+    }
+
+    case Style::Greyscale:
+    {
+        // Dark to light and back again so the palette wraps smoothly
+        sf::Uint8 v = static_cast<sf::Uint8>(0xFF * (1 - fabs(2 * t - 1)));
+        return sf::Color(v, v, v);
+    }
+
+    default:
+        return hueToRGB(360 * t);
+    }
+}
+
+
+/// <summary>
+/// Getter for the style of palette
+/// </summary>
+/// <returns>The style</returns>
+Palette::Style Palette::getStyle() const { return m_style; }
+
+/// <summary>
+/// Switches to the next style of palette, wrapping back to the first.
+/// </summary>
+void Palette::nextStyle()
+{
+    switch (m_style)
+    {
+    case Style::Rainbow:
+        m_style = Style::Fire;
+        break;
+
+    case Style::Fire:
+        m_style = Style::Greyscale;
+        break;
+
+    default:
+        m_style = Style::Rainbow;
+        break;
+    }
+}
+
+/// <summary>
+/// Rotates the colours through the palette.
+/// </summary>
+/// <param name="amount">Fraction of the palette to rotate by</param>
+void Palette::cycle(double amount)
+{
+    m_offset += amount;
+    m_offset -= floor(m_offset);
+}
+
+
+/// <summary>
+/// Getter for how iteration counts are scaled to the palette
+/// </summary>
+/// <returns>The normalisation</returns>
+Palette::Normalisation Palette::getNormalisation() const { return m_normalisation; }
+
+/// <summary>
+/// Toggles between spreading the palette over the iteration limit, and
+/// repeating it every FIXED_PERIOD iterations, which keeps colours stable
+/// when the iteration limit changes.
+/// </summary>
+void Palette::nextNormalisation()
+{
+    m_normalisation = m_normalisation == Normalisation::MaxIterations
+                    ? Normalisation::FixedPeriod
+                    : Normalisation::MaxIterations;
+}
+
+
+/// <summary>
+/// Converts a value for hue at max saturation and brightness to RGB format
+/// </summary>
+/// <param name="h">Hue value for the colour, range 0:360</param>
+/// <returns>Colour in RGB format</returns>
+sf::Color hueToRGB(double h) {
+    sf::Uint8 x = static_cast<sf::Uint8>(0xFF * (1 - abs(fmod((h / 60.0), 2) - 1.0)));
+
+    switch (static_cast<int>(h) / 60)
+    {
+    case 0:
+        return sf::Color(0xFF, x, 0);
+    case 1:
+        return sf::Color(x, 0xFF, 0);
+    case 2:
+        return sf::Color(0, 0xFF, x);
+    case 3:
+        return sf::Color(0, x, 0xFF);
+    case 4:
+        return sf::Color(x, 0, 0xFF);
+    case 5:
+        return sf::Color(0xFF, 0, x);
+    default:
+        return sf::Color();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+class Palette
+{
+public:
+    enum class Style
+    {
+        Rainbow,
+        Fire,
+        Greyscale
+    };
+
+    enum class Normalisation
+    {
+        MaxIterations,
+        FixedPeriod
+    };
+
+    static constexpr double FIXED_PERIOD = 64.0;
+
+    Palette();
+    ~Palette();
+
+    sf::Color colour(float iterations, int maxIterations) const;
+    Style getStyle() const;
+    void nextStyle();
+    void cycle(double amount);
+    Normalisation getNormalisation() const;
+    void nextNormalisation();
+
+private:
+    Style m_style = Style::Rainbow;
+    Normalisation m_normalisation = Normalisation::MaxIterations;
+    double m_offset = 0;
+};
+
+sf::Color hueToRGB(double h);
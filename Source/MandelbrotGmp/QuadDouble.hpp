@@ -0,0 +1,363 @@
+#pragma once
+
+#include <cmath>
+#include "ErrorFreeTransforms.hpp"
+
+/// <summary>
+/// A number held as the unevaluated sum of four doubles, giving 212 bits of
+/// mantissa with the exponent range of a double. It has the same operations
+/// as ArbitraryPrecision, so can be iterated in its place at depths it is
+/// precise enough for, where it is several times faster than GMP.
+/// Everything is inline, as each operation is a few dozen instructions.
+/// Addition and multiplication are the "sloppy" algorithms of the QD library
+/// by Hida, Li and Bailey, whose error is relative to the operands rather
+/// than the result, which is all iterating an orbit needs.
+/// </summary>
+class QuadDouble
+{
+public:
+    static constexpr unsigned long long PRECISION = 212;
+
+    QuadDouble(double initialValue = 0) : m_c{ initialValue, 0.0, 0.0, 0.0 } {}
+    QuadDouble(double initialValue, unsigned long long) : m_c{ initialValue, 0.0, 0.0, 0.0 } {}
+    QuadDouble(const char* decimal, unsigned long long) : QuadDouble(parseDecimal<QuadDouble>(decimal)) {}
+
+    /// <summary>
+    /// Rounds a number of greater precision, such as an ArbitraryPrecision,
+    /// by peeling off one double at a time.
+    /// </summary>
+    template <typename T>
+    static QuadDouble split(const T& value)
+    {
+        T remainder(value);
+        QuadDouble result;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const double part = static_cast<double>(remainder);
+            result += part;
+            remainder -= T(part);
+        }
+
+        return result;
+    }
+
+    unsigned long long getPrecision() const { return PRECISION; }
+    void setPrecision(unsigned long long) {}
+
+    QuadDouble operator-() const { return QuadDouble(-m_c[0], -m_c[1], -m_c[2], -m_c[3]); }
+
+    friend QuadDouble operator+(const QuadDouble& a, const QuadDouble& b)
+    {
+        double t0, t1, t2, t3;
+        double s0 = twoSum(a.m_c[0], b.m_c[0], t0);
+        double s1 = twoSum(a.m_c[1], b.m_c[1], t1);
+        double s2 = twoSum(a.m_c[2], b.m_c[2], t2);
+        double s3 = twoSum(a.m_c[3], b.m_c[3], t3);
+
+        s1 = twoSum(s1, t0, t0);
+        threeSum(s2, t0, t1);
+        threeSumTwo(s3, t0, t2);
+        t0 = t0 + t1 + t3;
+
+        renormalise(s0, s1, s2, s3, t0);
+        return QuadDouble(s0, s1, s2, s3);
+    }
+
+    friend QuadDouble operator+(const QuadDouble& a, double b)
+    {
+        double e;
+        double c0 = twoSum(a.m_c[0], b, e);
+        double c1 = twoSum(a.m_c[1], e, e);
+        double c2 = twoSum(a.m_c[2], e, e);
+        double c3 = twoSum(a.m_c[3], e, e);
+
+        renormalise(c0, c1, c2, c3, e);
+        return QuadDouble(c0, c1, c2, c3);
+    }
+
+    friend QuadDouble operator-(const QuadDouble& a, const QuadDouble& b) { return a + -b; }
+
+    /// <summary>
+    /// Product to within terms of order 2^-212 of the operands, which drops
+    /// the products of the lowest parts.
+    /// </summary>
+    friend QuadDouble operator*(const QuadDouble& a, const QuadDouble& b)
+    {
+        double q0, q1, q2, q3, q4, q5;
+        double p0 = twoProduct(a.m_c[0], b.m_c[0], q0);
+
+        double p1 = twoProduct(a.m_c[0], b.m_c[1], q1);
+        double p2 = twoProduct(a.m_c[1], b.m_c[0], q2);
+
+        double p3 = twoProduct(a.m_c[0], b.m_c[2], q3);
+        double p4 = twoProduct(a.m_c[1], b.m_c[1], q4);
+        double p5 = twoProduct(a.m_c[2], b.m_c[0], q5);
+
+        threeSum(p1, p2, q0);
+
+        // Six-three sum of p2, q1, q2, p3, p4 and p5
+        threeSum(p2, q1, q2);
+        threeSum(p3, p4, p5);
+
+        double t0, t1;
+        double s0 = twoSum(p2, p3, t0);
+        double s1 = twoSum(q1, p4, t1);
+        double s2 = q2 + p5;
+        s1 = twoSum(s1, t0, t0);
+        s2 += t0 + t1;
+
+        // Terms of order 2^-159 and below
+        s1 += a.m_c[0] * b.m_c[3] + a.m_c[1] * b.m_c[2] + a.m_c[2] * b.m_c[1] + a.m_c[3] * b.m_c[0] +
+              q0 + q3 + q4 + q5;
+
+        renormalise(p0, p1, s0, s1, s2);
+        return QuadDouble(p0, p1, s0, s1);
+    }
+
+    friend QuadDouble operator*(const QuadDouble& a, double b)
+    {
+        double q0, q1, q2;
+        const double p0 = twoProduct(a.m_c[0], b, q0);
+        double p1 = twoProduct(a.m_c[1], b, q1);
+        double p2 = twoProduct(a.m_c[2], b, q2);
+        const double p3 = a.m_c[3] * b;
+
+        double s0 = p0;
+        double s2;
+        double s1 = twoSum(q0, p1, s2);
+        threeSum(s2, q1, p2);
+        threeSumTwo(q1, q2, p3);
+        double s3 = q1;
+        double s4 = q2 + p2;
+
+        renormalise(s0, s1, s2, s3, s4);
+        return QuadDouble(s0, s1, s2, s3);
+    }
+
+    /// <summary>
+    /// Long division, one double of the quotient at a time.
+    /// </summary>
+    friend QuadDouble operator/(const QuadDouble& a, const QuadDouble& b)
+    {
+        double q0 = a.m_c[0] / b.m_c[0];
+        QuadDouble r = a - b * q0;
+        double q1 = r.m_c[0] / b.m_c[0];
+        r -= b * q1;
+        double q2 = r.m_c[0] / b.m_c[0];
+        r -= b * q2;
+        double q3 = r.m_c[0] / b.m_c[0];
+        double q4 = 0.0;
+
+        renormalise(q0, q1, q2, q3, q4);
+        return QuadDouble(q0, q1, q2, q3);
+    }
+
+    QuadDouble& operator+=(const QuadDouble& b) { return *this = *this + b; }
+    QuadDouble& operator-=(const QuadDouble& b) { return *this = *this - b; }
+    QuadDouble& operator*=(const QuadDouble& b) { return *this = *this * b; }
+    QuadDouble& operator/=(const QuadDouble& b) { return *this = *this / b; }
+
+    friend bool operator>(const QuadDouble& a, const QuadDouble& b)
+    {
+        for (int i = 0; i < 4; ++i)
+            if (a.m_c[i] != b.m_c[i])
+                return a.m_c[i] > b.m_c[i];
+        return false;
+    }
+
+    friend bool operator<(const QuadDouble& a, const QuadDouble& b) { return b > a; }
+    friend bool operator>=(const QuadDouble& a, const QuadDouble& b) { return !(b > a); }
+    friend bool operator<=(const QuadDouble& a, const QuadDouble& b) { return !(a > b); }
+
+    friend bool operator==(const QuadDouble& a, const QuadDouble& b)
+    {
+        return a.m_c[0] == b.m_c[0] && a.m_c[1] == b.m_c[1] && a.m_c[2] == b.m_c[2] && a.m_c[3] == b.m_c[3];
+    }
+
+    friend bool operator!=(const QuadDouble& a, const QuadDouble& b) { return !(a == b); }
+    friend bool operator>(const QuadDouble& a, const double b) { return a > QuadDouble(b); }
+    friend bool operator<(const QuadDouble& a, const double b) { return a < QuadDouble(b); }
+    friend bool operator>=(const QuadDouble& a, const double b) { return a >= QuadDouble(b); }
+    friend bool operator<=(const QuadDouble& a, const double b) { return a <= QuadDouble(b); }
+    friend bool operator==(const QuadDouble& a, const double b) { return a == QuadDouble(b); }
+    friend bool operator!=(const QuadDouble& a, const double b) { return a != QuadDouble(b); }
+
+    explicit operator double() const { return m_c[0]; }
+    explicit operator float() const { return static_cast<float>(m_c[0]); }
+    explicit operator int() const { return static_cast<int>(static_cast<long>(*this)); }
+
+    /// <summary>
+    /// Truncates towards zero, like mpf_get_si, including when the high part
+    /// is whole and the lower parts take the number just below it.
+    /// </summary>
+    explicit operator long() const
+    {
+        const double whole = std::trunc(m_c[0]);
+        const double below = m_c[1] != 0 ? m_c[1] : m_c[2] != 0 ? m_c[2] : m_c[3];
+        if (whole == m_c[0] && m_c[0] > 0 && below < 0)
+            return static_cast<long>(whole) - 1;
+        if (whole == m_c[0] && m_c[0] < 0 && below > 0)
+            return static_cast<long>(whole) + 1;
+        return static_cast<long>(whole);
+    }
+
+    friend QuadDouble abs(const QuadDouble& a) { return a.m_c[0] < 0 ? -a : a; }
+
+    friend QuadDouble pow(const QuadDouble& base, unsigned long power)
+    {
+        QuadDouble result = 1.0;
+        QuadDouble square = base;
+
+        for (; power != 0; power >>= 1)
+        {
+            if (power & 1)
+                result *= square;
+            square *= square;
+        }
+
+        return result;
+    }
+
+    /// <summary>
+    /// z := z^2 + c, the same as for ArbitraryPrecision.
+    /// </summary>
+    friend void squareAdd(QuadDouble& x, QuadDouble& y, const QuadDouble& cx, const QuadDouble& cy)
+    {
+        const QuadDouble xx = sqr(x);
+        const QuadDouble yy = sqr(y);
+        const QuadDouble xy = x * y;
+
+        // Doubling is exact, so needs no renormalisation
+        y = QuadDouble(2.0 * xy.m_c[0], 2.0 * xy.m_c[1], 2.0 * xy.m_c[2], 2.0 * xy.m_c[3]) + cy;
+        x = xx - yy + cx;
+    }
+
+    /// <summary>
+    /// x^2 + y^2 rounded to a double, for which the high parts suffice.
+    /// </summary>
+    friend double normSquared(const QuadDouble& x, const QuadDouble& y)
+    {
+        return x.m_c[0] * x.m_c[0] + y.m_c[0] * y.m_c[0];
+    }
+
+    /// <summary>
+    /// The squared distance between two complex numbers rounded to a double,
+    /// whose differences must be taken in full as the numbers may be close.
+    /// </summary>
+    friend double distanceSquared(const QuadDouble& x1, const QuadDouble& y1,
+                                  const QuadDouble& x2, const QuadDouble& y2)
+    {
+        return normSquared(x1 - x2, y1 - y2);
+    }
+
+private:
+    double m_c[4];
+
+    QuadDouble(double c0, double c1, double c2, double c3) : m_c{ c0, c1, c2, c3 } {}
+
+    /// <summary>
+    /// a^2, which needs fewer products than a * a as the cross terms pair up.
+    /// </summary>
+    friend QuadDouble sqr(const QuadDouble& a)
+    {
+        double q0, q1, q2, q3;
+        double p0 = twoProduct(a.m_c[0], a.m_c[0], q0);
+        double p1 = twoProduct(2.0 * a.m_c[0], a.m_c[1], q1);
+        double p2 = twoProduct(2.0 * a.m_c[0], a.m_c[2], q2);
+        double p3 = twoProduct(a.m_c[1], a.m_c[1], q3);
+
+        p1 = twoSum(q0, p1, q0);
+        q0 = twoSum(q0, q1, q1);
+        p2 = twoSum(p2, p3, p3);
+
+        double t0, t1;
+        const double s0 = twoSum(q0, p2, t0);
+        double s1 = twoSum(q1, p3, t1);
+        s1 = twoSum(s1, t0, t0);
+        t0 += t1;
+
+        s1 = quickTwoSum(s1, t0, t0);
+        p2 = quickTwoSum(s0, s1, t1);
+        p3 = quickTwoSum(t1, t0, q0);
+
+        double p4 = 2.0 * a.m_c[0] * a.m_c[3];
+        double p5 = 2.0 * a.m_c[1] * a.m_c[2];
+        p4 = twoSum(p4, p5, p5);
+        q2 = twoSum(q2, q3, q3);
+
+        t0 = twoSum(p4, q2, t1);
+        t1 = t1 + p5 + q3;
+
+        p3 = twoSum(p3, t0, p4);
+        p4 = p4 + q0 + t1;
+
+        renormalise(p0, p1, p2, p3, p4);
+        return QuadDouble(p0, p1, p2, p3);
+    }
+
+    /// <summary>
+    /// Renormalises five overlapping terms into four which do not overlap,
+    /// largest first.
+    /// </summary>
+    static void renormalise(double& c0, double& c1, double& c2, double& c3, double& c4)
+    {
+        if (std::isinf(c0))
+            return;
+
+        double s0, s1, s2 = 0.0, s3 = 0.0;
+        s0 = quickTwoSum(c3, c4, c4);
+        s0 = quickTwoSum(c2, s0, c3);
+        s0 = quickTwoSum(c1, s0, c2);
+        c0 = quickTwoSum(c0, s0, c1);
+
+        s0 = c0;
+        s1 = c1;
+
+        if (s1 != 0.0)
+        {
+            s1 = quickTwoSum(s1, c2, s2);
+            if (s2 != 0.0)
+            {
+                s2 = quickTwoSum(s2, c3, s3);
+                if (s3 != 0.0)
+                    s3 += c4;
+                else
+                    s2 = quickTwoSum(s2, c4, s3);
+            }
+            else
+            {
+                s1 = quickTwoSum(s1, c3, s2);
+                if (s2 != 0.0)
+                    s2 = quickTwoSum(s2, c4, s3);
+                else
+                    s1 = quickTwoSum(s1, c4, s2);
+            }
+        }
+        else
+        {
+            s0 = quickTwoSum(s0, c2, s1);
+            if (s1 != 0.0)
+            {
+                s1 = quickTwoSum(s1, c3, s2);
+                if (s2 != 0.0)
+                    s2 = quickTwoSum(s2, c4, s3);
+                else
+                    s1 = quickTwoSum(s1, c4, s2);
+            }
+            else
+            {
+                s0 = quickTwoSum(s0, c3, s1);
+                if (s1 != 0.0)
+                    s1 = quickTwoSum(s1, c4, s2);
+                else
+                    s0 = quickTwoSum(s0, c4, s1);
+            }
+        }
+
+        c0 = s0;
+        c1 = s1;
+        c2 = s2;
+        c3 = s3;
+    }
+};
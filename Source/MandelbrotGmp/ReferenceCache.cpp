@@ -0,0 +1,145 @@
+#include "ReferenceCache.hpp"
+#include <cmath>
+#include "QuadDouble.hpp"
+
+
+/// <summary>
+/// Constructs an empty cache of reference orbits, so that views near one
+/// rendered recently, such as after a pan or a zoom, can be iterated
+/// relative to its reference rather than iterating a new one at full
+/// precision.
+/// Any orbit gives the right result for a point it is offset from, as
+/// ReferenceOrbit::iterate() rebases points which stray from it, so a
+/// reference only has to be precise enough and near enough to the view.
+/// </summary>
+/// <param name="capacity">The most orbits to keep, as deep orbits with high
+/// iteration limits take megabytes each</param>
+ReferenceCache::ReferenceCache(size_t capacity) : m_capacity(capacity) {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+ReferenceCache::~ReferenceCache() {}
+
+
+/// <summary>
+/// Finds a kept reference which can be used for a view, and marks it as the
+/// most recently used. A reference can be used if
+/// - it was iterated at no less than the precision of the view,
+/// - it was iterated up to the iteration limit, or became unbounded first,
+/// - its centre is within REUSE_RADIUS half heights of the view's centre,
+///   so pixels start close to it.
+/// Of those, the one which stays bounded longest is used, as pixels are
+/// rebased less often the longer the reference, otherwise the nearest.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="maxIterations">The iteration limit of the view</param>
+/// <returns>The reference, or null if none can be used</returns>
+ReferenceOrbit* ReferenceCache::find(const View& view, int maxIterations)
+{
+#ifdef UseArbitraryPrecision
+    const double scale = static_cast<double>(view.getScale());
+    auto best = m_orbits.end();
+    double bestDistance = 0;
+
+    for (auto orbit = m_orbits.begin(); orbit != m_orbits.end(); ++orbit)
+    {
+        const Complex centre = orbit->getCentre();
+        if (orbit->getPrecision() < view.getPrecision() ||
+            (orbit->getMaxIterations() < maxIterations && !orbit->isEscaped()))
+            continue;
+
+        const double dx = static_cast<double>(centre.x - view.getCentre().x) / scale;
+        const double dy = static_cast<double>(centre.y - view.getCentre().y) / scale;
+        const double distance = std::sqrt(dx * dx + dy * dy);
+
+        if (!(distance <= REUSE_RADIUS))
+            continue;
+
+        if (best == m_orbits.end() || orbit->getLength() > best->getLength() ||
+            (orbit->getLength() == best->getLength() && distance < bestDistance))
+        {
+            best = orbit;
+            bestDistance = distance;
+        }
+    }
+
+    if (best != m_orbits.end())
+        return use(best);
+#endif
+
+    return nullptr;
+}
+
+/// <summary>
+/// Iterates a new reference at the centre of a view and keeps it, in place
+/// of the least recently used if the cache is full.
+/// Beyond the depths a QuadDouble can represent, the reference is iterated
+/// with SPARE_BITS more precision than the view needs, so it can still be
+/// used after zooming in a little. Shallower references are iterated as a
+/// DoubleDouble or QuadDouble, which carry whatever bits the view leaves
+/// spare for free.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="maxIterations">The iteration limit of the view</param>
+/// <returns>The new reference</returns>
+ReferenceOrbit* ReferenceCache::compute(const View& view, int maxIterations)
+{
+    const Complex centre = view.getCentre();
+    unsigned long long precision = view.getPrecision();
+    if (precision > QuadDouble::PRECISION)
+        precision += SPARE_BITS;
+
+    // Orbits of the same point with lower limits, such as those iterated
+    // while estimating the limit, are superseded by the new one
+    m_orbits.remove_if([&](const ReferenceOrbit& orbit) {
+        return orbit.getCentre() == centre && orbit.getMaxIterations() <= maxIterations;
+    });
+
+    m_orbits.emplace_front();
+    m_orbits.front().compute(centre, maxIterations, precision);
+    evict();
+    return &m_orbits.front();
+}
+
+/// <summary>
+/// Keeps an orbit computed elsewhere, such as by another machine rendering
+/// the same view, in place of the least recently used if the cache is full.
+/// </summary>
+/// <param name="centre">The reference point in the complex plane</param>
+/// <param name="orbit">The orbit from ReferenceOrbit::getOrbit()</param>
+/// <returns>The new reference</returns>
+ReferenceOrbit* ReferenceCache::add(const Complex& centre, const std::vector<DeltaComplex>& orbit)
+{
+    m_orbits.emplace_front();
+    m_orbits.front().assign(centre, orbit);
+    evict();
+    return &m_orbits.front();
+}
+
+/// <summary>
+/// Discards every reference.
+/// </summary>
+void ReferenceCache::clear() { m_orbits.clear(); }
+
+
+/// <summary>
+/// Marks a reference as the most recently used.
+/// </summary>
+/// <param name="orbit">The reference</param>
+/// <returns>The reference, which keeps its address</returns>
+ReferenceOrbit* ReferenceCache::use(std::list<ReferenceOrbit>::iterator orbit)
+{
+    m_orbits.splice(m_orbits.begin(), m_orbits, orbit);
+    return &m_orbits.front();
+}
+
+/// <summary>
+/// Discards the least recently used references until within capacity. The
+/// most recently used is always kept, as it is the one being rendered with.
+/// </summary>
+void ReferenceCache::evict()
+{
+    while (m_orbits.size() > m_capacity && m_orbits.size() > 1)
+        m_orbits.pop_back();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include "View.hpp"
+#include "ReferenceOrbit.hpp"
+
+class ReferenceCache
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4;
+    static constexpr double REUSE_RADIUS = 1.0;
+    static constexpr unsigned long long SPARE_BITS = 64;
+
+    ReferenceCache(size_t capacity);
+    ~ReferenceCache();
+
+    ReferenceOrbit* find(const View& view, int maxIterations);
+    ReferenceOrbit* compute(const View& view, int maxIterations);
+    ReferenceOrbit* add(const Complex& centre, const std::vector<DeltaComplex>& orbit);
+    void clear();
+
+private:
+    size_t m_capacity;
+    std::list<ReferenceOrbit> m_orbits;
+
+    ReferenceOrbit* use(std::list<ReferenceOrbit>::iterator orbit);
+    void evict();
+};
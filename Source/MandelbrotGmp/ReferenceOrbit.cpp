@@ -0,0 +1,397 @@
+#include "ReferenceOrbit.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "DoubleDouble.hpp"
+#include "QuadDouble.hpp"
+
+/// <summary>
+/// Product of two complex numbers.
+/// </summary>
+static DeltaComplex multiply(const DeltaComplex& a, const DeltaComplex& b)
+{
+    return DeltaComplex(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+/// <summary>
+/// Evaluates a series with no constant term by Horner's method.
+/// </summary>
+/// <param name="series">The coefficients of u, u^2, u^3 and so on</param>
+/// <param name="u">The point to evaluate the series at</param>
+template <size_t N>
+static DeltaComplex evaluate(const std::array<DeltaComplex, N>& series, const DeltaComplex& u)
+{
+    DeltaComplex sum(0.0, 0.0);
+
+    for (int k = static_cast<int>(N) - 1; k >= 0; --k)
+        sum = multiply(sum + series[k], u);
+
+    return sum;
+}
+
+
+/// <summary>
+/// A single orbit of the Mandelbrot Set function iterated at full precision,
+/// which nearby points can be iterated relative to using perturbation theory.
+/// Each pixel then only needs to track its small difference from the
+/// reference, which can be done in double precision even when the view is
+/// far too deep for doubles to represent the pixel's position.
+/// </summary>
+ReferenceOrbit::ReferenceOrbit() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+ReferenceOrbit::~ReferenceOrbit() {}
+
+
+/// <summary>
+/// Iterates the reference point at the given precision and stores each
+/// iteration rounded to double precision.
+/// The orbit is stored from Z[0] = 0 until it becomes unbounded or has been
+/// iterated enough times for iterate() to reach maxIterations.
+/// Down to the depths they can represent, the reference is iterated as a
+/// DoubleDouble or QuadDouble, which take no allocations and are several
+/// times faster than GMP, otherwise at exactly the precision asked for.
+/// </summary>
+/// <param name="centre">The reference point in the complex plane</param>
+/// <param name="maxIterations">The iteration limit of the pixels that will be
+/// iterated relative to this orbit</param>
+/// <param name="precision">The bits of mantissa to iterate with, at least
+/// those of the view</param>
+void ReferenceOrbit::compute(const Complex& centre, int maxIterations, unsigned long long precision)
+{
+    setCentre(centre);
+    m_orbit.clear();
+    m_maxIterations = maxIterations;
+    clearApproximation();
+    m_orbit.reserve(maxIterations + 2);
+
+#ifdef UseArbitraryPrecision
+    if (precision <= DoubleDouble::PRECISION)
+    {
+        m_precision = DoubleDouble::PRECISION;
+        iterateOrbit(DoubleDouble::split(centre.x), DoubleDouble::split(centre.y), maxIterations);
+    }
+    else if (precision <= QuadDouble::PRECISION)
+    {
+        m_precision = QuadDouble::PRECISION;
+        iterateOrbit(QuadDouble::split(centre.x), QuadDouble::split(centre.y), maxIterations);
+    }
+    else
+    {
+        m_precision = precision;
+        Complex c = centre;
+        c.x.setPrecision(precision);
+        c.y.setPrecision(precision);
+        iterateOrbit(c.x, c.y, maxIterations);
+    }
+#else
+    m_precision = std::numeric_limits<double>::digits;
+    iterateOrbit(centre.x, centre.y, maxIterations);
+#endif
+}
+
+/// <summary>
+/// Iterates the reference point in whichever type compute() chose.
+/// </summary>
+/// <param name="cx">Real part of the reference point</param>
+/// <param name="cy">Imaginary part of the reference point</param>
+/// <param name="maxIterations">The iteration limit of the pixels</param>
+template <typename T>
+void ReferenceOrbit::iterateOrbit(const T& cx, const T& cy, int maxIterations)
+{
+    constexpr double THRESHOLD = 16.0;
+
+    // Z[0] = 0, at the precision of the centre
+    T x = cx - cx;
+    T y = cy - cy;
+    m_orbit.push_back(DeltaComplex(0.0, 0.0));
+
+    // Z[n+1] := Z[n]^2 + centre, up to Z[maxIterations + 1]
+    for (int n = 0; n <= maxIterations; n++)
+    {
+#ifdef UseArbitraryPrecision
+        squareAdd(x, y, cx, cy);
+#else
+        const T xx = x * x - y * y + cx;
+        y = 2.0 * x * y + cy;
+        x = xx;
+#endif
+
+        DeltaComplex rounded(static_cast<double>(x), static_cast<double>(y));
+        m_orbit.push_back(rounded);
+
+        // No pixel can use the orbit beyond the point it becomes unbounded
+        if (rounded.x * rounded.x + rounded.y * rounded.y > THRESHOLD)
+            break;
+    }
+}
+
+
+/// <summary>
+/// Fits a series in dc to the difference dz[n] of every point of a region
+/// from the reference orbit, so the first iterations of each point can be
+/// skipped by evaluating the series:
+/// dz[n] = A1[n] dc + A2[n] dc^2 + ... + A8[n] dc^8
+/// where each coefficient follows from dz[n+1] := 2 Z[n] dz[n] + dz[n]^2 + dc.
+/// The series is extended one iteration at a time for as long as it matches
+/// probe points, iterated alongside it by perturbation, to within a relative
+/// SERIES_TOLERANCE, and its last term stays negligible.
+/// It stops before any probe escapes or would be rebased.
+/// Coefficients are scaled by powers of the region's radius, as at deep
+/// zooms the higher powers of dc would underflow a double.
+/// </summary>
+/// <param name="probes">Offsets from the reference centre of points around
+/// the edge of the region, such as the corners of the view</param>
+/// <param name="maxIterations">The iteration limit of the points</param>
+void ReferenceOrbit::approximate(const std::vector<DeltaComplex>& probes, int maxIterations)
+{
+    constexpr double THRESHOLD = 16.0;
+    clearApproximation();
+
+    m_seriesRadius = 0;
+    for (const DeltaComplex& probe : probes)
+        m_seriesRadius = std::max(m_seriesRadius, std::sqrt(probe.x * probe.x + probe.y * probe.y));
+
+    if (m_seriesRadius == 0 || !std::isfinite(m_seriesRadius))
+        return;
+
+    // dz[1] = dc, so A1[1] = 1 and the rest are 0
+    std::array<DeltaComplex, SERIES_TERMS> series;
+    series.fill(DeltaComplex(0.0, 0.0));
+    series[0] = DeltaComplex(m_seriesRadius, 0.0);
+
+    std::vector<DeltaComplex> dz(probes);
+    const int last = std::min(getLength() - 2, maxIterations);
+
+    for (int m = 1; m < last; ++m)
+    {
+        const DeltaComplex twoZ = 2.0 * m_orbit[m];
+
+        // Ak[m+1] = 2 Z[m] Ak[m] + sum of Ai[m] Aj[m] for i + j = k, with
+        // the dc term added to A1
+        std::array<DeltaComplex, SERIES_TERMS> next;
+        for (int k = 0; k < SERIES_TERMS; ++k)
+        {
+            next[k] = multiply(twoZ, series[k]);
+
+            for (int i = 0; i < k; ++i)
+                next[k] += multiply(series[i], series[k - 1 - i]);
+        }
+        next[0].x += m_seriesRadius;
+
+        bool isValid = true;
+
+        for (size_t p = 0; p < probes.size() && isValid; ++p)
+        {
+            dz[p] = multiply(twoZ, dz[p]) + multiply(dz[p], dz[p]) + probes[p];
+
+            const DeltaComplex z = m_orbit[m + 1] + dz[p];
+            const double zMagnitude = z.x * z.x + z.y * z.y;
+            const double dzMagnitude = dz[p].x * dz[p].x + dz[p].y * dz[p].y;
+
+            if (zMagnitude > THRESHOLD || zMagnitude < dzMagnitude)
+                isValid = false;
+
+            const DeltaComplex error = evaluate(next, probes[p] / m_seriesRadius) - dz[p];
+            if (!(error.x * error.x + error.y * error.y <= SERIES_TOLERANCE * SERIES_TOLERANCE * dzMagnitude))
+                isValid = false;
+        }
+
+        // The terms left out are about the size of the last one kept
+        const DeltaComplex& first = next[0];
+        const DeltaComplex& highest = next[SERIES_TERMS - 1];
+        if (!(highest.x * highest.x + highest.y * highest.y <=
+              SERIES_TOLERANCE * SERIES_TOLERANCE * (first.x * first.x + first.y * first.y)))
+            isValid = false;
+
+        if (!isValid)
+            break;
+
+        series = next;
+        m_series = next;
+        m_seriesLength = m + 1;
+    }
+}
+
+
+/// <summary>
+/// Discards the series approximation, so every point is iterated from the
+/// start of the orbit.
+/// </summary>
+void ReferenceOrbit::clearApproximation() { m_seriesLength = 0; }
+
+
+/// <summary>
+/// Iterates a point relative to the reference orbit using perturbation theory,
+/// starting from the series approximation if it covers enough iterations.
+/// The returned count matches MandelbrotRenderer::mandelbrot().
+/// </summary>
+/// <param name="dc">Offset of the point from the reference centre</param>
+/// <param name="maxIterations">The maximum number of iterations</param>
+/// <returns>The number of iterations until unbounded, maxIterations if the
+/// point remained bounded, or GLITCHED if precision was lost</returns>
+int ReferenceOrbit::iterate(const DeltaComplex dc, int maxIterations) const
+{
+    constexpr double THRESHOLD = 16.0;
+
+    // A point that has already escaped by the end of the series is iterated
+    // from the start, to find when it escaped
+    if (m_seriesLength > 1 && m_seriesLength <= maxIterations)
+    {
+        const DeltaComplex dz = evaluateSeries(dc);
+        const DeltaComplex z = m_orbit[m_seriesLength] + dz;
+
+        if (z.x * z.x + z.y * z.y <= THRESHOLD)
+            return iterateFrom(dc, dz, m_seriesLength, maxIterations);
+    }
+
+    // z[1] = c, so the point starts one iteration into the orbit
+    return iterateFrom(dc, dc, 1, maxIterations);
+}
+
+
+/// <summary>
+/// Iterates a point relative to the reference orbit from iteration m.
+/// For a point c = centre + dc, z[n] = Z[n] + dz[n] where
+/// dz[n+1] := 2 Z[n] dz[n] + dz[n]^2 + dc
+/// Whenever the point comes closer to 0 than its difference from the
+/// reference, or the reference orbit runs out, the point is rebased onto the
+/// start of the reference orbit so that dz stays small and precise.
+/// </summary>
+/// <param name="dc">Offset of the point from the reference centre</param>
+/// <param name="dz">The difference dz[m] of the point from the reference</param>
+/// <param name="m">The iteration of the point, at least 1</param>
+/// <param name="maxIterations">The maximum number of iterations</param>
+/// <returns>The number of iterations until unbounded, maxIterations if the
+/// point remained bounded, or GLITCHED if precision was lost</returns>
+int ReferenceOrbit::iterateFrom(const DeltaComplex& dc, DeltaComplex dz, int m, int maxIterations) const
+{
+    constexpr double THRESHOLD = 16.0;
+    const int length = getLength();
+
+    // Iteration m has been reached after m - 1 steps from z[1]
+    for (int n = m - 1; n < maxIterations; n++)
+    {
+        // Rebase if the next iteration of the reference is not available
+        if (m >= length - 1)
+        {
+            dz += m_orbit[m];
+            m = 0;
+        }
+
+        const DeltaComplex& Z = m_orbit[m];
+        dz = DeltaComplex(2.0 * (Z.x * dz.x - Z.y * dz.y) + dz.x * dz.x - dz.y * dz.y + dc.x,
+                          2.0 * (Z.x * dz.y + Z.y * dz.x) + 2.0 * dz.x * dz.y + dc.y);
+        ++m;
+
+        // Full value of the point is the reference plus the difference
+        DeltaComplex z = m_orbit[m] + dz;
+        double zMagnitude = z.x * z.x + z.y * z.y;
+        double dzMagnitude = dz.x * dz.x + dz.y * dz.y;
+
+        if (zMagnitude > THRESHOLD)
+            return n;
+
+        // The difference can only become non-finite if it is no longer
+        // meaningful, so the point must be iterated some other way
+        if (!std::isfinite(dzMagnitude))
+            return GLITCHED;
+
+        // Rebase when z is smaller than dz, otherwise dz loses all of its
+        // precision relative to z when the reference passes near 0
+        if (zMagnitude < dzMagnitude)
+        {
+            dz = z;
+            m = 0;
+        }
+    }
+
+    return maxIterations;
+}
+
+
+/// <summary>
+/// Takes an orbit computed elsewhere, such as by another machine rendering
+/// the same view, instead of computing it.
+/// </summary>
+/// <param name="centre">The reference point in the complex plane</param>
+/// <param name="orbit">The orbit from getOrbit() of a computed reference</param>
+void ReferenceOrbit::assign(const Complex& centre, const std::vector<DeltaComplex>& orbit)
+{
+    setCentre(centre);
+    m_orbit = orbit;
+    m_maxIterations = std::max(getLength() - 2, 0);
+#ifdef UseArbitraryPrecision
+    m_precision = centre.x.getPrecision();
+#else
+    m_precision = std::numeric_limits<double>::digits;
+#endif
+    clearApproximation();
+}
+
+
+/// <summary>
+/// Setter for the reference point, at its own precision.
+/// </summary>
+/// <param name="centre">The reference point in the complex plane</param>
+void ReferenceOrbit::setCentre(const Complex& centre) { m_centre = centre; }
+
+/// <summary>
+/// Getter for the reference point
+/// </summary>
+/// <returns>The reference point in the complex plane</returns>
+Complex ReferenceOrbit::getCentre() const { return m_centre; }
+
+/// <summary>
+/// Getter for the number of stored iterations of the orbit
+/// </summary>
+/// <returns>The length of the orbit, including Z[0]</returns>
+int ReferenceOrbit::getLength() const { return static_cast<int>(m_orbit.size()); }
+
+/// <summary>
+/// Getter for the iteration limit the orbit was computed for
+/// </summary>
+/// <returns>The iteration limit, which an orbit that became unbounded
+/// falls short of</returns>
+int ReferenceOrbit::getMaxIterations() const { return m_maxIterations; }
+
+/// <summary>
+/// Getter for the precision the orbit was iterated at
+/// </summary>
+/// <returns>The bits of mantissa, which views needing more cannot use the
+/// orbit</returns>
+unsigned long long ReferenceOrbit::getPrecision() const { return m_precision; }
+
+/// <summary>
+/// Whether the reference point became unbounded before the iteration limit,
+/// in which case computing it with a higher limit gives the same orbit.
+/// </summary>
+/// <returns>True if the orbit ends where it became unbounded</returns>
+bool ReferenceOrbit::isEscaped() const { return getLength() < m_maxIterations + 2; }
+
+/// <summary>
+/// Getter for the orbit
+/// </summary>
+/// <returns>Every stored iteration, rounded to double precision</returns>
+const std::vector<DeltaComplex>& ReferenceOrbit::getOrbit() const { return m_orbit; }
+
+/// <summary>
+/// Getter for the iteration the series approximation reaches
+/// </summary>
+/// <returns>The iteration every point starts from, or 0 if there is no
+/// approximation</returns>
+int ReferenceOrbit::getSeriesLength() const { return m_seriesLength; }
+
+
+/// <summary>
+/// Evaluates the series approximation for a point.
+/// </summary>
+/// <param name="dc">Offset of the point from the reference centre</param>
+/// <returns>The difference of the point from the reference at the end of
+/// the series</returns>
+DeltaComplex ReferenceOrbit::evaluateSeries(const DeltaComplex& dc) const
+{
+    return evaluate(m_series, dc / m_seriesRadius);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "View.hpp"
+
+typedef sf::Vector2<double> DeltaComplex;
+
+class ReferenceOrbit
+{
+public:
+    static constexpr int GLITCHED = -1;
+
+    ReferenceOrbit();
+    ~ReferenceOrbit();
+
+    void compute(const Complex& centre, int maxIterations, unsigned long long precision);
+    void assign(const Complex& centre, const std::vector<DeltaComplex>& orbit);
+    void approximate(const std::vector<DeltaComplex>& probes, int maxIterations);
+    void clearApproximation();
+    int iterate(const DeltaComplex dc, int maxIterations) const;
+    Complex getCentre() const;
+    int getLength() const;
+    int getMaxIterations() const;
+    unsigned long long getPrecision() const;
+    bool isEscaped() const;
+    const std::vector<DeltaComplex>& getOrbit() const;
+    int getSeriesLength() const;
+
+private:
+    static constexpr int SERIES_TERMS = 8;
+    static constexpr double SERIES_TOLERANCE = 1e-12;
+
+    Complex m_centre;
+    std::vector<DeltaComplex> m_orbit;
+    int m_maxIterations = 0;
+    unsigned long long m_precision = 0;
+    std::array<DeltaComplex, SERIES_TERMS> m_series;
+    double m_seriesRadius = 0;
+    int m_seriesLength = 0;
+
+    void setCentre(const Complex& centre);
+    template <typename T>
+    void iterateOrbit(const T& cx, const T& cy, int maxIterations);
+    DeltaComplex evaluateSeries(const DeltaComplex& dc) const;
+    int iterateFrom(const DeltaComplex& dc, DeltaComplex dz, int m, int maxIterations) const;
+};
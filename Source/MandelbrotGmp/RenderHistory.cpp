@@ -0,0 +1,206 @@
+#include "RenderHistory.hpp"
+#include <algorithm>
+#include <utility>
+
+
+/// <summary>
+/// Constructs an empty history of visited views, with the completed renders
+/// of the most recently used views kept in memory so that returning to them
+/// only needs them to be coloured and displayed. Renders are kept as
+/// CompactIterations, so several times as many fit the budget as floats.
+/// </summary>
+/// <param name="budgetBytes">The most memory the kept renders may use</param>
+RenderHistory::RenderHistory(size_t budgetBytes) : m_budgetBytes(budgetBytes) {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+RenderHistory::~RenderHistory() {}
+
+
+/// <summary>
+/// Getter for the memory budget.
+/// </summary>
+/// <returns>The most memory the kept renders may use, in bytes</returns>
+size_t RenderHistory::getBudget() const { return m_budgetBytes; }
+
+/// <summary>
+/// Setter for the memory budget.
+/// The least recently used renders are discarded until they fit it.
+/// </summary>
+/// <param name="budgetBytes">The most memory the kept renders may use</param>
+void RenderHistory::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budgetBytes = budgetBytes;
+    evict();
+}
+
+
+/// <summary>
+/// Records a view as the current position in the history, discarding any
+/// views which could have been returned to with forward().
+/// Visiting the current view again, such as after back() or forward(), has
+/// no effect.
+/// </summary>
+/// <param name="view">The view being rendered</param>
+void RenderHistory::visit(const View& view)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_views.empty() && m_views[m_position] == view)
+        return;
+
+    if (!m_views.empty())
+        m_views.erase(m_views.begin() + m_position + 1, m_views.end());
+
+    m_views.push_back(view);
+
+    if (m_views.size() > MAX_VIEWS)
+        m_views.erase(m_views.begin());
+
+    m_position = m_views.size() - 1;
+}
+
+/// <summary>
+/// Steps back to the view visited before the current one.
+/// </summary>
+/// <param name="view">Set to the previous view</param>
+/// <returns>False if there is no previous view</returns>
+bool RenderHistory::back(View& view)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_views.empty() || m_position == 0)
+        return false;
+
+    view = m_views[--m_position];
+    return true;
+}
+
+/// <summary>
+/// Steps forward to the view which was stepped back from.
+/// </summary>
+/// <param name="view">Set to the next view</param>
+/// <returns>False if there is no next view</returns>
+bool RenderHistory::forward(View& view)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_position + 1 >= m_views.size())
+        return false;
+
+    view = m_views[++m_position];
+    return true;
+}
+
+
+/// <summary>
+/// Keeps a copy of a completed render as the most recently used, discarding
+/// the least recently used renders if over budget.
+/// A render that is already kept is only marked as recently used.
+/// </summary>
+/// <param name="view">The view that was rendered</param>
+/// <param name="maxIterations">The iteration limit it was requested with,
+/// which may stand for a limit chosen automatically</param>
+/// <param name="renderedIterations">The iteration limit it was rendered with</param>
+/// <param name="iterations">The iteration buffer, of the view's screen size</param>
+void RenderHistory::store(const View& view, int maxIterations, int renderedIterations, const float* iterations)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto frame = find(view, maxIterations);
+    if (frame != m_frames.end())
+    {
+        m_frames.splice(m_frames.begin(), m_frames, frame);
+        return;
+    }
+
+    const Pixel size = view.getScreenSize();
+    CompactIterations compact(iterations, size.x, size.y, size.x);
+    const size_t sizeBytes = sizeof(Frame) + compact.getSizeBytes();
+
+    // A render larger than the whole budget would evict everything else
+    if (sizeBytes > m_budgetBytes)
+        return;
+
+    m_frames.push_front(Frame{ view, maxIterations, renderedIterations, std::move(compact) });
+    m_sizeBytes += sizeBytes;
+    evict();
+}
+
+/// <summary>
+/// Checks whether a render of a view is kept, without marking it as used.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="maxIterations">The iteration limit to be rendered with</param>
+/// <returns>True if load() would succeed</returns>
+bool RenderHistory::contains(const View& view, int maxIterations)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return find(view, maxIterations) != m_frames.end();
+}
+
+/// <summary>
+/// Decodes a kept render of a view into an iteration buffer and marks it as
+/// the most recently used. Its counts are those rendered, quantised by
+/// CompactIterations.
+/// </summary>
+/// <param name="view">The view to be rendered</param>
+/// <param name="maxIterations">The iteration limit to be rendered with</param>
+/// <param name="iterations">The iteration buffer to fill, of the view's
+/// screen size</param>
+/// <param name="renderedIterations">Set to the iteration limit the render
+/// was made with</param>
+/// <returns>False if the view has not been kept</returns>
+bool RenderHistory::load(const View& view, int maxIterations, float* iterations, int& renderedIterations)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto frame = find(view, maxIterations);
+    if (frame == m_frames.end())
+        return false;
+
+    m_frames.splice(m_frames.begin(), m_frames, frame);
+    frame->iterations.decode(iterations, frame->iterations.getWidth());
+    renderedIterations = frame->renderedIterations;
+    return true;
+}
+
+/// <summary>
+/// Discards every kept render, such as when they would no longer be rendered
+/// the same way. The visited views are kept.
+/// </summary>
+void RenderHistory::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frames.clear();
+    m_sizeBytes = 0;
+}
+
+
+/// <summary>
+/// Finds the kept render of a view.
+/// </summary>
+/// <param name="view">The view rendered</param>
+/// <param name="maxIterations">The iteration limit rendered with</param>
+/// <returns>The kept render, or the end of m_frames if there is none</returns>
+std::list<RenderHistory::Frame>::iterator RenderHistory::find(const View& view, int maxIterations)
+{
+    return std::find_if(m_frames.begin(), m_frames.end(), [&](const Frame& frame)
+    {
+        return frame.maxIterations == maxIterations && frame.view == view;
+    });
+}
+
+/// <summary>
+/// Discards the least recently used renders until they fit the budget.
+/// </summary>
+void RenderHistory::evict()
+{
+    while (m_sizeBytes > m_budgetBytes && !m_frames.empty())
+    {
+        m_sizeBytes -= sizeof(Frame) + m_frames.back().iterations.getSizeBytes();
+        m_frames.pop_back();
+    }
+}
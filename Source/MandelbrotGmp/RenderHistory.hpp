@@ -0,0 +1,45 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include "View.hpp"
+#include "CompactIterations.hpp"
+
+class RenderHistory
+{
+public:
+    RenderHistory(size_t budgetBytes);
+    ~RenderHistory();
+
+    size_t getBudget() const;
+    void setBudget(size_t budgetBytes);
+    void visit(const View& view);
+    bool back(View& view);
+    bool forward(View& view);
+    void store(const View& view, int maxIterations, int renderedIterations, const float* iterations);
+    bool contains(const View& view, int maxIterations);
+    bool load(const View& view, int maxIterations, float* iterations, int& renderedIterations);
+    void clear();
+
+private:
+    static constexpr size_t MAX_VIEWS = 1000;
+
+    struct Frame
+    {
+        View view;
+        int maxIterations;
+        int renderedIterations;
+        CompactIterations iterations;
+    };
+
+    std::mutex m_mutex;
+    std::vector<View> m_views;
+    size_t m_position = 0;
+    std::list<Frame> m_frames;
+    size_t m_budgetBytes;
+    size_t m_sizeBytes = 0;
+
+    std::list<Frame>::iterator find(const View& view, int maxIterations);
+    void evict();
+};
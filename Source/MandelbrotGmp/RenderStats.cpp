@@ -0,0 +1,339 @@
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+
+/// <summary>
+/// Measurements of one frame: how it was rendered, how long each pass and
+/// tile took, how evenly the work was spread over the rendering threads,
+/// and how much iterating the view needed.
+/// Tiles are recorded by the thread which rendered them, each in its own
+/// slot, so only passes need to be recorded from a single thread.
+/// </summary>
+RenderStats::RenderStats() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+RenderStats::~RenderStats() {}
+
+
+/// <summary>
+/// The time elapsed since a point in time, for timing with Clock.
+/// </summary>
+/// <param name="start">When timing began</param>
+/// <returns>The elapsed time in seconds</returns>
+double RenderStats::secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/// <summary>
+/// Clears every measurement, ready for a new frame.
+/// </summary>
+/// <param name="mode">How the frame is rendered, such as "double" or
+/// "perturbation"</param>
+/// <param name="precision">The bits of precision the view needs</param>
+/// <param name="threadCount">The number of rendering threads, numbered by
+/// omp_get_thread_num()</param>
+void RenderStats::reset(const std::string& mode, unsigned long long precision, int threadCount)
+{
+    m_mode = mode;
+    m_precision = precision;
+    m_prepareSeconds = 0;
+    m_skippedIterations = 0;
+    m_reference = "none";
+    m_secondaryReferences = 0;
+    m_uploadSeconds = 0;
+    m_cachedTiles = 0;
+    m_passes.clear();
+    m_threads.assign(threadCount, Thread{ 0, 0, 0 });
+    m_threadPasses.assign(threadCount, Pass{ 0, 0, 0, 0 });
+    m_pixels = 0;
+    m_maxIterations = 0;
+    m_iterations = 0;
+    m_boundedShare = 0;
+}
+
+
+/// <summary>
+/// Records time spent preparing the view, such as computing the reference
+/// orbit, before any tiles are rendered.
+/// </summary>
+/// <param name="seconds">The time taken</param>
+void RenderStats::addPrepareSeconds(double seconds) { m_prepareSeconds += seconds; }
+
+/// <summary>
+/// Records the iterations every pixel skipped with a series approximation.
+/// </summary>
+/// <param name="iterations">The iterations skipped</param>
+void RenderStats::setSkippedIterations(int iterations) { m_skippedIterations = iterations; }
+
+/// <summary>
+/// Records where the reference orbit came from.
+/// </summary>
+/// <param name="reference">computed, reused from a nearby view, locked by
+/// the caller, or none when pixels are iterated in double precision</param>
+void RenderStats::setReference(const std::string& reference) { m_reference = reference; }
+
+/// <summary>
+/// Records a secondary reference iterated for points the reference orbit
+/// lost precision for. Only called with the engine's secondary references
+/// locked.
+/// </summary>
+void RenderStats::addSecondaryReference() { ++m_secondaryReferences; }
+
+/// <summary>
+/// Records a point the reference orbit lost precision for, so it was
+/// iterated another way. Threads may record glitches at the same time, as
+/// long as each passes its own number.
+/// </summary>
+/// <param name="thread">The number of the thread which iterated the point</param>
+void RenderStats::addGlitch(int thread)
+{
+    if (thread >= 0 && thread < static_cast<int>(m_threads.size()))
+        ++m_threads[thread].glitches;
+}
+
+/// <summary>
+/// Records a tile loaded from the tile cache instead of being rendered.
+/// </summary>
+void RenderStats::addCachedTile() { ++m_cachedTiles; }
+
+
+/// <summary>
+/// Records one tile of the pass in progress. Threads may record tiles at
+/// the same time, as long as each passes its own number.
+/// </summary>
+/// <param name="thread">The number of the thread which rendered the tile</param>
+/// <param name="seconds">The time the tile took</param>
+void RenderStats::addTile(int thread, double seconds)
+{
+    if (thread < 0 || thread >= static_cast<int>(m_threads.size()))
+        return;
+
+    m_threads[thread].busySeconds += seconds;
+    ++m_threads[thread].tiles;
+
+    Pass& pass = m_threadPasses[thread];
+    ++pass.tiles;
+    pass.seconds += seconds;
+    pass.slowestTileSeconds = std::max(pass.slowestTileSeconds, seconds);
+}
+
+
+/// <summary>
+/// Records the end of a pass, gathering the tiles every thread recorded
+/// during it. Must not be called while tiles are being recorded.
+/// </summary>
+/// <param name="step">The spacing between sampled pixels in the pass, or 0
+/// for the anti-aliasing pass</param>
+/// <param name="seconds">The time from starting the pass until its last
+/// tile finished</param>
+void RenderStats::addPass(int step, double seconds)
+{
+    Pass pass{ step, seconds, 0, 0 };
+
+    for (Pass& threadPass : m_threadPasses)
+    {
+        pass.tiles += threadPass.tiles;
+        pass.slowestTileSeconds = std::max(pass.slowestTileSeconds, threadPass.slowestTileSeconds);
+        threadPass = Pass{ 0, 0, 0, 0 };
+    }
+
+    m_passes.push_back(pass);
+}
+
+
+/// <summary>
+/// Records time spent uploading the frame's pixels to textures.
+/// </summary>
+/// <param name="seconds">The time taken</param>
+void RenderStats::addUploadSeconds(double seconds) { m_uploadSeconds += seconds; }
+
+
+/// <summary>
+/// Totals the iterations of a finished frame. Bounded pixels count as the
+/// full iteration limit, even if a periodic orbit was found sooner.
+/// </summary>
+/// <param name="iterations">The iteration buffer of the frame</param>
+/// <param name="count">The number of pixels in the buffer</param>
+/// <param name="maxIterations">The iteration limit of the frame</param>
+void RenderStats::countIterations(const float* iterations, int count, int maxIterations)
+{
+    const float bound = static_cast<float>(maxIterations);
+    double total = 0;
+    int bounded = 0;
+
+#pragma omp parallel for reduction(+:total, bounded)
+    for (int i = 0; i < count; ++i)
+    {
+        total += iterations[i];
+
+        if (iterations[i] >= bound)
+            ++bounded;
+    }
+
+    m_pixels = count;
+    m_maxIterations = maxIterations;
+    m_iterations = total;
+    m_boundedShare = count > 0 ? static_cast<double>(bounded) / count : 0;
+}
+
+
+/// <summary>
+/// Getter for mode.
+/// </summary>
+/// <returns>How the frame was rendered</returns>
+const std::string& RenderStats::getMode() const { return m_mode; }
+
+/// <summary>
+/// Getter for reference.
+/// </summary>
+/// <returns>Where the reference orbit came from, see setReference()</returns>
+const std::string& RenderStats::getReference() const { return m_reference; }
+
+/// <summary>
+/// Getter for secondaryReferences.
+/// </summary>
+/// <returns>The secondary references iterated for glitched points</returns>
+int RenderStats::getSecondaryReferences() const { return m_secondaryReferences; }
+
+/// <summary>
+/// The points the reference orbit lost precision for, over every thread.
+/// </summary>
+/// <returns>The number of glitched points</returns>
+int RenderStats::getGlitches() const
+{
+    int glitches = 0;
+
+    for (const Thread& thread : m_threads)
+        glitches += thread.glitches;
+
+    return glitches;
+}
+
+/// <summary>
+/// The time the frame took to render, from preparing the view to the end
+/// of the last pass.
+/// </summary>
+/// <returns>The time in seconds</returns>
+double RenderStats::getRenderSeconds() const
+{
+    double seconds = m_prepareSeconds;
+
+    for (const Pass& pass : m_passes)
+        seconds += pass.seconds;
+
+    return seconds;
+}
+
+/// <summary>
+/// Getter for passes.
+/// </summary>
+/// <returns>Every pass of the frame, in the order rendered</returns>
+const std::vector<RenderStats::Pass>& RenderStats::getPasses() const { return m_passes; }
+
+/// <summary>
+/// Getter for threads.
+/// </summary>
+/// <returns>The work of each rendering thread over the whole frame</returns>
+const std::vector<RenderStats::Thread>& RenderStats::getThreads() const { return m_threads; }
+
+
+/// <summary>
+/// The time a thread spent waiting during the passes, either for other
+/// threads to finish their tiles or outside of any tile.
+/// </summary>
+/// <param name="thread">The number of the thread</param>
+/// <returns>The time in seconds</returns>
+double RenderStats::getIdleSeconds(int thread) const
+{
+    double seconds = 0;
+
+    for (const Pass& pass : m_passes)
+        seconds += pass.seconds;
+
+    return std::max(0.0, seconds - m_threads[thread].busySeconds);
+}
+
+
+/// <summary>
+/// Writes the measurements as a single line of key=value pairs, so the log
+/// can be searched and parsed.
+/// </summary>
+/// <param name="out">The stream to write to</param>
+void RenderStats::log(std::ostream& out) const
+{
+    std::ostringstream line;
+    line << "frame mode=" << m_mode
+         << " precision=" << m_precision
+         << " pixels=" << m_pixels
+         << " limit=" << m_maxIterations
+         << " skipped=" << m_skippedIterations
+         << " reference=" << m_reference
+         << " secondary=" << m_secondaryReferences
+         << " glitched=" << getGlitches()
+         << " iterations=" << std::fixed << std::setprecision(0) << m_iterations
+         << std::setprecision(4) << " bounded=" << m_boundedShare
+         << std::setprecision(6)
+         << " prepare=" << m_prepareSeconds
+         << " render=" << getRenderSeconds()
+         << " upload=" << m_uploadSeconds
+         << " cached=" << m_cachedTiles;
+
+    for (const Pass& pass : m_passes)
+    {
+        line << " pass." << pass.step << ".seconds=" << pass.seconds
+             << " pass." << pass.step << ".tiles=" << pass.tiles
+             << " pass." << pass.step << ".slowest=" << pass.slowestTileSeconds;
+    }
+
+    for (int i = 0; i < static_cast<int>(m_threads.size()); ++i)
+    {
+        line << " thread." << i << ".busy=" << m_threads[i].busySeconds
+             << " thread." << i << ".idle=" << getIdleSeconds(i)
+             << " thread." << i << ".tiles=" << m_threads[i].tiles;
+    }
+
+    out << line.str() << std::endl;
+}
+
+
+/// <summary>
+/// Describes the measurements in a few short lines, for the overlay.
+/// </summary>
+/// <returns>The lines separated by newlines</returns>
+std::string RenderStats::summary() const
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    text << m_mode << ", " << m_precision << " bits, " << m_skippedIterations << " iterations skipped\n";
+    text << m_reference << " reference, " << m_secondaryReferences << " secondary, "
+         << getGlitches() << " glitched\n";
+    text << getRenderSeconds() * 1000 << " ms render, "
+         << m_prepareSeconds * 1000 << " ms prepare, "
+         << m_uploadSeconds * 1000 << " ms upload\n";
+    text << m_iterations / 1e6 << "M iterations, limit " << m_maxIterations << ", "
+         << m_boundedShare * 100 << "% bounded, "
+         << m_cachedTiles << " cached tiles\n";
+
+    for (const Pass& pass : m_passes)
+    {
+        text << "pass " << pass.step << ": " << pass.tiles << " tiles in "
+             << pass.seconds * 1000 << " ms, slowest "
+             << pass.slowestTileSeconds * 1000 << " ms\n";
+    }
+
+    for (int i = 0; i < static_cast<int>(m_threads.size()); ++i)
+    {
+        const double busy = m_threads[i].busySeconds;
+        const double total = busy + getIdleSeconds(i);
+        text << "thread " << i << ": " << (total > 0 ? 100 * busy / total : 0)
+             << "% busy, " << m_threads[i].tiles << " tiles\n";
+    }
+
+    return text.str();
+}
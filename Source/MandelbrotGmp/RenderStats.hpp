@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class RenderStats
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pass
+    {
+        int step;
+        double seconds;
+        int tiles;
+        double slowestTileSeconds;
+    };
+
+    struct Thread
+    {
+        double busySeconds;
+        int tiles;
+        int glitches;
+    };
+
+    RenderStats();
+    ~RenderStats();
+
+    static double secondsSince(Clock::time_point start);
+    void reset(const std::string& mode, unsigned long long precision, int threadCount);
+    void addPrepareSeconds(double seconds);
+    void setSkippedIterations(int iterations);
+    void setReference(const std::string& reference);
+    void addSecondaryReference();
+    void addGlitch(int thread);
+    void addCachedTile();
+    void addTile(int thread, double seconds);
+    void addPass(int step, double seconds);
+    void addUploadSeconds(double seconds);
+    void countIterations(const float* iterations, int count, int maxIterations);
+
+    const std::string& getMode() const;
+    const std::string& getReference() const;
+    int getSecondaryReferences() const;
+    int getGlitches() const;
+    double getRenderSeconds() const;
+    const std::vector<Pass>& getPasses() const;
+    const std::vector<Thread>& getThreads() const;
+    double getIdleSeconds(int thread) const;
+    void log(std::ostream& out) const;
+    std::string summary() const;
+
+private:
+    std::string m_mode;
+    unsigned long long m_precision = 0;
+    double m_prepareSeconds = 0;
+    int m_skippedIterations = 0;
+    std::string m_reference;
+    int m_secondaryReferences = 0;
+    double m_uploadSeconds = 0;
+    int m_cachedTiles = 0;
+    std::vector<Pass> m_passes;
+    std::vector<Thread> m_threads;
+    std::vector<Pass> m_threadPasses;
+    int m_pixels = 0;
+    int m_maxIterations = 0;
+    double m_iterations = 0;
+    double m_boundedShare = 0;
+};
@@ -0,0 +1,384 @@
+#include "SimdKernel.hpp"
+#include "Interior.hpp"
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows any intrinsics to be used in any function
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx,avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+
+/// <summary>
+/// Whether the CPU has fused multiply-add, found once at startup, for code
+/// which is not built for a target with it to choose it at runtime. Reads
+/// during static initialisation may see false, which is still correct.
+/// </summary>
+const bool SimdKernel::FMA_IS_SUPPORTED = SimdKernel::detectFma();
+
+
+/// <summary>
+/// Escape time kernel that iterates several adjacent pixels of a row at once
+/// using the widest vector instructions supported by the CPU, determined at
+/// runtime so the same executable still runs on older processors.
+/// The operations are performed in the same order as
+/// MandelbrotRenderer::mandelbrot(), including the interior checks, so
+/// results are identical to it.
+/// </summary>
+SimdKernel::SimdKernel() : m_level(detectLevel()) {}
+
+/// <summary>
+/// Constructs a kernel with a specific instruction set, which must be
+/// supported by the CPU.
+/// </summary>
+/// <param name="level">The instruction set to use</param>
+SimdKernel::SimdKernel(Level level) : m_level(level) {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+SimdKernel::~SimdKernel() {}
+
+
+/// <summary>
+/// Getter for the instruction set used by the kernel
+/// </summary>
+/// <returns>The instruction set</returns>
+SimdKernel::Level SimdKernel::getLevel() const { return m_level; }
+
+/// <summary>
+/// Getter for the number of pixels iterated by each call to mandelbrot()
+/// </summary>
+/// <returns>The number of vector lanes</returns>
+int SimdKernel::getWidth() const
+{
+    switch (m_level)
+    {
+    case Level::Avx512:
+        return 8;
+    case Level::Avx2:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+
+/// <summary>
+/// Queries CPUID, and XGETBV for whether the OS saves the vector registers,
+/// to find the widest instruction set that can be used.
+/// </summary>
+/// <returns>The widest supported instruction set</returns>
+SimdKernel::Level SimdKernel::detectLevel()
+{
+    int info[4] = { 0 };
+
+#ifdef _MSC_VER
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return Level::Scalar;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx)
+        return Level::Scalar;
+
+    unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+#else
+    unsigned int a, b, c, d;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return Level::Scalar;
+
+    __cpuid(1, a, b, c, d);
+    bool osxsave = (c & (1 << 27)) != 0;
+    bool avx = (c & (1 << 28)) != 0;
+    if (!osxsave || !avx)
+        return Level::Scalar;
+
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0High) << 32) | xcr0Low;
+
+    __cpuid_count(7, 0, a, b, c, d);
+    info[1] = static_cast<int>(b);
+#endif
+
+    // XMM and YMM state, then opmask and ZMM state
+    bool ymmEnabled = (xcr0 & 0x06) == 0x06;
+    bool zmmEnabled = (xcr0 & 0xE0) == 0xE0;
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (ymmEnabled && zmmEnabled && avx512f)
+        return Level::Avx512;
+
+    if (ymmEnabled && avx2)
+        return Level::Avx2;
+
+    return Level::Scalar;
+}
+
+
+/// <summary>
+/// Queries CPUID, and XGETBV for whether the OS saves the YMM registers, to
+/// find whether fused multiply-add instructions can be used.
+/// </summary>
+/// <returns>True if FMA3 is supported</returns>
+bool SimdKernel::detectFma()
+{
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma)
+        return false;
+
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return false;
+
+    bool osxsave = (c & (1 << 27)) != 0;
+    bool fma = (c & (1 << 12)) != 0;
+    if (!osxsave || !fma)
+        return false;
+
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0High) << 32) | xcr0Low;
+#endif
+
+    // XMM and YMM state
+    return (xcr0 & 0x06) == 0x06;
+}
+
+
+/// <summary>
+/// Iterates 1 pixel with the Mandelbrot Set function.
+/// </summary>
+static void mandelbrotScalar(const double* x, double y, int inside, int maxIterations,
+                             double periodicityTolerance, int* iterations)
+{
+    constexpr double THRESHOLD = 16.0;
+
+    if (inside != 0)
+    {
+        iterations[0] = maxIterations;
+        return;
+    }
+
+    double zx = x[0];
+    double zy = y;
+    double savedX = zx;
+    double savedY = zy;
+    int checkpoint = 1;
+
+    for (int n = 0; n < maxIterations; n++)
+    {
+        double t = zx * zx - zy * zy + x[0];
+        zy = 2.0 * zx * zy + y;
+        zx = t;
+
+        if (zx * zx + zy * zy > THRESHOLD)
+        {
+            iterations[0] = n;
+            return;
+        }
+
+        // Returning to a previous point means the orbit is periodic
+        double dx = zx - savedX;
+        double dy = zy - savedY;
+        if (dx * dx + dy * dy < periodicityTolerance)
+            break;
+
+        if (n == checkpoint)
+        {
+            savedX = zx;
+            savedY = zy;
+            checkpoint *= 2;
+        }
+    }
+
+    iterations[0] = maxIterations;
+}
+
+
+/// <summary>
+/// Iterates 4 pixels with the Mandelbrot Set function using AVX2.
+/// Pixels which have become unbounded or periodic are masked out of the
+/// iteration count, and the loop exits early once every pixel is.
+/// </summary>
+TARGET_AVX2
+static void mandelbrotAvx2(const double* x, double y, int inside, int maxIterations,
+                           double periodicityTolerance, int* iterations)
+{
+    const __m256d threshold = _mm256_set1_pd(16.0);
+    const __m256d tolerance = _mm256_set1_pd(periodicityTolerance);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d cx = _mm256_loadu_pd(x);
+    const __m256d cy = _mm256_set1_pd(y);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    // Lanes inside the cardioid or bulb are bounded without iterating
+    __m256d bounded = _mm256_castsi256_pd(_mm256_set_epi64x(-((inside >> 3) & 1), -((inside >> 2) & 1),
+                                                            -((inside >> 1) & 1), -(inside & 1)));
+    __m256d active = _mm256_andnot_pd(bounded, all);
+
+    __m256d zx = cx;
+    __m256d zy = cy;
+    __m256d savedX = zx;
+    __m256d savedY = zy;
+    __m256d count = _mm256_setzero_pd();
+    int checkpoint = 1;
+
+    for (int n = 0; n < maxIterations && _mm256_movemask_pd(active) != 0; n++)
+    {
+        // z[n+1] := z[n]^2 + z[0]
+        __m256d zx2 = _mm256_mul_pd(zx, zx);
+        __m256d zy2 = _mm256_mul_pd(zy, zy);
+        __m256d t = _mm256_add_pd(_mm256_sub_pd(zx2, zy2), cx);
+        zy = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zx, zx), zy), cy);
+        zx = t;
+
+        // Lanes which become unbounded stop counting
+        __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+        __m256d escaped = _mm256_cmp_pd(magnitude, threshold, _CMP_GT_OQ);
+        active = _mm256_andnot_pd(escaped, active);
+
+        // Lanes which return to a previous point are periodic, so bounded
+        __m256d dx = _mm256_sub_pd(zx, savedX);
+        __m256d dy = _mm256_sub_pd(zy, savedY);
+        __m256d distance = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        __m256d periodic = _mm256_and_pd(active, _mm256_cmp_pd(distance, tolerance, _CMP_LT_OQ));
+        active = _mm256_andnot_pd(periodic, active);
+        bounded = _mm256_or_pd(bounded, periodic);
+
+        count = _mm256_add_pd(count, _mm256_and_pd(active, one));
+
+        if (n == checkpoint)
+        {
+            savedX = zx;
+            savedY = zy;
+            checkpoint *= 2;
+        }
+    }
+
+    count = _mm256_blendv_pd(count, _mm256_set1_pd(maxIterations), bounded);
+    __m128i counts = _mm256_cvttpd_epi32(count);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iterations), counts);
+}
+
+
+/// <summary>
+/// Iterates 8 pixels with the Mandelbrot Set function using AVX-512.
+/// Pixels which have become unbounded or periodic are masked out of the
+/// iteration count, and the loop exits early once every pixel is.
+/// </summary>
+TARGET_AVX512
+static void mandelbrotAvx512(const double* x, double y, int inside, int maxIterations,
+                             double periodicityTolerance, int* iterations)
+{
+    const __m512d threshold = _mm512_set1_pd(16.0);
+    const __m512d tolerance = _mm512_set1_pd(periodicityTolerance);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d cx = _mm512_loadu_pd(x);
+    const __m512d cy = _mm512_set1_pd(y);
+
+    // Lanes inside the cardioid or bulb are bounded without iterating
+    __mmask8 bounded = static_cast<__mmask8>(inside);
+    __mmask8 active = ~bounded;
+
+    __m512d zx = cx;
+    __m512d zy = cy;
+    __m512d savedX = zx;
+    __m512d savedY = zy;
+    __m512d count = _mm512_setzero_pd();
+    int checkpoint = 1;
+
+    for (int n = 0; n < maxIterations && active != 0; n++)
+    {
+        // z[n+1] := z[n]^2 + z[0]
+        __m512d zx2 = _mm512_mul_pd(zx, zx);
+        __m512d zy2 = _mm512_mul_pd(zy, zy);
+        __m512d t = _mm512_add_pd(_mm512_sub_pd(zx2, zy2), cx);
+        zy = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(zx, zx), zy), cy);
+        zx = t;
+
+        // Lanes which become unbounded stop counting
+        __m512d magnitude = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+        active &= ~_mm512_cmp_pd_mask(magnitude, threshold, _CMP_GT_OQ);
+
+        // Lanes which return to a previous point are periodic, so bounded
+        __m512d dx = _mm512_sub_pd(zx, savedX);
+        __m512d dy = _mm512_sub_pd(zy, savedY);
+        __m512d distance = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+        __mmask8 periodic = active & _mm512_cmp_pd_mask(distance, tolerance, _CMP_LT_OQ);
+        active &= ~periodic;
+        bounded |= periodic;
+
+        count = _mm512_mask_add_pd(count, active, count, one);
+
+        if (n == checkpoint)
+        {
+            savedX = zx;
+            savedY = zy;
+            checkpoint *= 2;
+        }
+    }
+
+    count = _mm512_mask_blend_pd(bounded, count, _mm512_set1_pd(maxIterations));
+    __m256i counts = _mm512_cvttpd_epi32(count);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(iterations), counts);
+}
+
+
+/// <summary>
+/// Iterates getWidth() adjacent pixels of a row with the Mandelbrot Set
+/// function.
+/// </summary>
+/// <param name="x">Array of getWidth() real parts of the pixels</param>
+/// <param name="y">Imaginary part shared by the row of pixels</param>
+/// <param name="maxIterations">The maximum number of iterations</param>
+/// <param name="interiorIsChecked">True to skip pixels in the main cardioid
+/// or period 2 bulb, false to iterate them to the limit</param>
+/// <param name="periodicityTolerance">Squared distance within which an orbit
+/// returning to a previous point is treated as periodic, or 0 to disable
+/// periodicity checking</param>
+/// <param name="iterations">Array of getWidth() iteration counts to write the
+/// number of iterations until each pixel became unbounded, or maxIterations
+/// if it remained bounded</param>
+void SimdKernel::mandelbrot(const double* x, double y, int maxIterations, bool interiorIsChecked,
+                            double periodicityTolerance, int* iterations) const
+{
+    // Tested here rather than in the kernels, where the compiler may fuse
+    // the arithmetic differently and so disagree on points near the border
+    int inside = 0;
+    for (int i = 0; interiorIsChecked && i < getWidth(); ++i)
+        if (isInCardioidOrBulb(x[i], y))
+            inside |= 1 << i;
+
+    switch (m_level)
+    {
+    case Level::Avx512:
+        mandelbrotAvx512(x, y, inside, maxIterations, periodicityTolerance, iterations);
+        break;
+
+    case Level::Avx2:
+        mandelbrotAvx2(x, y, inside, maxIterations, periodicityTolerance, iterations);
+        break;
+
+    default:
+        mandelbrotScalar(x, y, inside, maxIterations, periodicityTolerance, iterations);
+        break;
+    }
+}
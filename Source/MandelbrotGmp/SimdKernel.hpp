@@ -0,0 +1,29 @@
+#pragma once
+
+class SimdKernel
+{
+public:
+    enum class Level
+    {
+        Scalar,
+        Avx2,
+        Avx512
+    };
+
+    static constexpr int MAX_WIDTH = 8;
+    static const bool FMA_IS_SUPPORTED;
+
+    SimdKernel();
+    SimdKernel(Level level);
+    ~SimdKernel();
+
+    static Level detectLevel();
+    static bool detectFma();
+    Level getLevel() const;
+    int getWidth() const;
+    void mandelbrot(const double* x, double y, int maxIterations, bool interiorIsChecked,
+                    double periodicityTolerance, int* iterations) const;
+
+private:
+    Level m_level;
+};
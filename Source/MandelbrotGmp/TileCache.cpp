@@ -0,0 +1,269 @@
+#include "TileCache.hpp"
+#include "MandelbrotEngine.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <omp.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAGIC[4] = { 'M', 'T', 'C', '1' };
+
+
+/// <summary>
+/// Content addressed cache of rendered tiles on disk, so that views which
+/// are visited again, such as the initial view or favourite locations, are
+/// loaded rather than rendered.
+/// Each tile is stored in its own file, named by the hash of a key
+/// describing exactly what was rendered, holding the key and the tile's
+/// run length encoded iteration counts.
+/// </summary>
+/// <param name="directory">The directory to keep the cache in, which is
+/// created if it does not exist</param>
+TileCache::TileCache(const std::string& directory) :
+    m_directory(directory)
+{
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+TileCache::~TileCache() {}
+
+
+/// <summary>
+/// Describes a tile of a render exactly: the version of the engine's
+/// output, the viewport quantised to the precision of the view, the
+/// resolution, the iteration limit, the engine settings which change the
+/// counts, and the position of the tile on the screen.
+/// CACHE_VERSION must be raised whenever the counts the engine renders
+/// change, such as by a change to a kernel, to perturbation or to the
+/// quantisation here, so tiles left by an older build are not loaded.
+/// The SIMD level is left out, as every level renders the same counts.
+/// </summary>
+/// <param name="view">The view being rendered</param>
+/// <param name="engine">The engine rendering it, with the view prepared</param>
+/// <param name="tile">The region of the screen the tile covers</param>
+/// <returns>Key identifying the tile</returns>
+std::string TileCache::makeKey(const View& view, const MandelbrotEngine& engine, const PixelRect& tile)
+{
+    const ComplexRect viewport = view.getViewport();
+    const unsigned long long bits = view.getPrecision();
+
+    return "version " + std::to_string(CACHE_VERSION) +
+           " viewport " + quantise(viewport.left, bits) + " " + quantise(viewport.top, bits) + " " +
+           quantise(viewport.width, bits) + " " + quantise(viewport.height, bits) +
+           " screen " + std::to_string(view.getScreenSize().x) + "x" + std::to_string(view.getScreenSize().y) +
+           " iterations " + std::to_string(engine.getMaxIterations()) +
+           " full " + std::to_string(engine.getFullPrecisionIsForced()) +
+           " series " + std::to_string(engine.getSeriesApproximationIsEnabled()) +
+           " traced " + std::to_string(engine.getBoundaryTracingIsEnabled()) +
+           " interior " + std::to_string(engine.getInteriorDetectionIsEnabled()) +
+           " periodicity " + std::to_string(engine.getPeriodicityDetectionIsEnabled()) +
+           " tile " + std::to_string(tile.left) + "," + std::to_string(tile.top) + "," +
+           std::to_string(tile.width) + "x" + std::to_string(tile.height);
+}
+
+
+/// <summary>
+/// Copies a cached tile into a buffer of iteration counts.
+/// </summary>
+/// <param name="key">Key of the tile from makeKey()</param>
+/// <param name="width">The width of the tile</param>
+/// <param name="height">The height of the tile</param>
+/// <param name="iterations">The top left count of the tile in the buffer</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+/// <returns>True if the tile was cached, otherwise the buffer is unchanged</returns>
+bool TileCache::load(const std::string& key, int width, int height, float* iterations, int stride) const
+{
+    MappedFile file(pathOf(key));
+    const char* data = file.getData();
+    const size_t size = file.getSize();
+
+    Header header;
+    if (size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    const size_t runsOffset = sizeof(header) + header.keyLength;
+
+    // Hashes can collide, so the whole key is compared
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.width != static_cast<std::uint32_t>(width) ||
+        header.height != static_cast<std::uint32_t>(height) ||
+        header.keyLength != key.size() ||
+        size != runsOffset + header.runCount * sizeof(Run) ||
+        memcmp(data + sizeof(header), key.data(), key.size()) != 0)
+        return false;
+
+    // Check the runs cover the tile before writing any of them
+    const char* runs = data + runsOffset;
+    unsigned long long total = 0;
+    for (std::uint32_t i = 0; i < header.runCount; ++i)
+    {
+        Run run;
+        memcpy(&run, runs + i * sizeof(Run), sizeof(Run));
+        total += run.length;
+    }
+
+    if (total != static_cast<unsigned long long>(width) * height)
+        return false;
+
+    int x = 0;
+    int y = 0;
+    for (std::uint32_t i = 0; i < header.runCount; ++i)
+    {
+        Run run;
+        memcpy(&run, runs + i * sizeof(Run), sizeof(Run));
+
+        for (std::uint32_t n = 0; n < run.length; ++n)
+        {
+            iterations[y * stride + x] = run.value;
+
+            if (++x == width)
+            {
+                x = 0;
+                ++y;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/// <summary>
+/// Saves a rendered tile to the cache.
+/// The file is written under a temporary name then renamed, so a tile being
+/// written is never read by another thread or process. The temporary name
+/// holds the process and thread, as processes may share a cache.
+/// </summary>
+/// <param name="key">Key of the tile from makeKey()</param>
+/// <param name="width">The width of the tile</param>
+/// <param name="height">The height of the tile</param>
+/// <param name="iterations">The top left count of the tile in the buffer</param>
+/// <param name="stride">The number of counts in each row of the buffer</param>
+/// <returns>True if the tile was saved</returns>
+bool TileCache::store(const std::string& key, int width, int height, const float* iterations, int stride) const
+{
+    // Run length encode the tile row by row, as runs may continue across rows
+    std::vector<Run> runs;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const float value = iterations[y * stride + x];
+
+            if (!runs.empty() && runs.back().value == value)
+                ++runs.back().length;
+            else
+                runs.push_back({ 1, value });
+        }
+    }
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.keyLength = static_cast<std::uint32_t>(key.size());
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.runCount = static_cast<std::uint32_t>(runs.size());
+
+    const std::string path = pathOf(key);
+    const std::string temporary = path + "." + std::to_string(getpid()) + "." +
+                                  std::to_string(omp_get_thread_num()) + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(key.data(), key.size());
+        file.write(reinterpret_cast<const char*>(runs.data()), runs.size() * sizeof(Run));
+
+        if (!file.good())
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    // Renaming fails if another render stored the same tile first
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+/// <summary>
+/// The path of the file a tile is stored in.
+/// </summary>
+/// <param name="key">Key of the tile</param>
+/// <returns>Path within the cache directory</returns>
+std::string TileCache::pathOf(const std::string& key) const
+{
+    char name[32];
+    sprintf_s(name, "%016llx.tile", static_cast<unsigned long long>(hash(key)));
+    return m_directory + "/" + name;
+}
+
+
+/// <summary>
+/// 64 bit FNV-1a hash.
+/// </summary>
+/// <param name="text">The text to hash</param>
+/// <returns>The hash of the text</returns>
+std::uint64_t TileCache::hash(const std::string& text)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+/// <summary>
+/// Formats a number rounded to the given number of significant bits, so
+/// that views which differ only beyond their precision share a key.
+/// </summary>
+/// <param name="value">The number to format</param>
+/// <param name="bits">The number of significant bits to keep</param>
+/// <returns>Exact hexadecimal text of the rounded number</returns>
+std::string TileCache::quantise(const Real& value, unsigned long long bits)
+{
+#ifdef UseArbitraryPrecision
+    // Each hexadecimal digit holds 4 bits
+    return value.toString(16, static_cast<size_t>(bits / 4 + 1));
+#else
+    int exponent;
+    const double mantissa = frexp(value, &exponent);
+    const double scale = ldexp(1.0, static_cast<int>(std::min<unsigned long long>(bits, 53)));
+
+    char text[40];
+    sprintf_s(text, "%a", ldexp(round(mantissa * scale) / scale, exponent));
+    return text;
+#endif
+}
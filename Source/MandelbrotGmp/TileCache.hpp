@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "View.hpp"
+
+class MandelbrotEngine;
+
+class TileCache
+{
+public:
+    static constexpr int CACHE_VERSION = 1;
+
+    TileCache(const std::string& directory);
+    ~TileCache();
+
+    static std::string makeKey(const View& view, const MandelbrotEngine& engine, const PixelRect& tile);
+    bool load(const std::string& key, int width, int height, float* iterations, int stride) const;
+    bool store(const std::string& key, int width, int height, const float* iterations, int stride) const;
+
+private:
+    struct Run
+    {
+        std::uint32_t length;
+        float value;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t keyLength;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t runCount;
+    };
+
+    std::string m_directory;
+
+    std::string pathOf(const std::string& key) const;
+    static std::uint64_t hash(const std::string& text);
+    static std::string quantise(const Real& value, unsigned long long bits);
+};
@@ -0,0 +1,126 @@
+#include "TileQueue.hpp"
+
+
+/// <summary>
+/// Constructs an empty bounded queue of finished tiles, which any number of
+/// rendering threads can push to and the drawing thread can pop from without
+/// locking. Each cell has a sequence number which says whether it is ready to
+/// be written or read for the current lap around the ring, and threads claim
+/// cells by advancing the head or tail with compare and swap.
+/// </summary>
+/// <param name="capacity">The most tiles the queue can hold, which is
+/// rounded up to a power of two</param>
+TileQueue::TileQueue(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size *= 2;
+
+    m_cells = new Cell[size];
+    m_mask = size - 1;
+
+    for (size_t i = 0; i < size; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+TileQueue::~TileQueue()
+{
+    delete[] m_cells;
+}
+
+
+/// <summary>
+/// Adds a tile to the back of the queue.
+/// Releases the pixels written before it to the thread which pops it.
+/// </summary>
+/// <param name="tile">The tile which has finished</param>
+/// <param name="generation">The rendering the tile belongs to, so tiles of
+/// abandoned renderings can be told apart</param>
+/// <returns>False if the queue is full, so the tile was not added</returns>
+bool TileQueue::push(const PixelRect& tile, unsigned generation)
+{
+    size_t position = m_tail.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        Cell& cell = m_cells[position & m_mask];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const ptrdiff_t lap = static_cast<ptrdiff_t>(sequence - position);
+
+        if (lap == 0)
+        {
+            // The cell is free, so claim it unless another thread got there first
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.tile = tile;
+                cell.generation = generation;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (lap < 0)
+        {
+            // The cell still holds a tile from the previous lap
+            return false;
+        }
+        else
+        {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/// <summary>
+/// Removes the tile at the front of the queue.
+/// </summary>
+/// <param name="tile">Set to the tile removed</param>
+/// <param name="generation">Set to the rendering the tile belongs to</param>
+/// <returns>False if the queue is empty</returns>
+bool TileQueue::pop(PixelRect& tile, unsigned& generation)
+{
+    size_t position = m_head.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        Cell& cell = m_cells[position & m_mask];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const ptrdiff_t lap = static_cast<ptrdiff_t>(sequence - (position + 1));
+
+        if (lap == 0)
+        {
+            if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                tile = cell.tile;
+                generation = cell.generation;
+                cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (lap < 0)
+        {
+            // The cell has not been written yet this lap
+            return false;
+        }
+        else
+        {
+            position = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/// <summary>
+/// Discards every tile in the queue, such as those left by a cancelled
+/// rendering.
+/// </summary>
+void TileQueue::clear()
+{
+    PixelRect tile;
+    unsigned generation;
+    while (pop(tile, generation)) {}
+}
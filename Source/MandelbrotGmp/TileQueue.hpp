@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "View.hpp"
+
+class TileQueue
+{
+public:
+    TileQueue(size_t capacity);
+    ~TileQueue();
+
+    bool push(const PixelRect& tile, unsigned generation);
+    bool pop(PixelRect& tile, unsigned& generation);
+    void clear();
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        PixelRect tile;
+        unsigned generation;
+    };
+
+    Cell* m_cells;
+    size_t m_mask;
+    std::atomic<size_t> m_head;
+    std::atomic<size_t> m_tail;
+};
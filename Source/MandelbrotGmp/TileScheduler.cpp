@@ -0,0 +1,143 @@
+#include "TileScheduler.hpp"
+#include <algorithm>
+#include <omp.h>
+
+
+/// <summary>
+/// Splits the screen into square tiles and distributes them between the
+/// OpenMP threads. Each thread works through its own queue of tiles, then
+/// steals tiles from the other threads' queues, so no thread sits idle while
+/// another is stuck on tiles in the interior of the set.
+/// </summary>
+TileScheduler::TileScheduler() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+TileScheduler::~TileScheduler() {}
+
+
+/// <summary>
+/// Splits regions of the screen into tiles of at most TILE_SIZE pixels
+/// square, ordered so that the tiles nearest the focus are rendered first.
+/// </summary>
+/// <param name="regions">The regions of the screen to be rendered, which
+/// should not overlap</param>
+/// <param name="focus">The pixel the user is looking at, such as the centre
+/// of the screen or the mouse position</param>
+void TileScheduler::split(const std::vector<PixelRect>& regions, Pixel focus)
+{
+    m_tiles.clear();
+
+    for (const PixelRect& region : regions)
+        for (int y = region.top; y < region.top + region.height; y += TILE_SIZE)
+            for (int x = region.left; x < region.left + region.width; x += TILE_SIZE)
+                m_tiles.push_back(PixelRect(
+                    x, y,
+                    std::min(TILE_SIZE, region.left + region.width - x),
+                    std::min(TILE_SIZE, region.top + region.height - y)));
+
+    // Order by the distance from the centre of each tile to the focus
+    auto distance = [focus](const PixelRect& tile)
+    {
+        long long dx = 2 * tile.left + tile.width - 2 * focus.x;
+        long long dy = 2 * tile.top + tile.height - 2 * focus.y;
+        return dx * dx + dy * dy;
+    };
+
+    std::stable_sort(m_tiles.begin(), m_tiles.end(),
+        [&distance](const PixelRect& a, const PixelRect& b) { return distance(a) < distance(b); });
+}
+
+/// <summary>
+/// Getter for the tiles created by split(), in rendering order
+/// </summary>
+/// <returns>The tiles</returns>
+const std::vector<PixelRect>& TileScheduler::getTiles() const { return m_tiles; }
+
+
+/// <summary>
+/// Removes the tiles which no longer need rendering, such as those already
+/// available from a cache, keeping the rest in order.
+/// </summary>
+/// <param name="isDone">Returns true for tiles which should be removed</param>
+void TileScheduler::removeTiles(const std::function<bool(const PixelRect&)>& isDone)
+{
+    m_tiles.erase(std::remove_if(m_tiles.begin(), m_tiles.end(), isDone), m_tiles.end());
+}
+
+
+/// <summary>
+/// Renders every tile using all of the OpenMP threads.
+/// The tiles are dealt out in order so that every thread begins near the
+/// focus, and the cancelling flag is checked before each tile is started.
+/// </summary>
+/// <param name="renderTile">Function to render a single tile, which will be
+/// called from several threads at once</param>
+/// <param name="cancelling">Flag to stop rendering tiles early</param>
+void TileScheduler::run(const std::function<void(const PixelRect&)>& renderTile, const std::atomic<bool>& cancelling) const
+{
+    const int threadCount = omp_get_max_threads();
+    std::deque<WorkQueue> queues(threadCount);
+
+    for (size_t i = 0; i < m_tiles.size(); ++i)
+        queues[i % threadCount].tiles.push_back(m_tiles[i]);
+
+#pragma omp parallel num_threads(threadCount)
+    {
+        const int self = omp_get_thread_num();
+        PixelRect tile;
+
+        // If the team is smaller than requested, the queues without a thread
+        // are emptied by stealing
+        while (!cancelling && (pop(queues[self], tile) || steal(queues, self, tile)))
+            renderTile(tile);
+    }
+}
+
+
+/// <summary>
+/// Takes the next tile from the front of a thread's own queue.
+/// </summary>
+/// <param name="queue">The thread's queue</param>
+/// <param name="tile">Set to the tile taken, if any</param>
+/// <returns>True if a tile was taken</returns>
+bool TileScheduler::pop(WorkQueue& queue, PixelRect& tile)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tiles.empty())
+        return false;
+
+    tile = queue.tiles.front();
+    queue.tiles.pop_front();
+    return true;
+}
+
+/// <summary>
+/// Takes a tile from the back of another thread's queue, which is the end
+/// furthest from the focus and the end the owner is not working from.
+/// </summary>
+/// <param name="queues">Every thread's queue</param>
+/// <param name="thief">The index of the queue belonging to this thread</param>
+/// <param name="tile">Set to the tile taken, if any</param>
+/// <returns>True if a tile was taken</returns>
+bool TileScheduler::steal(std::deque<WorkQueue>& queues, int thief, PixelRect& tile)
+{
+    const int count = static_cast<int>(queues.size());
+
+    for (int offset = 1; offset < count; ++offset)
+    {
+        WorkQueue& victim = queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tiles.empty())
+        {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
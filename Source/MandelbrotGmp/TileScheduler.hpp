@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "View.hpp"
+
+class TileScheduler
+{
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    TileScheduler();
+    ~TileScheduler();
+
+    void split(const std::vector<PixelRect>& regions, Pixel focus);
+    const std::vector<PixelRect>& getTiles() const;
+    void removeTiles(const std::function<bool(const PixelRect&)>& isDone);
+    void run(const std::function<void(const PixelRect&)>& renderTile, const std::atomic<bool>& cancelling) const;
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<PixelRect> tiles;
+    };
+
+    std::vector<PixelRect> m_tiles;
+
+    static bool pop(WorkQueue& queue, PixelRect& tile);
+    static bool steal(std::deque<WorkQueue>& queues, int thief, PixelRect& tile);
+};
@@ -1,4 +1,40 @@
 #include "View.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+/// <summary>
+/// Formats a number with every digit, so that parseExact() reads back
+/// exactly the same number.
+/// </summary>
+static std::string formatExact(const Real& value)
+{
+#ifdef UseArbitraryPrecision
+    return value.toString(16, 0);
+#else
+    char text[40];
+    sprintf_s(text, "%a", value);
+    return text;
+#endif
+}
+
+/// <summary>
+/// Parses a number formatted by formatExact().
+/// </summary>
+/// <returns>True if the text was a number</returns>
+static bool parseExact(const std::string& text, Real& value)
+{
+#ifdef UseArbitraryPrecision
+    // Each hexadecimal digit holds 4 bits
+    value.setPrecision(4 * text.size() + 64);
+    return value.fromString(text, 16);
+#else
+    char* end;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+#endif
+}
 
 /// <summary>
 /// Constructor
@@ -41,6 +77,13 @@ void View::resizeScreen(int screenWidth, int screenHeight)
 }
 
 
+/// <summary>
+/// Getter for screenSize.
+/// </summary>
+/// <returns>The width and height of the screen in pixels</returns>
+Pixel View::getScreenSize() const { return m_screenSize; }
+
+
 /// <summary>
 /// Getter for dirty.
 /// If the view is dirty, changes have occured to the view recently indicating
@@ -58,6 +101,15 @@ bool View::isDirty() const { return m_dirty; }
 void View::isDirty(bool d) { m_dirty = d; }
 
 
+/// <summary>
+/// Getter for precision.
+/// This is the number of mantissa bits needed to tell apart the complex
+/// numbers at adjacent pixels, with some bits to spare.
+/// </summary>
+/// <returns>Required precision in bits</returns>
+unsigned long long View::getPrecision() const { return m_precision; }
+
+
 /// <summary>
 /// Getter for m_scale.
 /// </summary>
@@ -238,6 +290,7 @@ void View::setViewport(ComplexRect r)
     m_zoom = log2(static_cast<double>(m_scale));
     m_centre.x = r.left + HALF * r.width;
     m_centre.y = r.top  + HALF * r.height;
+    updatePrecision();
     isDirty(true);
 }
 
@@ -247,11 +300,32 @@ void View::setViewport(ComplexRect r)
 /// </summary>
 void View::updateViewport()
 {
+    updatePrecision();
     Complex scaleVector(m_scale * m_aspectRatio, m_scale);
     m_rect = ComplexRect(m_centre - scaleVector, scaleVector);
 }
 
 
+/// <summary>
+/// Recalculates the precision required by the current scale and screen
+/// height. Pixels are 2 * scale / height apart and coordinates are at most
+/// around 2 in magnitude, so the mantissa needs log2(height) - zoom bits.
+/// In arbitrary precision, the centre and scale are stored at exactly this
+/// precision, which every number calculated from them inherits.
+/// </summary>
+void View::updatePrecision()
+{
+    const double bits = log2(static_cast<double>(m_screenSize.y)) - static_cast<double>(m_zoom) + GUARD_BITS;
+    m_precision = static_cast<unsigned long long>(ceil(fmax(bits, 1.0)));
+
+#ifdef UseArbitraryPrecision
+    m_centre.x.setPrecision(m_precision);
+    m_centre.y.setPrecision(m_precision);
+    m_scale.setPrecision(m_precision);
+#endif
+}
+
+
 /// <summary>
 /// Getter for centre position.
 /// </summary>
@@ -291,6 +365,26 @@ void View::moveBy(Real dx, Real dy)
     updateViewport();
 }
 
+/// <summary>
+/// Incrementer for centre position in whole pixels.
+/// Moves the centre position so that every pixel of the view lands exactly on
+/// a pixel of the view before the move, dx pixels to the right and dy pixels
+/// down.
+/// Also updates the viewport accordingly.
+/// The view is now dirty.
+/// </summary>
+/// <param name="dx">Number of pixels to move right</param>
+/// <param name="dy">Number of pixels to move down</param>
+void View::moveByPixels(int dx, int dy)
+{
+    // Each pixel is 2 * scale / height wide, see complexAtPixel
+    Real pixelSize = 2 * m_scale / static_cast<Real>(m_screenSize.y);
+    m_centre.x += pixelSize * static_cast<Real>(dx);
+    m_centre.y += pixelSize * static_cast<Real>(dy);
+    isDirty(true);
+    updateViewport();
+}
+
 /// <summary>
 /// Setter for centre position.
 /// Moves the centre position in the complex plane to the provided complex
@@ -323,6 +417,22 @@ void View::moveTo(Real x, Real y)
     updateViewport();
 }
 
+/// <summary>
+/// Moves to exactly the centre and scale of another view, such as a
+/// bookmark, keeping this view's screen size, so the same height of the
+/// complex plane is shown.
+/// The view is now dirty.
+/// </summary>
+/// <param name="view">The view to move to</param>
+void View::jumpTo(const View& view)
+{
+    m_zoom = view.m_zoom;
+    m_scale = view.m_scale;
+    m_centre = view.m_centre;
+    isDirty(true);
+    updateViewport();
+}
+
 
 /// <summary>
 /// Converts pixel coordinates in the screen, p(x, y), to the complex number
@@ -380,6 +490,93 @@ Pixel View::pixelAtComplex(Real x, Real y) const
 }
 
 
+/// <summary>
+/// Finds whether this view is another view moved by a whole number of pixels,
+/// at the same scale and screen size, such that pixel p of this view is pixel
+/// p + shift of the other view.
+/// </summary>
+/// <param name="other">The view to compare against</param>
+/// <param name="shift">Set to the number of pixels moved, if whole</param>
+/// <returns>True if the views only differ by a whole pixel shift</returns>
+bool View::getPixelShift(const View& other, Pixel& shift) const
+{
+    constexpr double TOLERANCE = 1e-3;
+
+    if (m_screenSize != other.m_screenSize || m_scale != other.m_scale)
+        return false;
+
+    // Displacement of the centre measured in pixels
+    Real pixelsPerUnit = static_cast<Real>(m_screenSize.y) / (2 * m_scale);
+    double dx = static_cast<double>((m_centre.x - other.m_centre.x) * pixelsPerUnit);
+    double dy = static_cast<double>((m_centre.y - other.m_centre.y) * pixelsPerUnit);
+
+    shift = Pixel(static_cast<int>(round(dx)), static_cast<int>(round(dy)));
+
+    return abs(dx - shift.x) < TOLERANCE && abs(dy - shift.y) < TOLERANCE;
+}
+
+
+/// <summary>
+/// Operator overload for ==
+/// Views are equal if they show the same region of the complex plane on the
+/// same size of screen, so would render the same pixels.
+/// </summary>
+/// <param name="other">The view to compare with</param>
+/// <returns>True if the views are equal</returns>
+bool View::operator==(const View& other) const
+{
+    return m_screenSize == other.m_screenSize && m_scale == other.m_scale &&
+           m_centre.x == other.m_centre.x && m_centre.y == other.m_centre.y;
+}
+
+
+/// <summary>
+/// Writes the view as text which deserialise() turns back into exactly the
+/// same view, unlike operator<<, which rounds to doubles for reading.
+/// The screen size is followed by the zoom, scale and centre, with every
+/// digit in hexadecimal.
+/// </summary>
+/// <returns>A single line of text, without a newline</returns>
+std::string View::serialise() const
+{
+    std::ostringstream text;
+    text << m_screenSize.x << " " << m_screenSize.y << " " << formatExact(m_zoom) << " " << formatExact(m_scale)
+         << " " << formatExact(m_centre.x) << " " << formatExact(m_centre.y);
+    return text.str();
+}
+
+/// <summary>
+/// Replaces the view with one written by serialise().
+/// The view is now dirty.
+/// </summary>
+/// <param name="text">Text from serialise()</param>
+/// <returns>True if the text was a view, otherwise the view is unchanged</returns>
+bool View::deserialise(const std::string& text)
+{
+    std::istringstream in(text);
+    int width, height;
+    std::string zoomText, scaleText, xText, yText;
+
+    if (!(in >> width >> height >> zoomText >> scaleText >> xText >> yText) || width <= 0 || height <= 0)
+        return false;
+
+    Real zoom, scale, x, y;
+    if (!parseExact(zoomText, zoom) || !parseExact(scaleText, scale) ||
+        !parseExact(xText, x) || !parseExact(yText, y))
+        return false;
+
+    m_screenSize = Pixel(width, height);
+    m_aspectRatio = static_cast<Real>(width) / static_cast<Real>(height);
+    m_zoom = zoom;
+    m_scale = scale;
+    m_centre.x = x;
+    m_centre.y = y;
+    isDirty(true);
+    updateViewport();
+    return true;
+}
+
+
 /// <summary>
 /// Operator overload for <<
 /// Allows the view object to be printed to standard output streams.
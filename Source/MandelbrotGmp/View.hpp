@@ -2,6 +2,7 @@
 
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <string>
 
 // From project configuration preprocessor
 #ifdef UseArbitraryPrecision
@@ -19,6 +20,8 @@ typedef sf::Rect<int> PixelRect;
 class View
 {
 private:
+    static constexpr int GUARD_BITS = 12;
+
     bool m_dirty = true;
     Real m_scale = 2.0;       // = 2^zoom
     Real m_zoom = 1.0;        // = log2(scale)
@@ -26,21 +29,29 @@ private:
     ComplexRect m_rect;       // = centre  scale
     Pixel m_screenSize;
     Real m_aspectRatio;
+    unsigned long long m_precision = 0;
     bool m_zoomBoxIsShown = false;
     Pixel m_zoomBoxStartCorner;
     Pixel m_zoomBoxEndCorner;
     sf::RectangleShape m_zoomBoxShape;
 
     void updateViewport();
+    void updatePrecision();
     friend std::ostream& operator<<(std::ostream& out, const View& v);
 
 public:
     View(Real x = 0, Real y = 0, Real zoom = 1,
          int screenWidth = 1, int screenHeight = 1);
     ~View();
+    View(const View& other) = default;
+    View(View&& other) = default;
+    View& operator=(const View& other) = default;
+    View& operator=(View&& other) = default;
     void resizeScreen(int screenWidth, int screenHeight);
+    Pixel getScreenSize() const;
     bool isDirty() const;
     void isDirty(bool d);
+    unsigned long long getPrecision() const;
     Real getScale() const;
     void setScale(Real s);
     Real getZoom() const;
@@ -49,8 +60,10 @@ public:
     Complex getCentre() const;
     void moveBy(Complex displacement);
     void moveBy(Real dx, Real dy);
+    void moveByPixels(int dx, int dy);
     void moveTo(Complex position);
     void moveTo(Real x, Real y);
+    void jumpTo(const View& view);
     ComplexRect getViewport() const;
     Complex getViewportPosition() const;
     Complex getViewportSize() const;
@@ -59,6 +72,10 @@ public:
     Complex complexAtPixel(int x, int y) const;
     Pixel pixelAtComplex(Complex z) const;
     Pixel pixelAtComplex(Real x, Real y) const;
+    bool getPixelShift(const View& other, Pixel& shift) const;
+    bool operator==(const View& other) const;
+    std::string serialise() const;
+    bool deserialise(const std::string& text);
     void zoomBoxBegin(int x, int y);
     void zoomBoxContinue(int x, int y);
     void zoomBoxEnd(int x, int y);
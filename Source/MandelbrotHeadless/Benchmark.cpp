@@ -0,0 +1,168 @@
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <omp.h>
+
+/// <summary>
+/// The views measured besides the shared ones. The minibrot is the period
+/// 8007 nucleus nearest the seahorse valley point, found by Newton's method,
+/// and needs enough iterations for the points around it to escape.
+/// </summary>
+const HeadlessRenderer::Location Benchmark::LOCATIONS[] =
+{
+    { "minibrot-1e-30", "-0.743643887037158704752191506114779778215256208",
+      "0.131825904205311970493132056385140678972952279", -100.0, 100000 },
+};
+
+
+/// <summary>
+/// Renders a fixed set of views repeatedly to measure the engine, so that
+/// changes to it can be compared between builds.
+/// </summary>
+/// <param name="width">The width of each frame in pixels</param>
+/// <param name="height">The height of each frame in pixels</param>
+/// <param name="frames">The number of times each view is rendered for each
+/// thread count</param>
+Benchmark::Benchmark(int width, int height, int frames) :
+    m_width(width),
+    m_height(height),
+    m_frames(std::max(1, frames))
+{
+    m_iterations = new float[m_width * m_height];
+    m_engine.setTarget(m_iterations, PixelRect(0, 0, m_width, m_height));
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Benchmark::~Benchmark()
+{
+    delete[] m_iterations;
+}
+
+
+/// <summary>
+/// The thread counts to measure scaling with when none are given: powers of
+/// two up to the number of OpenMP threads, and that number itself.
+/// </summary>
+/// <returns>Thread counts in increasing order</returns>
+std::vector<int> Benchmark::defaultThreadCounts()
+{
+    const int maxThreads = omp_get_max_threads();
+    std::vector<int> threadCounts;
+
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+
+    threadCounts.push_back(maxThreads);
+    return threadCounts;
+}
+
+
+/// <summary>
+/// Measures every view with every thread count and writes the results as
+/// JSON, so they can be tracked between releases.
+/// Iterations are the sum of the iteration counts of the pixels, so bounded
+/// pixels count as the iteration limit even when they are detected early.
+/// Speedup is relative to the first thread count.
+/// </summary>
+/// <param name="out">Stream to write the JSON to</param>
+/// <param name="threadCounts">The numbers of threads to render with</param>
+void Benchmark::run(std::ostream& out, const std::vector<int>& threadCounts)
+{
+    static const char* const LEVELS[] = { "scalar", "avx2", "avx512" };
+    const int pixels = m_width * m_height;
+
+    HeadlessRenderer::writeJsonHeader(out, m_width, m_height);
+    out << "  \"simd\": \"" << LEVELS[static_cast<int>(SimdKernel().getLevel())] << "\",\n"
+        << "  \"frames\": " << m_frames << ",\n"
+        << "  \"results\": [";
+
+    const char* separator = "\n";
+
+    for (const HeadlessRenderer::Location& location :
+         HeadlessRenderer::locationsWith(LOCATIONS, sizeof(LOCATIONS) / sizeof(LOCATIONS[0])))
+    {
+        const View view = HeadlessRenderer::makeView(location, m_width, m_height);
+
+        const int maxIterations = location.maxIterations > 0 ? location.maxIterations
+                                                             : MandelbrotEngine::defaultMaxIterations(view);
+
+        out << separator << "    { \"location\": \"" << location.name << "\", \"zoom\": " << location.zoom
+            << ", \"maxIterations\": " << maxIterations;
+        separator = ",\n";
+
+        if (!HeadlessRenderer::canRender(view))
+        {
+            out << ", \"skipped\": \"needs arbitrary precision\" }";
+            continue;
+        }
+
+        out << ", \"runs\": [";
+
+        double firstSeconds = 0;
+
+        for (size_t i = 0; i < threadCounts.size(); ++i)
+        {
+            std::cerr << location.name << " with " << threadCounts[i] << " threads" << std::endl;
+
+            const Result result = measure(view, maxIterations, threadCounts[i]);
+
+            if (i == 0)
+                firstSeconds = result.meanSeconds;
+
+            out << (i == 0 ? "\n" : ",\n")
+                << "      { \"threads\": " << threadCounts[i]
+                << ", \"bestFrameSeconds\": " << result.bestSeconds
+                << ", \"meanFrameSeconds\": " << result.meanSeconds
+                << ", \"iterations\": " << result.iterations
+                << ", \"megaIterationsPerSecond\": " << result.iterations / result.meanSeconds / 1e6
+                << ", \"nanosecondsPerPixel\": " << result.meanSeconds * 1e9 / pixels
+                << ", \"speedup\": " << firstSeconds / result.meanSeconds << " }";
+        }
+
+        out << "\n    ] }";
+    }
+
+    out << "\n  ]\n}" << std::endl;
+}
+
+
+/// <summary>
+/// Renders a view every frame with a number of threads and times it,
+/// including the work shared by the pixels such as the reference orbit.
+/// </summary>
+/// <param name="view">The view to render</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <param name="threadCount">The number of threads to render with</param>
+/// <returns>The fastest and mean frame times and the iterations per frame</returns>
+Benchmark::Result Benchmark::measure(const View& view, int maxIterations, int threadCount)
+{
+    static const std::atomic<bool> NEVER_CANCELLING(false);
+    const PixelRect whole(0, 0, m_width, m_height);
+    Result result = { 0, 0, 0 };
+
+    omp_set_num_threads(threadCount);
+
+    for (int frame = 0; frame < m_frames; ++frame)
+    {
+        std::fill(m_iterations, m_iterations + m_width * m_height, MandelbrotEngine::UNRENDERED);
+
+        // Every frame iterates its own reference rather than reusing the last
+        m_engine.clearReferences();
+
+        const auto start = std::chrono::steady_clock::now();
+        m_engine.prepare(view, maxIterations);
+        m_engine.render(std::vector<PixelRect>(1, whole), Pixel(m_width / 2, m_height / 2), 1,
+                        NEVER_CANCELLING, [](const PixelRect&) {});
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.bestSeconds = frame == 0 ? seconds : std::min(result.bestSeconds, seconds);
+        result.meanSeconds += seconds / m_frames;
+    }
+
+    for (int i = 0; i < m_width * m_height; ++i)
+        result.iterations += m_iterations[i];
+
+    return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "View.hpp"
+#include "MandelbrotEngine.hpp"
+#include "HeadlessRenderer.hpp"
+
+class Benchmark
+{
+public:
+    static constexpr int DEFAULT_WIDTH = 640;
+    static constexpr int DEFAULT_HEIGHT = 360;
+    static constexpr int DEFAULT_FRAMES = 3;
+
+    Benchmark(int width, int height, int frames);
+    ~Benchmark();
+
+    static std::vector<int> defaultThreadCounts();
+    void run(std::ostream& out, const std::vector<int>& threadCounts);
+
+private:
+    struct Result
+    {
+        double bestSeconds;
+        double meanSeconds;
+        double iterations;
+    };
+
+    static const HeadlessRenderer::Location LOCATIONS[];
+
+    int m_width;
+    int m_height;
+    int m_frames;
+    MandelbrotEngine m_engine;
+    float* m_iterations;
+
+    Result measure(const View& view, int maxIterations, int threadCount);
+};
@@ -0,0 +1,238 @@
+#include "Comparison.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/// <summary>
+/// The views compared besides the shared ones, so that each number type the
+/// engine iterates deep references in is covered: doubles, DoubleDouble,
+/// QuadDouble and the full precision of GMP.
+/// They are small enough to be iterated at full precision in a few seconds,
+/// for which the minibrot of the benchmark is too deep.
+/// </summary>
+const HeadlessRenderer::Location Comparison::LOCATIONS[] =
+{
+    { "double-double-1e-20", "-0.743643887037158704752191506114779778215256208",
+      "0.131825904205311970493132056385140678972952279", -66.0, 0 },
+    { "quad-double-1e-45", "-0.743643887037158704752191506114779778215256208",
+      "0.131825904205311970493132056385140678972952279", -150.0, 0 },
+};
+
+/// <summary>
+/// The ways the engine renders views fast, each compared to iterating
+/// every pixel at full precision. The first is the default, and each of the
+/// others differs from it in one shortcut, so the error of each shortcut
+/// shows on its own: boundary tracing, the series approximation, each
+/// instruction set of the SIMD kernel, the cardioid and bulb test, and the
+/// periodicity check.
+/// </summary>
+const Comparison::Method Comparison::METHODS[] =
+{
+    { "progressive", false, true, true, true, false, SimdKernel::Level::Scalar },
+    { "traced", true, true, true, true, false, SimdKernel::Level::Scalar },
+    { "no-series", false, false, true, true, false, SimdKernel::Level::Scalar },
+    { "scalar", false, true, true, true, true, SimdKernel::Level::Scalar },
+    { "avx2", false, true, true, true, true, SimdKernel::Level::Avx2 },
+    { "avx512", false, true, true, true, true, SimdKernel::Level::Avx512 },
+    { "no-interior", false, true, false, true, false, SimdKernel::Level::Scalar },
+    { "no-periodicity", false, true, true, false, false, SimdKernel::Level::Scalar },
+};
+
+
+/// <summary>
+/// Renders a fixed set of views with every fast method of the engine and
+/// compares each pixel with the same view iterated at full precision, so the
+/// accuracy the shortcuts trade away is measured rather than assumed.
+/// </summary>
+/// <param name="width">The width of each frame in pixels</param>
+/// <param name="height">The height of each frame in pixels</param>
+Comparison::Comparison(int width, int height) :
+    m_width(width),
+    m_height(height),
+    m_reference(width * height),
+    m_iterations(width * height)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Comparison::~Comparison() {}
+
+
+/// <summary>
+/// Compares every method on every view and writes the results as JSON,
+/// alongside the time each took, so the speed of a method can be weighed
+/// against its accuracy.
+/// A pixel is mismatched if its iteration count differs from the full
+/// precision one at all, and bounded mismatched if one of them escaped and
+/// the other did not, which is the difference most visible in an image.
+/// Instruction sets the CPU does not support are skipped.
+/// </summary>
+/// <param name="out">Stream to write the JSON to</param>
+/// <param name="tolerance">The largest share of mismatched pixels a method
+/// may have on any view</param>
+/// <returns>True if every method was within the tolerance on every view</returns>
+bool Comparison::run(std::ostream& out, double tolerance)
+{
+    const int pixels = m_width * m_height;
+    const SimdKernel::Level supportedLevel = SimdKernel::detectLevel();
+    bool isWithinTolerance = true;
+
+    HeadlessRenderer::writeJsonHeader(out, m_width, m_height);
+    out << "  \"tolerance\": " << tolerance << ",\n"
+        << "  \"results\": [";
+
+    const char* separator = "\n";
+
+    for (const HeadlessRenderer::Location& location :
+         HeadlessRenderer::locationsWith(LOCATIONS, sizeof(LOCATIONS) / sizeof(LOCATIONS[0])))
+    {
+        const View view = HeadlessRenderer::makeView(location, m_width, m_height);
+
+        const int maxIterations = location.maxIterations > 0 ? location.maxIterations
+                                                             : MandelbrotEngine::defaultMaxIterations(view);
+
+        out << separator << "    { \"location\": \"" << location.name << "\", \"zoom\": " << location.zoom
+            << ", \"precision\": " << view.getPrecision() << ", \"maxIterations\": " << maxIterations;
+        separator = ",\n";
+
+        if (!HeadlessRenderer::canRender(view))
+        {
+            out << ", \"skipped\": \"needs arbitrary precision\" }";
+            continue;
+        }
+
+        std::cerr << location.name << " at full precision" << std::endl;
+
+        setUp(METHODS[0]);
+        m_engine.setFullPrecisionIsForced(true);
+        const Result reference = render(view, maxIterations, m_reference);
+        m_engine.setFullPrecisionIsForced(false);
+
+        out << ", \"fullPrecisionSeconds\": " << reference.seconds << ", \"methods\": [";
+
+        for (size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); ++i)
+        {
+            const Method& method = METHODS[i];
+
+            if (method.simdLevelIsForced && static_cast<int>(method.simdLevel) > static_cast<int>(supportedLevel))
+            {
+                out << (i == 0 ? "\n" : ",\n")
+                    << "      { \"method\": \"" << method.name << "\", \"skipped\": \"not supported by the CPU\" }";
+                continue;
+            }
+
+            std::cerr << location.name << " " << method.name << std::endl;
+
+            setUp(method);
+            Result result = render(view, maxIterations, m_iterations);
+            compare(result, maxIterations);
+
+            const double share = static_cast<double>(result.mismatched) / pixels;
+            const bool isPassed = share <= tolerance;
+            isWithinTolerance = isWithinTolerance && isPassed;
+
+            out << (i == 0 ? "\n" : ",\n")
+                << "      { \"method\": \"" << method.name << "\""
+                << ", \"mode\": \"" << result.mode << "\""
+                << ", \"reference\": \"" << result.reference << "\""
+                << ", \"seconds\": " << result.seconds
+                << ", \"speedup\": " << reference.seconds / result.seconds
+                << ", \"mismatched\": " << result.mismatched
+                << ", \"mismatchedShare\": " << share
+                << ", \"boundedMismatched\": " << result.boundedMismatched
+                << ", \"maxDifference\": " << result.maxDifference
+                << ", \"glitched\": " << result.glitches
+                << ", \"secondaryReferences\": " << result.secondaryReferences
+                << ", \"passed\": " << (isPassed ? "true" : "false") << " }";
+        }
+
+        out << "\n    ] }";
+    }
+
+    out << "\n  ],\n  \"passed\": " << (isWithinTolerance ? "true" : "false") << "\n}" << std::endl;
+
+    // The engine is left as it would be for a normal render
+    setUp(METHODS[0]);
+
+    return isWithinTolerance;
+}
+
+
+/// <summary>
+/// Sets the engine up to render with a method. Methods which do not force
+/// an instruction set use the widest the CPU supports.
+/// </summary>
+/// <param name="method">The method</param>
+void Comparison::setUp(const Method& method)
+{
+    m_engine.setBoundaryTracingIsEnabled(method.boundaryTracingIsEnabled);
+    m_engine.setSeriesApproximationIsEnabled(method.seriesApproximationIsEnabled);
+    m_engine.setInteriorDetectionIsEnabled(method.interiorDetectionIsEnabled);
+    m_engine.setPeriodicityDetectionIsEnabled(method.periodicityDetectionIsEnabled);
+    m_engine.setSimdLevel(method.simdLevelIsForced ? method.simdLevel : SimdKernel::detectLevel());
+}
+
+
+/// <summary>
+/// Renders a view with the engine as it is set up, in a single pass with a
+/// reference orbit of its own, and times it.
+/// </summary>
+/// <param name="view">The view to render</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <param name="iterations">Buffer of a count for every pixel to render to</param>
+/// <returns>The time taken and how the view was rendered, with nothing
+/// compared yet</returns>
+Comparison::Result Comparison::render(const View& view, int maxIterations, std::vector<float>& iterations)
+{
+    static const std::atomic<bool> NEVER_CANCELLING(false);
+    const PixelRect whole(0, 0, m_width, m_height);
+
+    std::fill(iterations.begin(), iterations.end(), MandelbrotEngine::UNRENDERED);
+    m_engine.setTarget(iterations.data(), whole);
+    m_engine.clearReferences();
+
+    const auto start = RenderStats::Clock::now();
+    m_engine.prepare(view, maxIterations);
+    m_engine.render(std::vector<PixelRect>(1, whole), Pixel(m_width / 2, m_height / 2), 1,
+                    NEVER_CANCELLING, [](const PixelRect&) {});
+
+    const RenderStats& stats = m_engine.getStats();
+    return Result{ RenderStats::secondsSince(start), stats.getMode(), stats.getReference(),
+                   stats.getGlitches(), stats.getSecondaryReferences(), 0, 0, 0 };
+}
+
+
+/// <summary>
+/// Counts the pixels of the last render which differ from the full
+/// precision render of the same view.
+/// </summary>
+/// <param name="result">The result of the last render, whose differences
+/// are filled in</param>
+/// <param name="maxIterations">The iteration limit of both renders</param>
+void Comparison::compare(Result& result, int maxIterations) const
+{
+    const float bound = static_cast<float>(maxIterations);
+    const int count = m_width * m_height;
+    int mismatched = 0;
+    int boundedMismatched = 0;
+    float maxDifference = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const float difference = std::abs(m_iterations[i] - m_reference[i]);
+
+        if (difference > 0)
+            ++mismatched;
+
+        if ((m_iterations[i] >= bound) != (m_reference[i] >= bound))
+            ++boundedMismatched;
+
+        maxDifference = std::max(maxDifference, difference);
+    }
+
+    result.mismatched = mismatched;
+    result.boundedMismatched = boundedMismatched;
+    result.maxDifference = maxDifference;
+}
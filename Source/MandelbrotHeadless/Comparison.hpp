@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "View.hpp"
+#include "MandelbrotEngine.hpp"
+#include "HeadlessRenderer.hpp"
+
+class Comparison
+{
+public:
+    static constexpr int DEFAULT_WIDTH = 160;
+    static constexpr int DEFAULT_HEIGHT = 90;
+    static constexpr double DEFAULT_TOLERANCE = 0.001;
+
+    Comparison(int width, int height);
+    ~Comparison();
+
+    bool run(std::ostream& out, double tolerance);
+
+private:
+    struct Method
+    {
+        const char* name;
+        bool boundaryTracingIsEnabled;
+        bool seriesApproximationIsEnabled;
+        bool interiorDetectionIsEnabled;
+        bool periodicityDetectionIsEnabled;
+        bool simdLevelIsForced;
+        SimdKernel::Level simdLevel;
+    };
+
+    struct Result
+    {
+        double seconds;
+        std::string mode;
+        std::string reference;
+        int glitches;
+        int secondaryReferences;
+        int mismatched;
+        int boundedMismatched;
+        float maxDifference;
+    };
+
+    static const HeadlessRenderer::Location LOCATIONS[];
+    static const Method METHODS[];
+
+    int m_width;
+    int m_height;
+    MandelbrotEngine m_engine;
+    std::vector<float> m_reference;
+    std::vector<float> m_iterations;
+
+    Result render(const View& view, int maxIterations, std::vector<float>& iterations);
+    void compare(Result& result, int maxIterations) const;
+    void setUp(const Method& method);
+};
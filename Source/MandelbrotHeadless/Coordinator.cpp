@@ -0,0 +1,501 @@
+#include "Coordinator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+
+/// <summary>
+/// Renders a still across several machines, each running a Worker, by
+/// leasing strips of rows of the image to whichever workers connect.
+/// Every worker is kept a couple of strips ahead, so it never waits for the
+/// coordinator between strips. A lease's time runs from when the worker
+/// begins the strip, and a lease which takes too long is given to another
+/// worker, along with the strips queued behind it, which are taken back.
+/// Whichever result arrives first is kept, and a finished strip is taken
+/// back from workers which have not begun it, so a worker which stops
+/// responding or disconnects only delays the strips it held. Sockets do not
+/// block, so no worker can hold up the others.
+/// The coordinator only computes the reference orbit and writes the image,
+/// so a Worker should also be run on its machine to use its threads.
+/// Strips which arrive before those above them are held compactly in an
+/// IterationStore until they can be written, spilling to a file if there
+/// are too many, so one slow strip of a huge image cannot exhaust memory.
+/// </summary>
+/// <param name="view">The view to render, sized to the whole image</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <param name="leaseSeconds">How long a worker has to return a strip</param>
+/// <param name="memoryBudgetBytes">The most memory for strips waiting to
+/// be written</param>
+/// <param name="spillPath">The file to spill waiting strips to beyond the
+/// budget, which is deleted afterwards</param>
+Coordinator::Coordinator(const View& view, int maxIterations, double leaseSeconds,
+                         size_t memoryBudgetBytes, const std::string& spillPath) :
+    m_view(view),
+    m_width(view.getScreenSize().x),
+    m_height(view.getScreenSize().y),
+    m_maxIterations(maxIterations),
+    m_stripCount(RenderProtocol::countStrips(view.getScreenSize().y, STRIP_HEIGHT)),
+    m_leaseSeconds(leaseSeconds),
+    m_strips(memoryBudgetBytes, spillPath)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Coordinator::~Coordinator() {}
+
+
+/// <summary>
+/// Getter for palette, so it can be set up before rendering.
+/// </summary>
+/// <returns>The palette used to colour the image</returns>
+Palette& Coordinator::getPalette() { return m_palette; }
+
+/// <summary>
+/// Getter for engine, so it can be set up before rendering. Its settings
+/// are passed on to the workers.
+/// </summary>
+/// <returns>The engine which computes the reference orbit</returns>
+MandelbrotEngine& Coordinator::getEngine() { return m_engine; }
+
+
+/// <summary>
+/// Renders the view with the workers which connect to the port, and writes
+/// it as a binary PPM image, strip by strip in order as they arrive.
+/// </summary>
+/// <param name="out">Binary stream to write the image to</param>
+/// <param name="port">The TCP port to listen for workers on</param>
+/// <returns>True if the whole image was written</returns>
+bool Coordinator::renderStill(std::ostream& out, unsigned short port)
+{
+    sf::TcpListener listener;
+    if (listener.listen(port) != sf::Socket::Done)
+    {
+        std::cerr << "Could not listen on port " << port << std::endl;
+        return false;
+    }
+
+    // Iterate the reference once here, rather than once on every worker
+    m_engine.prepare(m_view, m_maxIterations);
+    sf::Packet job;
+    RenderProtocol::writeJob(job, makeJob());
+
+    m_unleased.clear();
+    for (int strip = 0; strip < m_stripCount; ++strip)
+        m_unleased.push_back(strip);
+
+    m_strips.clear();
+    m_stripIsDone.assign(m_stripCount, false);
+    m_selector.clear();
+    listener.setBlocking(false);
+    m_selector.add(listener);
+
+    std::cerr << "Waiting for workers on port " << port << std::endl;
+    out << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    int next = 0;
+    while (next < m_stripCount && out.good())
+    {
+        // Messages a worker could not take yet are retried soon after
+        if (m_selector.wait(sf::seconds(isSending() ? SEND_POLL_SECONDS : POLL_SECONDS)))
+        {
+            if (m_selector.isReady(listener))
+                acceptWorker(listener, job);
+
+            for (size_t i = 0; i < m_connections.size(); ++i)
+            {
+                Connection& connection = *m_connections[i];
+
+                if (m_selector.isReady(connection.socket) && !receive(connection))
+                {
+                    std::cerr << "Worker " << connection.name << " disconnected" << std::endl;
+                    release(connection);
+                    m_selector.remove(connection.socket);
+                    m_connections.erase(m_connections.begin() + i--);
+                }
+            }
+        }
+
+        expireLeases();
+
+        for (size_t i = 0; i < m_connections.size(); ++i)
+        {
+            Connection& connection = *m_connections[i];
+            grantLeases(connection);
+
+            if (!flush(connection))
+            {
+                std::cerr << "Worker " << connection.name << " disconnected" << std::endl;
+                release(connection);
+                m_selector.remove(connection.socket);
+                m_connections.erase(m_connections.begin() + i--);
+            }
+        }
+
+        writeStrips(out, next);
+    }
+
+    // Workers still rendering strips someone else finished are let go, but
+    // those which have stopped reading are only waited on for a while
+    for (const std::unique_ptr<Connection>& connection : m_connections)
+    {
+        sf::Packet finished;
+        RenderProtocol::writeFinished(finished);
+        connection->unsent.push_back(finished);
+    }
+
+    const Clock::time_point deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(FINISH_SECONDS));
+
+    for (;;)
+    {
+        for (const std::unique_ptr<Connection>& connection : m_connections)
+            if (!flush(*connection))
+                connection->unsent.clear();
+
+        if (!isSending() || Clock::now() >= deadline)
+            break;
+
+        sf::sleep(sf::seconds(SEND_POLL_SECONDS));
+    }
+
+    m_connections.clear();
+    m_selector.clear();
+
+    return out.good();
+}
+
+
+/// <summary>
+/// Describes the render for the workers, with the engine's settings and the
+/// reference orbit it computed, if the view needed one.
+/// </summary>
+/// <returns>The job</returns>
+RenderProtocol::Job Coordinator::makeJob() const
+{
+    RenderProtocol::Job job;
+    job.view = m_view;
+    job.maxIterations = m_maxIterations;
+    job.stripHeight = STRIP_HEIGHT;
+    job.boundaryTracingIsEnabled = m_engine.getBoundaryTracingIsEnabled();
+    job.seriesApproximationIsEnabled = m_engine.getSeriesApproximationIsEnabled();
+
+    // The engine has only prepared this view, so its reference is at the
+    // centre of the view, where workers take it to be
+    const ReferenceOrbit* reference = m_engine.getReferenceOrbit();
+    if (m_view.getPrecision() > std::numeric_limits<double>::digits && reference != nullptr)
+        job.orbit = reference->getOrbit();
+
+    return job;
+}
+
+
+/// <summary>
+/// The time a lease begun now runs out.
+/// </summary>
+/// <returns>The expiry of the lease</returns>
+Coordinator::Clock::time_point Coordinator::leaseExpiry() const
+{
+    return Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_leaseSeconds));
+}
+
+
+/// <summary>
+/// Accepts a worker which is connecting and queues the job for it. Its
+/// socket is made non-blocking, so a worker which stops reading cannot stop
+/// the coordinator serving the others.
+/// </summary>
+/// <param name="listener">The listener with a connection waiting</param>
+/// <param name="job">The job packet, from RenderProtocol::writeJob()</param>
+void Coordinator::acceptWorker(sf::TcpListener& listener, const sf::Packet& job)
+{
+    std::unique_ptr<Connection> connection(new Connection());
+
+    if (listener.accept(connection->socket) != sf::Socket::Done)
+        return;
+
+    connection->socket.setBlocking(false);
+    connection->name = connection->socket.getRemoteAddress().toString();
+    connection->unsent.push_back(job);
+
+    std::cerr << "Worker " << connection->name << " connected" << std::endl;
+    m_selector.add(connection->socket);
+    m_connections.push_back(std::move(connection));
+}
+
+
+/// <summary>
+/// Receives every message waiting from a worker, each saying it has begun
+/// a strip or holding a strip's result.
+/// </summary>
+/// <param name="connection">The worker with messages waiting</param>
+/// <returns>False if the worker disconnected or sent something invalid</returns>
+bool Coordinator::receive(Connection& connection)
+{
+    for (;;)
+    {
+        sf::Packet packet;
+        RenderProtocol::Message message;
+        int strip;
+
+        const sf::Socket::Status status = connection.socket.receive(packet);
+        if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+            return true;
+
+        if (status != sf::Socket::Done || !RenderProtocol::readMessage(packet, message))
+            return false;
+
+        if (message == RenderProtocol::Message::Started)
+        {
+            if (!RenderProtocol::readStrip(packet, strip) || strip >= m_stripCount)
+                return false;
+
+            start(connection, strip);
+        }
+        else if (message != RenderProtocol::Message::Result || !finish(connection, packet))
+        {
+            return false;
+        }
+    }
+}
+
+
+/// <summary>
+/// Starts the time of a worker's lease of a strip, as it has begun it. A
+/// strip which was taken back is left to the worker to finish.
+/// </summary>
+/// <param name="connection">The worker</param>
+/// <param name="strip">The strip it began</param>
+void Coordinator::start(Connection& connection, int strip)
+{
+    for (Lease& lease : connection.leases)
+    {
+        if (lease.strip == strip)
+        {
+            lease.isStarted = true;
+            lease.expiry = leaseExpiry();
+        }
+    }
+}
+
+
+/// <summary>
+/// Reads a result from a worker. The first result for a strip is kept,
+/// even if its lease expired, and any later ones are ignored. Workers which
+/// hold the strip but have not begun it are told not to.
+/// </summary>
+/// <param name="connection">The worker the result is from</param>
+/// <param name="packet">The result, after its message type</param>
+/// <returns>False if the result was invalid</returns>
+bool Coordinator::finish(Connection& connection, sf::Packet& packet)
+{
+    int strip;
+    std::vector<float> iterations;
+
+    if (!RenderProtocol::readResult(packet, strip, iterations) || strip >= m_stripCount)
+        return false;
+
+    const PixelRect bounds = RenderProtocol::stripBounds(m_view, STRIP_HEIGHT, strip);
+    if (iterations.size() != static_cast<size_t>(bounds.width) * bounds.height)
+        return false;
+
+    // The lease behind the finished one starts its time now, in case the
+    // worker never says it has begun it
+    auto lease = std::find_if(connection.leases.begin(), connection.leases.end(),
+                              [strip](const Lease& l) { return l.strip == strip; });
+    if (lease != connection.leases.end())
+    {
+        connection.leases.erase(lease);
+
+        if (!connection.leases.empty())
+            connection.leases.front().expiry = leaseExpiry();
+    }
+
+    connection.isStalled = false;
+
+    if (!m_stripIsDone[strip])
+    {
+        m_strips.put(strip, iterations.data(), bounds.width, bounds.height, bounds.width);
+        m_stripIsDone[strip] = true;
+        m_unleased.erase(std::remove(m_unleased.begin(), m_unleased.end(), strip), m_unleased.end());
+
+        for (const std::unique_ptr<Connection>& other : m_connections)
+            if (other.get() != &connection)
+                revoke(*other, strip);
+    }
+
+    return true;
+}
+
+
+/// <summary>
+/// Takes back a worker's lease of a strip, if it has not begun it.
+/// </summary>
+/// <param name="connection">The worker</param>
+/// <param name="strip">The strip to take back</param>
+void Coordinator::revoke(Connection& connection, int strip)
+{
+    auto lease = std::find_if(connection.leases.begin(), connection.leases.end(),
+                              [strip](const Lease& l) { return l.strip == strip && !l.isStarted; });
+    if (lease == connection.leases.end())
+        return;
+
+    const bool isFirst = lease == connection.leases.begin();
+    connection.leases.erase(lease);
+
+    sf::Packet packet;
+    RenderProtocol::writeRevoke(packet, strip);
+    connection.unsent.push_back(packet);
+
+    if (isFirst && !connection.leases.empty())
+        connection.leases.front().expiry = leaseExpiry();
+}
+
+
+/// <summary>
+/// Returns the unfinished strips a worker held to the front of the strips
+/// to lease, so they are given to the next worker with room for them.
+/// </summary>
+/// <param name="connection">The worker</param>
+void Coordinator::release(Connection& connection)
+{
+    for (auto lease = connection.leases.rbegin(); lease != connection.leases.rend(); ++lease)
+        if (!m_stripIsDone[lease->strip])
+            m_unleased.push_front(lease->strip);
+
+    connection.leases.clear();
+}
+
+
+/// <summary>
+/// Takes back the strips of every worker whose current lease has run out.
+/// Such a worker is given no more strips until it returns one, in case it
+/// has stopped altogether. It is told not to begin the strips it has
+/// queued, so it does not render them again after another worker; the one
+/// it is rendering is still kept if it arrives first.
+/// </summary>
+void Coordinator::expireLeases()
+{
+    const Clock::time_point now = Clock::now();
+
+    for (const std::unique_ptr<Connection>& connection : m_connections)
+    {
+        if (connection->leases.empty() || connection->leases.front().expiry > now)
+            continue;
+
+        std::cerr << "Lease of strip " << connection->leases.front().strip << " to worker "
+                  << connection->name << " expired" << std::endl;
+        for (const Lease& lease : connection->leases)
+        {
+            if (!lease.isStarted)
+            {
+                sf::Packet packet;
+                RenderProtocol::writeRevoke(packet, lease.strip);
+                connection->unsent.push_back(packet);
+            }
+        }
+
+        release(*connection);
+        connection->isStalled = true;
+    }
+}
+
+
+/// <summary>
+/// Leases strips to a worker until it holds LEASES_PER_WORKER of them, or
+/// none are left. Only the first lease's time runs, restarting when the
+/// worker begins it, as the others wait for it on the worker.
+/// </summary>
+/// <param name="connection">The worker</param>
+void Coordinator::grantLeases(Connection& connection)
+{
+    while (!connection.isStalled && connection.leases.size() < LEASES_PER_WORKER && !m_unleased.empty())
+    {
+        const int strip = m_unleased.front();
+        sf::Packet packet;
+        RenderProtocol::writeLease(packet, strip);
+        connection.unsent.push_back(packet);
+
+        m_unleased.pop_front();
+        connection.leases.push_back(Lease{ strip, leaseExpiry(), false });
+    }
+}
+
+
+/// <summary>
+/// Sends the messages queued for a worker, as far as its socket takes them
+/// without blocking, keeping the rest for later.
+/// </summary>
+/// <param name="connection">The worker</param>
+/// <returns>False if the worker disconnected</returns>
+bool Coordinator::flush(Connection& connection)
+{
+    while (!connection.unsent.empty())
+    {
+        // A packet partly sent remembers how far it got, so is sent again
+        const sf::Socket::Status status = connection.socket.send(connection.unsent.front());
+        if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+            return true;
+
+        if (status != sf::Socket::Done)
+            return false;
+
+        connection.unsent.pop_front();
+    }
+
+    return true;
+}
+
+
+/// <summary>
+/// Whether any worker has messages it has not taken yet.
+/// </summary>
+/// <returns>True if there are messages to send</returns>
+bool Coordinator::isSending() const
+{
+    return std::any_of(m_connections.begin(), m_connections.end(),
+                       [](const std::unique_ptr<Connection>& c) { return !c->unsent.empty(); });
+}
+
+
+/// <summary>
+/// Colours and writes the finished strips which follow the last one
+/// written, taking their iteration counts out of the store.
+/// </summary>
+/// <param name="out">Binary stream to write the image to</param>
+/// <param name="next">The first strip not yet written, which is advanced</param>
+/// <returns>True if the stream is still good</returns>
+bool Coordinator::writeStrips(std::ostream& out, int& next)
+{
+    for (; next < m_stripCount && m_stripIsDone[next] && out.good(); ++next)
+    {
+        const PixelRect bounds = RenderProtocol::stripBounds(m_view, STRIP_HEIGHT, next);
+        const int count = bounds.width * bounds.height;
+        m_stripIterations.resize(count);
+        m_pixels.resize(3 * count);
+
+        if (!m_strips.take(next, m_stripIterations.data(), bounds.width))
+        {
+            std::cerr << "Could not read back strip " << next << std::endl;
+            out.setstate(std::ios::failbit);
+            break;
+        }
+
+#pragma omp parallel for
+        for (int i = 0; i < count; ++i)
+        {
+            sf::Color c = m_palette.colour(m_stripIterations[i], m_maxIterations);
+            m_pixels[3 * i + 0] = c.r;
+            m_pixels[3 * i + 1] = c.g;
+            m_pixels[3 * i + 2] = c.b;
+        }
+
+        out.write(reinterpret_cast<const char*>(m_pixels.data()), m_pixels.size());
+
+        std::cerr << "Rendered rows " << bounds.top << " to " << bounds.top + bounds.height
+                  << " of " << m_height << std::endl;
+    }
+
+    return out.good();
+}
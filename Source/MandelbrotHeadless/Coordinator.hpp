@@ -0,0 +1,84 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "View.hpp"
+#include "Palette.hpp"
+#include "MandelbrotEngine.hpp"
+#include "RenderProtocol.hpp"
+#include "IterationStore.hpp"
+
+class Coordinator
+{
+public:
+    static constexpr int STRIP_HEIGHT = 32;
+    static constexpr double DEFAULT_LEASE_SECONDS = 60.0;
+    static constexpr size_t DEFAULT_MEMORY_BUDGET_BYTES = size_t(1) << 30;
+
+    Coordinator(const View& view, int maxIterations, double leaseSeconds,
+                size_t memoryBudgetBytes, const std::string& spillPath);
+    ~Coordinator();
+
+    Palette& getPalette();
+    MandelbrotEngine& getEngine();
+    bool renderStill(std::ostream& out, unsigned short port);
+
+private:
+    static constexpr int LEASES_PER_WORKER = 2;
+    static constexpr float POLL_SECONDS = 0.5f;
+    static constexpr float SEND_POLL_SECONDS = 0.01f;
+    static constexpr double FINISH_SECONDS = 5.0;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Lease
+    {
+        int strip;
+        Clock::time_point expiry;
+        bool isStarted;
+    };
+
+    struct Connection
+    {
+        sf::TcpSocket socket;
+        std::string name;
+        std::deque<Lease> leases;
+        std::deque<sf::Packet> unsent;
+        bool isStalled = false;
+    };
+
+    View m_view;
+    int m_width;
+    int m_height;
+    int m_maxIterations;
+    int m_stripCount;
+    double m_leaseSeconds;
+    Palette m_palette;
+    MandelbrotEngine m_engine;
+    sf::SocketSelector m_selector;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    std::deque<int> m_unleased;
+    IterationStore m_strips;
+    std::vector<bool> m_stripIsDone;
+    std::vector<float> m_stripIterations;
+    std::vector<sf::Uint8> m_pixels;
+
+    RenderProtocol::Job makeJob() const;
+    Clock::time_point leaseExpiry() const;
+    void acceptWorker(sf::TcpListener& listener, const sf::Packet& job);
+    bool receive(Connection& connection);
+    void start(Connection& connection, int strip);
+    bool finish(Connection& connection, sf::Packet& packet);
+    void revoke(Connection& connection, int strip);
+    void release(Connection& connection);
+    void expireLeases();
+    void grantLeases(Connection& connection);
+    bool flush(Connection& connection);
+    bool isSending() const;
+    bool writeStrips(std::ostream& out, int& next);
+};
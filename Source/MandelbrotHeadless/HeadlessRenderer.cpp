@@ -0,0 +1,477 @@
+#include "HeadlessRenderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <iostream>
+
+
+/// <summary>
+/// The views every fixed set of headless measurements covers. The deepest
+/// is centred on the Misiurewicz point i, which has detail at every depth.
+/// An iteration limit of 0 uses the default for the zoom.
+/// </summary>
+const HeadlessRenderer::Location HeadlessRenderer::LOCATIONS[] =
+{
+    { "full-set", "-0.5", "0", 1.0, 0 },
+    { "seahorse-valley", "-0.743643887037151", "0.131825904205330", -12.0, 0 },
+    { "misiurewicz-1e-100", "0", "1", -332.0, 0 },
+};
+
+
+/// <summary>
+/// Renders images without a window, for machines with no display.
+/// The image is rendered and written one band of rows at a time, so only a
+/// band of iteration counts and pixels is ever held in memory, however large
+/// the image is.
+/// </summary>
+/// <param name="view">The view to render, sized to the whole image</param>
+/// <param name="maxIterations">The iteration limit</param>
+/// <param name="bandHeight">The number of rows to render at a time</param>
+HeadlessRenderer::HeadlessRenderer(const View& view, int maxIterations, int bandHeight) :
+    m_view(view),
+    m_width(view.getScreenSize().x),
+    m_height(view.getScreenSize().y),
+    m_maxIterations(maxIterations),
+    m_bandHeight(std::max(1, std::min(bandHeight, view.getScreenSize().y)))
+{
+    // With a row below the band, for finding the edges on its last row
+    m_iterations = new float[m_width * (m_bandHeight + 1)];
+    m_pixels = new sf::Uint8[3 * m_width * m_bandHeight];
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+HeadlessRenderer::~HeadlessRenderer()
+{
+    delete[] m_iterations;
+    delete[] m_pixels;
+}
+
+
+/// <summary>
+/// Parses a coordinate at full precision, as deep views need more digits
+/// than a double can hold.
+/// </summary>
+/// <param name="text">Decimal number</param>
+/// <returns>The number</returns>
+Real HeadlessRenderer::parseReal(const char* text)
+{
+#ifdef UseArbitraryPrecision
+    // Over 3 bits per decimal digit, with some to spare
+    return Real(text, 4 * strlen(text) + 64);
+#else
+    return strtod(text, nullptr);
+#endif
+}
+
+/// <summary>
+/// Makes a view of a centre at a zoom. The zoom is set first, so the centre
+/// is stored at the precision of the zoom rather than of the default view.
+/// </summary>
+/// <param name="centre">The centre of the view</param>
+/// <param name="zoom">The zoom level, log2 of the view's half height</param>
+/// <param name="width">The width of the view in pixels</param>
+/// <param name="height">The height of the view in pixels</param>
+/// <returns>The view</returns>
+View HeadlessRenderer::makeView(const Complex& centre, double zoom, int width, int height)
+{
+    View view(0.0, 0.0, zoom, width, height);
+    view.moveTo(centre);
+    return view;
+}
+
+/// <summary>
+/// Makes the view of one of a fixed set of locations.
+/// </summary>
+/// <param name="location">The location, with its centre in decimal</param>
+/// <param name="width">The width of the view in pixels</param>
+/// <param name="height">The height of the view in pixels</param>
+/// <returns>The view</returns>
+View HeadlessRenderer::makeView(const Location& location, int width, int height)
+{
+    return makeView(Complex(parseReal(location.x), parseReal(location.y)), location.zoom, width, height);
+}
+
+/// <summary>
+/// The shared locations together with those of one kind of measurement,
+/// from shallow to deep.
+/// </summary>
+/// <param name="extra">The locations only this measurement covers</param>
+/// <param name="extraCount">The number of extra locations</param>
+/// <returns>Every location, ordered by zoom</returns>
+std::vector<HeadlessRenderer::Location> HeadlessRenderer::locationsWith(const Location* extra, size_t extraCount)
+{
+    std::vector<Location> locations(LOCATIONS, LOCATIONS + sizeof(LOCATIONS) / sizeof(LOCATIONS[0]));
+    locations.insert(locations.end(), extra, extra + extraCount);
+
+    std::stable_sort(locations.begin(), locations.end(),
+                     [](const Location& a, const Location& b) { return a.zoom > b.zoom; });
+    return locations;
+}
+
+/// <summary>
+/// Whether this build can render a view. Views which doubles cannot
+/// resolve are skipped in the Double build.
+/// </summary>
+/// <param name="view">The view</param>
+/// <returns>True if the view's precision is available</returns>
+bool HeadlessRenderer::canRender(const View& view)
+{
+#ifdef UseArbitraryPrecision
+    (void)view;
+    return true;
+#else
+    return view.getPrecision() <= std::numeric_limits<double>::digits;
+#endif
+}
+
+/// <summary>
+/// Writes the fields which open the JSON of a fixed set of measurements:
+/// the precision the build uses and the size of the frames.
+/// </summary>
+/// <param name="out">Stream to write the JSON to</param>
+/// <param name="width">The width of each frame in pixels</param>
+/// <param name="height">The height of each frame in pixels</param>
+void HeadlessRenderer::writeJsonHeader(std::ostream& out, int width, int height)
+{
+#ifdef UseArbitraryPrecision
+    const char* configuration = "Arbitrary";
+#else
+    const char* configuration = "Double";
+#endif
+
+    out << "{\n"
+        << "  \"configuration\": \"" << configuration << "\",\n"
+        << "  \"width\": " << width << ",\n"
+        << "  \"height\": " << height << ",\n";
+}
+
+
+/// <summary>
+/// Getter for palette, so it can be set up before rendering.
+/// </summary>
+/// <returns>The palette used to colour the image</returns>
+Palette& HeadlessRenderer::getPalette() { return m_palette; }
+
+/// <summary>
+/// Getter for engine, so it can be set up before rendering.
+/// </summary>
+/// <returns>The engine used to render the image</returns>
+MandelbrotEngine& HeadlessRenderer::getEngine() { return m_engine; }
+
+/// <summary>
+/// Turns on anti-aliasing of stills, which supersamples the pixels on edges
+/// after each band is rendered and colours them with the average of their
+/// samples.
+/// </summary>
+/// <param name="gridSize">The samples along each side of an edge pixel, up
+/// to EdgeSamples::MAX_GRID_SIZE, or 1 for no anti-aliasing</param>
+/// <param name="threshold">The difference in iterations between neighbouring
+/// pixels which makes an edge</param>
+void HeadlessRenderer::setAntialiasing(int gridSize, float threshold)
+{
+    m_antialiasingGridSize = std::max(1, std::min(gridSize, EdgeSamples::MAX_GRID_SIZE));
+    m_antialiasingThreshold = threshold;
+}
+
+
+/// <summary>
+/// Renders the whole view and writes it as a binary PPM image, band by band.
+/// </summary>
+/// <param name="out">Binary stream to write the image to</param>
+/// <returns>True if the whole image was written</returns>
+bool HeadlessRenderer::renderStill(std::ostream& out)
+{
+    m_engine.prepare(m_view, m_maxIterations);
+
+    out << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    for (int top = 0; top < m_height && out.good(); top += m_bandHeight)
+    {
+        const int height = std::min(m_bandHeight, m_height - top);
+        renderBand(top, height);
+        colourBand(height);
+        out.write(reinterpret_cast<const char*>(m_pixels), 3 * m_width * height);
+
+        std::cerr << "Rendered rows " << top << " to " << top + height << " of " << m_height << std::endl;
+    }
+
+    return out.good();
+}
+
+
+/// <summary>
+/// Renders one band of rows of the view to the iteration buffer, in a single
+/// pass as there is no screen to show coarse passes on.
+/// </summary>
+/// <param name="top">The first row of the band</param>
+/// <param name="height">The number of rows in the band</param>
+void HeadlessRenderer::renderBand(int top, int height)
+{
+    static const std::atomic<bool> NEVER_CANCELLING(false);
+
+    // When anti-aliasing, the first row of the next band is rendered too,
+    // and the last row of this one kept, so the pixels on the rows between
+    // bands are compared with their neighbours on both sides
+    const bool hasRowBelow = m_antialiasingGridSize > 1 && top + height < m_height;
+    const int renderedHeight = hasRowBelow ? height + 1 : height;
+
+    // Boundary tracing only iterates pixels which have not been rendered
+#pragma omp parallel for
+    for (int i = 0; i < m_width * renderedHeight; ++i)
+        m_iterations[i] = MandelbrotEngine::UNRENDERED;
+
+    const PixelRect band(0, top, m_width, height);
+    const PixelRect rendered(0, top, m_width, renderedHeight);
+    m_engine.setTarget(m_iterations, rendered);
+    m_engine.render(std::vector<PixelRect>(1, rendered), Pixel(m_width / 2, top + height / 2), 1,
+                    NEVER_CANCELLING, [](const PixelRect&) {});
+
+    if (m_antialiasingGridSize > 1)
+    {
+        m_edgeSamples.findEdges(m_iterations, band, m_maxIterations, m_antialiasingThreshold, m_antialiasingGridSize,
+                                top > 0 ? m_rowAbove.data() : nullptr,
+                                hasRowBelow ? m_iterations + m_width * height : nullptr);
+        m_rowAbove.assign(m_iterations + m_width * (height - 1), m_iterations + m_width * height);
+
+        m_engine.antialias(m_edgeSamples, Pixel(m_width / 2, top + height / 2),
+                           NEVER_CANCELLING, [](const PixelRect&) {});
+    }
+    else
+    {
+        m_edgeSamples.clear();
+    }
+}
+
+
+/// <summary>
+/// Colours the rendered band into the RGB pixel buffer. Supersampled pixels
+/// are the average of the colours of their samples, rather than the colour
+/// of their average iteration count, which would blend the palette.
+/// </summary>
+/// <param name="height">The number of rows in the band</param>
+void HeadlessRenderer::colourBand(int height)
+{
+    const int top = m_edgeSamples.getBounds().top;
+    const int sampleCount = m_edgeSamples.getSampleCount();
+
+#pragma omp parallel for
+    for (int i = 0; i < m_width * height; ++i)
+    {
+        const int edge = m_edgeSamples.getEdge(i % m_width, top + i / m_width);
+
+        if (edge == EdgeSamples::NOT_AN_EDGE)
+        {
+            sf::Color c = m_palette.colour(m_iterations[i], m_maxIterations);
+            m_pixels[3 * i + 0] = c.r;
+            m_pixels[3 * i + 1] = c.g;
+            m_pixels[3 * i + 2] = c.b;
+            continue;
+        }
+
+        const float* samples = m_edgeSamples.getSamples(edge);
+        int r = 0, g = 0, b = 0;
+
+        for (int s = 0; s < sampleCount; ++s)
+        {
+            sf::Color c = m_palette.colour(samples[s], m_maxIterations);
+            r += c.r;
+            g += c.g;
+            b += c.b;
+        }
+
+        m_pixels[3 * i + 0] = static_cast<sf::Uint8>((r + sampleCount / 2) / sampleCount);
+        m_pixels[3 * i + 1] = static_cast<sf::Uint8>((g + sampleCount / 2) / sampleCount);
+        m_pixels[3 * i + 2] = static_cast<sf::Uint8>((b + sampleCount / 2) / sampleCount);
+    }
+}
+
+
+/// <summary>
+/// Renders a zoom into a fixed centre as raw 24 bit RGB frames, suitable for
+/// piping straight into a video encoder.
+/// Only one keyframe is rendered for every halving of the scale, at twice
+/// the resolution of the frames plus a margin, and the frames between are
+/// resampled from it. Each keyframe after the first copies the quarter of
+/// its pixels which coincide with pixels of the previous keyframe, and the
+/// whole dive shares a single reference orbit.
+/// </summary>
+/// <param name="out">Binary stream to write the frames to</param>
+/// <param name="centre">The point to zoom into, at full precision</param>
+/// <param name="endZoom">The zoom of the last frame, below the zoom of the
+/// view</param>
+/// <param name="framesPerOctave">The number of frames for each halving of
+/// the scale</param>
+/// <returns>True if every frame was written</returns>
+bool HeadlessRenderer::renderSequence(std::ostream& out, const Complex& centre, double endZoom, int framesPerOctave)
+{
+    const double startZoom = static_cast<double>(m_view.getZoom());
+    const double octaves = startZoom - endZoom;
+    if (octaves < 0 || framesPerOctave <= 0)
+        return false;
+
+    const int frameCount = static_cast<int>(floor(octaves * framesPerOctave)) + 1;
+    const int keyframeCount = (frameCount - 1) / framesPerOctave + 1;
+
+    // Halving the scale must land pixels at even coordinates of each keyframe
+    // on pixels of the previous one, so half of each dimension must be even
+    const int marginX = KEYFRAME_MARGIN + (m_width + KEYFRAME_MARGIN) % 2;
+    const int marginY = KEYFRAME_MARGIN + (m_height + KEYFRAME_MARGIN) % 2;
+    const int keyframeWidth = 2 * (m_width + marginX);
+    const int keyframeHeight = 2 * (m_height + marginY);
+
+    // The central 2W x 2H pixels of a keyframe cover the first frame it is
+    // resampled for, which has the same scale as the keyframe's octave
+    const Real keyframeScale = m_view.getScale() * static_cast<Real>(keyframeHeight) / static_cast<Real>(2 * m_height);
+    static const Real HALF = 0.5;
+
+    View keyframe(0.0, 0.0, 1.0, keyframeWidth, keyframeHeight);
+    keyframe.setScale(keyframeScale);
+    for (int k = 1; k < keyframeCount; ++k)
+        keyframe.setScale(keyframe.getScale() * HALF);
+    keyframe.moveTo(centre);
+
+    // Iterate the reference for the deepest keyframe, then keep it
+    m_engine.setReferenceIsLocked(false);
+    m_engine.prepare(keyframe, m_maxIterations);
+    m_engine.setReferenceIsLocked(true);
+
+    float* iterations = new float[keyframeWidth * keyframeHeight];
+    float* previous = new float[keyframeWidth * keyframeHeight];
+    sf::Uint8* keyframePixels = new sf::Uint8[3 * keyframeWidth * keyframeHeight];
+    sf::Uint8* framePixels = new sf::Uint8[3 * m_width * m_height];
+    bool hasPrevious = false;
+
+    keyframe.setScale(keyframeScale);
+    keyframe.moveTo(centre);
+
+    for (int k = 0; k < keyframeCount && out.good(); ++k)
+    {
+        renderKeyframe(keyframe, hasPrevious ? previous : nullptr, iterations, keyframePixels);
+        std::swap(iterations, previous);
+        hasPrevious = true;
+
+        const int lastFrame = std::min(frameCount, (k + 1) * framesPerOctave);
+        for (int f = k * framesPerOctave; f < lastFrame && out.good(); ++f)
+        {
+            // Frames shrink from the keyframe's full octave towards its half
+            const double ratio = pow(2.0, -static_cast<double>(f - k * framesPerOctave) / framesPerOctave);
+            resampleKeyframe(keyframePixels, keyframeWidth, keyframeHeight, ratio, framePixels);
+            out.write(reinterpret_cast<const char*>(framePixels), 3 * m_width * m_height);
+        }
+
+        std::cerr << "Rendered keyframe " << k + 1 << " of " << keyframeCount << std::endl;
+
+        keyframe.setScale(keyframe.getScale() * HALF);
+        keyframe.moveTo(centre);
+    }
+
+    m_engine.setReferenceIsLocked(false);
+
+    delete[] iterations;
+    delete[] previous;
+    delete[] keyframePixels;
+    delete[] framePixels;
+
+    return out.good();
+}
+
+
+/// <summary>
+/// Renders and colours one keyframe of a sequence.
+/// The pixels at even coordinates are the same complex numbers as pixels of
+/// the previous keyframe, whose scale was twice as large, so are copied
+/// rather than iterated again.
+/// </summary>
+/// <param name="keyframe">The view of the keyframe</param>
+/// <param name="previous">The iterations of the previous keyframe, or null
+/// for the first</param>
+/// <param name="iterations">Buffer to render the iterations to</param>
+/// <param name="pixels">Buffer to colour the keyframe into, as RGB</param>
+void HeadlessRenderer::renderKeyframe(const View& keyframe, const float* previous,
+                                      float* iterations, sf::Uint8* pixels)
+{
+    static const std::atomic<bool> NEVER_CANCELLING(false);
+    const int width = keyframe.getScreenSize().x;
+    const int height = keyframe.getScreenSize().y;
+    const PixelRect whole(0, 0, width, height);
+
+    m_engine.prepare(keyframe, m_maxIterations);
+    m_engine.setTarget(iterations, whole);
+
+#pragma omp parallel for
+    for (int i = 0; i < width * height; ++i)
+        iterations[i] = MandelbrotEngine::UNRENDERED;
+
+    if (previous == nullptr)
+    {
+        m_engine.render(std::vector<PixelRect>(1, whole), Pixel(width / 2, height / 2), 1,
+                        NEVER_CANCELLING, [](const PixelRect&) {});
+    }
+    else
+    {
+        // Pixel x of this keyframe is pixel (x + width / 2) / 2 of the previous
+#pragma omp parallel for
+        for (int y = 0; y < height; y += 2)
+            for (int x = 0; x < width; x += 2)
+                iterations[y * width + x] = previous[((y + height / 2) / 2) * width + (x + width / 2) / 2];
+
+        m_engine.refine(std::vector<PixelRect>(1, whole), Pixel(width / 2, height / 2),
+                        NEVER_CANCELLING, [](const PixelRect&) {});
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < width * height; ++i)
+    {
+        sf::Color c = m_palette.colour(iterations[i], m_maxIterations);
+        pixels[3 * i + 0] = c.r;
+        pixels[3 * i + 1] = c.g;
+        pixels[3 * i + 2] = c.b;
+    }
+}
+
+
+/// <summary>
+/// Makes a frame by bilinear resampling of the centre of a keyframe.
+/// Frame pixel x is at keyframe pixel keyframeWidth / 2 + ratio * (2x - W),
+/// because keyframe pixels are half the size of frame pixels at ratio 1.
+/// </summary>
+/// <param name="keyframe">The RGB pixels of the keyframe</param>
+/// <param name="keyframeWidth">The width of the keyframe</param>
+/// <param name="keyframeHeight">The height of the keyframe</param>
+/// <param name="ratio">The scale of the frame relative to the keyframe's
+/// octave, from 1 down to just above 0.5</param>
+/// <param name="frame">Buffer to write the frame to, as RGB</param>
+void HeadlessRenderer::resampleKeyframe(const sf::Uint8* keyframe, int keyframeWidth, int keyframeHeight,
+                                        double ratio, sf::Uint8* frame) const
+{
+#pragma omp parallel for
+    for (int y = 0; y < m_height; ++y)
+    {
+        const double sourceY = keyframeHeight / 2 + ratio * (2 * y - m_height);
+        const int top = std::min(static_cast<int>(sourceY), keyframeHeight - 2);
+        const double fy = sourceY - top;
+
+        for (int x = 0; x < m_width; ++x)
+        {
+            const double sourceX = keyframeWidth / 2 + ratio * (2 * x - m_width);
+            const int left = std::min(static_cast<int>(sourceX), keyframeWidth - 2);
+            const double fx = sourceX - left;
+
+            const sf::Uint8* p = keyframe + 3 * (top * keyframeWidth + left);
+            const sf::Uint8* q = p + 3 * keyframeWidth;
+            sf::Uint8* out = frame + 3 * (y * m_width + x);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                const double upper = p[c] + fx * (p[c + 3] - p[c]);
+                const double lower = q[c] + fx * (q[c + 3] - q[c]);
+                out[c] = static_cast<sf::Uint8>(upper + fy * (lower - upper) + 0.5);
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "View.hpp"
+#include "Palette.hpp"
+#include "MandelbrotEngine.hpp"
+
+class HeadlessRenderer
+{
+public:
+    static constexpr int DEFAULT_BAND_HEIGHT = 256;
+    static constexpr int DEFAULT_FRAMES_PER_OCTAVE = 30;
+
+    struct Location
+    {
+        const char* name;
+        const char* x;
+        const char* y;
+        double zoom;
+        int maxIterations;
+    };
+
+    HeadlessRenderer(const View& view, int maxIterations, int bandHeight);
+    ~HeadlessRenderer();
+
+    static Real parseReal(const char* text);
+    static View makeView(const Complex& centre, double zoom, int width, int height);
+    static View makeView(const Location& location, int width, int height);
+    static std::vector<Location> locationsWith(const Location* extra, size_t extraCount);
+    static bool canRender(const View& view);
+    static void writeJsonHeader(std::ostream& out, int width, int height);
+    Palette& getPalette();
+    MandelbrotEngine& getEngine();
+    void setAntialiasing(int gridSize, float threshold);
+    bool renderStill(std::ostream& out);
+    bool renderSequence(std::ostream& out, const Complex& centre, double endZoom, int framesPerOctave);
+
+private:
+    static constexpr int KEYFRAME_MARGIN = 2;
+
+    static const Location LOCATIONS[];
+
+    View m_view;
+    int m_width;
+    int m_height;
+    int m_maxIterations;
+    int m_bandHeight;
+    Palette m_palette;
+    MandelbrotEngine m_engine;
+    int m_antialiasingGridSize = 1;
+    float m_antialiasingThreshold = EdgeSamples::DEFAULT_THRESHOLD;
+    EdgeSamples m_edgeSamples;
+    float* m_iterations;
+    std::vector<float> m_rowAbove;
+    sf::Uint8* m_pixels;
+
+    void renderBand(int top, int height);
+    void colourBand(int height);
+    void renderKeyframe(const View& keyframe, const float* previous, float* iterations, sf::Uint8* pixels);
+    void resampleKeyframe(const sf::Uint8* keyframe, int keyframeWidth, int keyframeHeight,
+                          double ratio, sf::Uint8* frame) const;
+};
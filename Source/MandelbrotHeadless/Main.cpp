@@ -0,0 +1,390 @@
+#include "HeadlessRenderer.hpp"
+#include "Benchmark.hpp"
+#include "Comparison.hpp"
+#include "Bookmarks.hpp"
+#include "Coordinator.hpp"
+#include "Worker.hpp"
+#include "LimbPool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/// <summary>
+/// Prints the command line options.
+/// </summary>
+static void printUsage()
+{
+    std::cerr <<
+        "Usage: MandelbrotHeadless [options]\n"
+        "  --centre X Y        Centre of the view (default -0.5 0)\n"
+        "  --zoom Z            Zoom level, log2 of the view's half height (default 1)\n"
+        "  --size W H          Image size in pixels (default 1920 1080)\n"
+        "  --iterations N      Iteration limit, or auto to choose one from a coarse\n"
+        "                      sample of the view (default depends on zoom)\n"
+        "  --bookmark FILE N   Render bookmark N of a bookmarks file saved with Ctrl+N\n"
+        "                      in the viewer, with its size and iteration limit unless\n"
+        "                      they are given, instead of --centre and --zoom\n"
+        "  --band ROWS         Rows rendered and held in memory at a time (default 256)\n"
+        "  --palette NAME      rainbow, fire or greyscale (default rainbow)\n"
+        "  --trace             Render by Mariani-Silver subdivision\n"
+        "  --no-series         Iterate deep pixels from the start instead of skipping\n"
+        "                      iterations with a series approximation\n"
+        "  --antialias N       Supersample pixels on edges with N x N jittered samples,\n"
+        "                      up to 8 (default 1, no anti-aliasing)\n"
+        "  --edge-threshold T  Difference in iterations from a neighbour which makes\n"
+        "                      a pixel an edge to anti-alias (default 2)\n"
+        "  --cache DIR         Load and store rendered tiles in DIR\n"
+        "  --output FILE       PPM image to write, or - for stdout (default mandelbrot.ppm)\n"
+        "  --sequence END      Zoom into the centre until zoom END, writing raw RGB24\n"
+        "                      frames for a video encoder instead of a PPM image\n"
+        "  --frames-per-octave N  Frames for each halving of the scale (default 30)\n"
+        "  --benchmark         Time a fixed set of views and write JSON results to\n"
+        "                      the output (default size 640 360, output -)\n"
+        "  --frames N          Frames rendered for each benchmark run (default 3)\n"
+        "  --threads LIST      Comma separated thread counts to benchmark with\n"
+        "                      (default powers of two up to every thread)\n"
+        "  --compare           Render a fixed set of views with each fast method and\n"
+        "                      at full precision, and write JSON of the pixels which\n"
+        "                      differ to the output (default size 160 90, output -)\n"
+        "  --tolerance SHARE   Share of pixels a method may differ in before --compare\n"
+        "                      fails (default 0.001)\n"
+        "  --coordinator PORT  Render the still with workers which connect to PORT,\n"
+        "                      leasing them strips of rows (default port 45271)\n"
+        "  --lease SECONDS     Time a worker has to return a strip after beginning it\n"
+        "                      before it is given to another worker (default 60)\n"
+        "  --memory MB         Memory for strips the coordinator holds until those\n"
+        "                      above them arrive, beyond which they are spilled to a\n"
+        "                      file beside the output (default 1024)\n"
+        "  --worker HOST PORT  Render strips for the coordinator on HOST, taking the\n"
+        "                      view and every other option from it\n";
+}
+
+
+/// <summary>
+/// Renders a still image of the Mandelbrot Set without a window, streaming it
+/// to disk in bands so that images far larger than memory can be made.
+/// </summary>
+int main(int argc, char* argv[])
+{
+#ifdef UseArbitraryPrecision
+    // Pool GMP's allocations on each thread, before rendering starts
+    LimbPool::install();
+#endif
+
+    const char* centreX = "-0.5";
+    const char* centreY = "0";
+    double zoom = 1.0;
+    int width = 0;
+    int height = 0;
+    int maxIterations = 0;
+    bool autoIterations = false;
+    const char* bookmarkFile = nullptr;
+    int bookmarkSlot = 0;
+    int bandHeight = HeadlessRenderer::DEFAULT_BAND_HEIGHT;
+    std::string palette = "rainbow";
+    bool trace = false;
+    bool series = true;
+    int antialiasing = 1;
+    float edgeThreshold = EdgeSamples::DEFAULT_THRESHOLD;
+    const char* cacheDirectory = nullptr;
+    const char* output = nullptr;
+    bool sequence = false;
+    double endZoom = 0.0;
+    int framesPerOctave = HeadlessRenderer::DEFAULT_FRAMES_PER_OCTAVE;
+    bool benchmark = false;
+    int frames = Benchmark::DEFAULT_FRAMES;
+    std::vector<int> threadCounts;
+    bool comparison = false;
+    double tolerance = Comparison::DEFAULT_TOLERANCE;
+    bool coordinator = false;
+    int port = RenderProtocol::DEFAULT_PORT;
+    double leaseSeconds = Coordinator::DEFAULT_LEASE_SECONDS;
+    double memoryMegabytes = static_cast<double>(Coordinator::DEFAULT_MEMORY_BUDGET_BYTES >> 20);
+    const char* workerHost = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const int remaining = argc - i - 1;
+
+        if (strcmp(argv[i], "--centre") == 0 && remaining >= 2)
+        {
+            centreX = argv[++i];
+            centreY = argv[++i];
+        }
+        else if (strcmp(argv[i], "--zoom") == 0 && remaining >= 1)
+            zoom = atof(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && remaining >= 2)
+        {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--iterations") == 0 && remaining >= 1)
+        {
+            autoIterations = strcmp(argv[++i], "auto") == 0;
+            maxIterations = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "--bookmark") == 0 && remaining >= 2)
+        {
+            bookmarkFile = argv[++i];
+            bookmarkSlot = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--band") == 0 && remaining >= 1)
+            bandHeight = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--palette") == 0 && remaining >= 1)
+            palette = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0)
+            trace = true;
+        else if (strcmp(argv[i], "--no-series") == 0)
+            series = false;
+        else if (strcmp(argv[i], "--antialias") == 0 && remaining >= 1)
+            antialiasing = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--edge-threshold") == 0 && remaining >= 1)
+            edgeThreshold = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--cache") == 0 && remaining >= 1)
+            cacheDirectory = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && remaining >= 1)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--sequence") == 0 && remaining >= 1)
+        {
+            sequence = true;
+            endZoom = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--frames-per-octave") == 0 && remaining >= 1)
+            framesPerOctave = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--benchmark") == 0)
+            benchmark = true;
+        else if (strcmp(argv[i], "--frames") == 0 && remaining >= 1)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && remaining >= 1)
+        {
+            for (const char* count = argv[++i]; count != nullptr; count = strchr(count, ','))
+            {
+                if (*count == ',')
+                    ++count;
+
+                threadCounts.push_back(atoi(count));
+            }
+        }
+        else if (strcmp(argv[i], "--compare") == 0)
+            comparison = true;
+        else if (strcmp(argv[i], "--tolerance") == 0 && remaining >= 1)
+            tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--coordinator") == 0 && remaining >= 1)
+        {
+            coordinator = true;
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lease") == 0 && remaining >= 1)
+            leaseSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--memory") == 0 && remaining >= 1)
+            memoryMegabytes = atof(argv[++i]);
+        else if (strcmp(argv[i], "--worker") == 0 && remaining >= 2)
+        {
+            workerHost = argv[++i];
+            port = atoi(argv[++i]);
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (workerHost != nullptr)
+    {
+        if (port <= 0 || port > 65535)
+        {
+            printUsage();
+            return 1;
+        }
+
+        return Worker().run(workerHost, static_cast<unsigned short>(port)) ? 0 : 1;
+    }
+
+    // The bookmark is rendered as it was seen unless told otherwise
+    View bookmarked;
+    if (bookmarkFile != nullptr)
+    {
+        int bookmarkedIterations;
+        if (!Bookmarks(bookmarkFile).get(bookmarkSlot, bookmarked, bookmarkedIterations))
+        {
+            std::cerr << "No bookmark " << bookmarkSlot << " in " << bookmarkFile << std::endl;
+            return 1;
+        }
+
+        if (width == 0 && height == 0)
+        {
+            width = bookmarked.getScreenSize().x;
+            height = bookmarked.getScreenSize().y;
+        }
+
+        if (maxIterations <= 0 && !autoIterations)
+        {
+            autoIterations = bookmarkedIterations == MandelbrotEngine::AUTO_ITERATIONS;
+            maxIterations = bookmarkedIterations;
+        }
+
+        zoom = static_cast<double>(bookmarked.getZoom());
+    }
+
+    if (width == 0 && height == 0)
+    {
+        width = benchmark ? Benchmark::DEFAULT_WIDTH : comparison ? Comparison::DEFAULT_WIDTH : 1920;
+        height = benchmark ? Benchmark::DEFAULT_HEIGHT : comparison ? Comparison::DEFAULT_HEIGHT : 1080;
+    }
+
+    if (output == nullptr)
+        output = benchmark || comparison ? "-" : "mandelbrot.ppm";
+
+    if (width <= 0 || height <= 0 || antialiasing < 1 || antialiasing > EdgeSamples::MAX_GRID_SIZE ||
+        std::any_of(threadCounts.begin(), threadCounts.end(), [](int count) { return count <= 0; }) ||
+        tolerance < 0.0 ||
+        (coordinator && (port <= 0 || port > 65535 || leaseSeconds <= 0.0 || memoryMegabytes < 0.0 || sequence || antialiasing > 1)))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (benchmark)
+    {
+        if (threadCounts.empty())
+            threadCounts = Benchmark::defaultThreadCounts();
+
+        const bool toFile = strcmp(output, "-") != 0;
+        std::ofstream file;
+        if (toFile)
+            file.open(output);
+
+        std::ostream& out = toFile ? file : std::cout;
+        Benchmark(width, height, frames).run(out, threadCounts);
+
+        if (!out.good())
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (comparison)
+    {
+        const bool toFile = strcmp(output, "-") != 0;
+        std::ofstream file;
+        if (toFile)
+            file.open(output);
+
+        std::ostream& out = toFile ? file : std::cout;
+        const bool isWithinTolerance = Comparison(width, height).run(out, tolerance);
+
+        if (!out.good())
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+
+        // Fails like a test, so it can gate a build
+        return isWithinTolerance ? 0 : 2;
+    }
+
+    const Complex centre = bookmarkFile != nullptr ? bookmarked.getCentre() :
+        Complex(HeadlessRenderer::parseReal(centreX), HeadlessRenderer::parseReal(centreY));
+    View view = HeadlessRenderer::makeView(centre, zoom, width, height);
+
+    // A bookmark keeps its exact scale, rather than one derived from its zoom
+    if (bookmarkFile != nullptr)
+        view.jumpTo(bookmarked);
+
+    // A sequence uses one iteration limit, enough for its deepest frame
+    if (autoIterations)
+    {
+        static const std::atomic<bool> NEVER_CANCELLING(false);
+        View deepest = view;
+        if (sequence)
+            deepest.zoomTo(endZoom);
+        maxIterations = MandelbrotEngine().estimateMaxIterations(deepest, MandelbrotEngine::defaultMaxIterations(deepest),
+                                                                 NEVER_CANCELLING);
+        std::cerr << "Iteration limit " << maxIterations << std::endl;
+    }
+    else if (maxIterations <= 0)
+    {
+        maxIterations = MandelbrotEngine::defaultMaxIterations(sequence ? View(0.0, 0.0, endZoom) : view);
+    }
+
+    const Palette::Style style = palette == "fire" ? Palette::Style::Fire :
+                                 palette == "greyscale" ? Palette::Style::Greyscale :
+                                 Palette::Style::Rainbow;
+
+    std::cerr << view << std::endl;
+
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+
+    if (strcmp(output, "-") == 0)
+    {
+#ifdef _WIN32
+        // Frames are binary, so line endings must not be translated
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+    else
+    {
+        file.open(output, std::ios::binary);
+        out = &file;
+    }
+
+    if (coordinator)
+    {
+        const std::string spillPath = strcmp(output, "-") == 0 ? "MandelbrotHeadless.strips" : std::string(output) + ".strips";
+        Coordinator distributed(view, maxIterations, leaseSeconds,
+                                static_cast<size_t>(memoryMegabytes * (1 << 20)), spillPath);
+        distributed.getEngine().setBoundaryTracingIsEnabled(trace);
+        distributed.getEngine().setSeriesApproximationIsEnabled(series);
+
+        while (distributed.getPalette().getStyle() != style)
+            distributed.getPalette().nextStyle();
+
+        if (!distributed.renderStill(*out, static_cast<unsigned short>(port)))
+        {
+            std::cerr << "Could not write " << output << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    HeadlessRenderer renderer(view, maxIterations, bandHeight);
+    renderer.getEngine().setBoundaryTracingIsEnabled(trace);
+    renderer.getEngine().setSeriesApproximationIsEnabled(series);
+    renderer.setAntialiasing(antialiasing, edgeThreshold);
+
+    std::unique_ptr<TileCache> cache;
+    if (cacheDirectory != nullptr)
+    {
+        cache.reset(new TileCache(cacheDirectory));
+        renderer.getEngine().setTileCache(cache.get());
+    }
+
+    while (renderer.getPalette().getStyle() != style)
+        renderer.getPalette().nextStyle();
+
+    const bool written = sequence ? renderer.renderSequence(*out, centre, endZoom, framesPerOctave)
+                                  : renderer.renderStill(*out);
+
+    if (!written)
+    {
+        std::cerr << "Could not write " << output << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "RenderProtocol.hpp"
+#include <algorithm>
+
+
+/// <summary>
+/// The number of strips an image is leased in.
+/// </summary>
+/// <param name="height">The height of the image</param>
+/// <param name="stripHeight">The rows in each strip but the last</param>
+/// <returns>The number of strips</returns>
+int RenderProtocol::countStrips(int height, int stripHeight)
+{
+    return (height + stripHeight - 1) / stripHeight;
+}
+
+/// <summary>
+/// The pixels of the view which a strip covers, the last strip being
+/// shorter if the height is not a multiple of the strip height.
+/// </summary>
+/// <param name="view">The view being rendered</param>
+/// <param name="stripHeight">The rows in each strip but the last</param>
+/// <param name="strip">The number of the strip, from the top</param>
+/// <returns>The rows of the strip, the full width of the view</returns>
+PixelRect RenderProtocol::stripBounds(const View& view, int stripHeight, int strip)
+{
+    const int top = strip * stripHeight;
+    return PixelRect(0, top, view.getScreenSize().x, std::min(stripHeight, view.getScreenSize().y - top));
+}
+
+
+/// <summary>
+/// Writes the job a worker renders strips of. The view is written with
+/// every digit, so workers render exactly the pixels the coordinator would,
+/// and the reference orbit is sent with it, so it is only iterated at full
+/// precision once however many workers there are.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+/// <param name="job">The job</param>
+void RenderProtocol::writeJob(sf::Packet& packet, const Job& job)
+{
+    packet << static_cast<sf::Uint8>(Message::Job) << VERSION << job.view.serialise()
+           << static_cast<sf::Int32>(job.maxIterations) << static_cast<sf::Int32>(job.stripHeight)
+           << job.boundaryTracingIsEnabled << job.seriesApproximationIsEnabled
+           << static_cast<sf::Uint32>(job.orbit.size());
+
+    for (const DeltaComplex& z : job.orbit)
+        packet << z.x << z.y;
+}
+
+/// <summary>
+/// Writes a lease of a strip to a worker.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+/// <param name="strip">The number of the strip to render</param>
+void RenderProtocol::writeLease(sf::Packet& packet, int strip)
+{
+    packet << static_cast<sf::Uint8>(Message::Lease) << static_cast<sf::Int32>(strip);
+}
+
+/// <summary>
+/// Writes a rendered strip, run length encoded like the tile cache, as most
+/// rows are long runs of the same count, such as the interior of the set.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+/// <param name="strip">The number of the strip</param>
+/// <param name="iterations">The iteration counts of the strip, row by row</param>
+/// <param name="count">The number of counts</param>
+void RenderProtocol::writeResult(sf::Packet& packet, int strip, const float* iterations, int count)
+{
+    std::vector<std::pair<sf::Uint32, float>> runs;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!runs.empty() && runs.back().second == iterations[i])
+            ++runs.back().first;
+        else
+            runs.push_back(std::make_pair(1u, iterations[i]));
+    }
+
+    packet << static_cast<sf::Uint8>(Message::Result) << static_cast<sf::Int32>(strip)
+           << static_cast<sf::Uint32>(count) << static_cast<sf::Uint32>(runs.size());
+
+    for (const auto& run : runs)
+        packet << run.first << run.second;
+}
+
+/// <summary>
+/// Writes the message telling a worker there is nothing left to render.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+void RenderProtocol::writeFinished(sf::Packet& packet)
+{
+    packet << static_cast<sf::Uint8>(Message::Finished);
+}
+
+/// <summary>
+/// Writes the message telling the coordinator a worker has begun a strip,
+/// so the time of its lease runs from then rather than while it waited.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+/// <param name="strip">The number of the strip begun</param>
+void RenderProtocol::writeStarted(sf::Packet& packet, int strip)
+{
+    packet << static_cast<sf::Uint8>(Message::Started) << static_cast<sf::Int32>(strip);
+}
+
+/// <summary>
+/// Writes the message taking back a strip leased to a worker, which it
+/// should not begin, as another worker has it or has finished it.
+/// </summary>
+/// <param name="packet">The packet to write to</param>
+/// <param name="strip">The number of the strip taken back</param>
+void RenderProtocol::writeRevoke(sf::Packet& packet, int strip)
+{
+    packet << static_cast<sf::Uint8>(Message::Revoke) << static_cast<sf::Int32>(strip);
+}
+
+
+/// <summary>
+/// Reads which message a packet holds, ready for the matching read function.
+/// </summary>
+/// <param name="packet">The packet received</param>
+/// <param name="message">Set to the kind of message</param>
+/// <returns>True if the packet holds a known message</returns>
+bool RenderProtocol::readMessage(sf::Packet& packet, Message& message)
+{
+    sf::Uint8 type;
+    if (!(packet >> type) || type > static_cast<sf::Uint8>(Message::Revoke))
+        return false;
+
+    message = static_cast<Message>(type);
+    return true;
+}
+
+/// <summary>
+/// Reads a job written by writeJob(), after its message type.
+/// </summary>
+/// <param name="packet">The packet received</param>
+/// <param name="job">Set to the job</param>
+/// <returns>True if the job was valid and from the same version</returns>
+bool RenderProtocol::readJob(sf::Packet& packet, Job& job)
+{
+    sf::Uint32 version;
+    std::string view;
+    sf::Int32 maxIterations;
+    sf::Int32 stripHeight;
+    sf::Uint32 orbitLength;
+
+    if (!(packet >> version >> view >> maxIterations >> stripHeight >> job.boundaryTracingIsEnabled
+                 >> job.seriesApproximationIsEnabled >> orbitLength) ||
+        version != VERSION || maxIterations <= 0 || stripHeight <= 0 || !job.view.deserialise(view))
+        return false;
+
+    job.maxIterations = maxIterations;
+    job.stripHeight = stripHeight;
+    job.orbit.clear();
+
+    // Each point is two doubles, so a short packet cannot claim a long orbit
+    if (orbitLength > (packet.getDataSize() / (2 * sizeof(double))))
+        return false;
+
+    job.orbit.reserve(orbitLength);
+    for (sf::Uint32 i = 0; i < orbitLength; ++i)
+    {
+        DeltaComplex z;
+        packet >> z.x >> z.y;
+        job.orbit.push_back(z);
+    }
+
+    return static_cast<bool>(packet);
+}
+
+/// <summary>
+/// Reads the strip of a message written by writeLease(), writeStarted() or
+/// writeRevoke(), after its message type.
+/// </summary>
+/// <param name="packet">The packet received</param>
+/// <param name="strip">Set to the number of the strip</param>
+/// <returns>True if the strip was valid</returns>
+bool RenderProtocol::readStrip(sf::Packet& packet, int& strip)
+{
+    sf::Int32 number;
+    if (!(packet >> number) || number < 0)
+        return false;
+
+    strip = number;
+    return true;
+}
+
+/// <summary>
+/// Reads and decodes a result written by writeResult(), after its message
+/// type.
+/// </summary>
+/// <param name="packet">The packet received</param>
+/// <param name="strip">Set to the number of the strip</param>
+/// <param name="iterations">Set to the iteration counts of the strip</param>
+/// <returns>True if the result was valid and its runs add up to its size</returns>
+bool RenderProtocol::readResult(sf::Packet& packet, int& strip, std::vector<float>& iterations)
+{
+    sf::Int32 number;
+    sf::Uint32 count;
+    sf::Uint32 runCount;
+
+    if (!(packet >> number >> count >> runCount) || number < 0)
+        return false;
+
+    strip = number;
+    iterations.clear();
+
+    for (sf::Uint32 i = 0; i < runCount; ++i)
+    {
+        sf::Uint32 length;
+        float value;
+        if (!(packet >> length >> value) || length > count - iterations.size())
+            return false;
+
+        iterations.insert(iterations.end(), length, value);
+    }
+
+    return iterations.size() == count;
+}
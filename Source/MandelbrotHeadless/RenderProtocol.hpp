@@ -0,0 +1,48 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include "View.hpp"
+#include "ReferenceOrbit.hpp"
+
+class RenderProtocol
+{
+public:
+    static constexpr unsigned short DEFAULT_PORT = 45271;
+    static constexpr sf::Uint32 VERSION = 2;
+
+    enum class Message : sf::Uint8
+    {
+        Job,
+        Lease,
+        Result,
+        Finished,
+        Started,
+        Revoke
+    };
+
+    struct Job
+    {
+        View view;
+        int maxIterations;
+        int stripHeight;
+        bool boundaryTracingIsEnabled;
+        bool seriesApproximationIsEnabled;
+        std::vector<DeltaComplex> orbit;
+    };
+
+    static int countStrips(int height, int stripHeight);
+    static PixelRect stripBounds(const View& view, int stripHeight, int strip);
+
+    static void writeJob(sf::Packet& packet, const Job& job);
+    static void writeLease(sf::Packet& packet, int strip);
+    static void writeResult(sf::Packet& packet, int strip, const float* iterations, int count);
+    static void writeFinished(sf::Packet& packet);
+    static void writeStarted(sf::Packet& packet, int strip);
+    static void writeRevoke(sf::Packet& packet, int strip);
+
+    static bool readMessage(sf::Packet& packet, Message& message);
+    static bool readJob(sf::Packet& packet, Job& job);
+    static bool readStrip(sf::Packet& packet, int& strip);
+    static bool readResult(sf::Packet& packet, int& strip, std::vector<float>& iterations);
+};
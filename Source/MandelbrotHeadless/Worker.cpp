@@ -0,0 +1,202 @@
+#include "Worker.hpp"
+#include <algorithm>
+#include <iostream>
+
+
+/// <summary>
+/// Renders strips of a still for a Coordinator on another machine, or the
+/// same one, until it has no more to give out.
+/// </summary>
+Worker::Worker() {}
+
+/// <summary>
+/// Destructor
+/// </summary>
+Worker::~Worker() {}
+
+
+/// <summary>
+/// Getter for engine.
+/// </summary>
+/// <returns>The engine which renders the strips</returns>
+MandelbrotEngine& Worker::getEngine() { return m_engine; }
+
+
+/// <summary>
+/// Connects to a coordinator and renders the strips it leases, one at a
+/// time with every thread, until it says the image is finished. The
+/// messages waiting are read before each strip, so strips the coordinator
+/// has taken back are not rendered.
+/// </summary>
+/// <param name="host">The name or address of the coordinator's machine</param>
+/// <param name="port">The port the coordinator listens on</param>
+/// <returns>True if the coordinator finished the image</returns>
+bool Worker::run(const std::string& host, unsigned short port)
+{
+    if (!connect(host, port) || !receiveJob())
+        return false;
+
+    m_leases.clear();
+    m_isFinished = false;
+
+    while (receiveMessages())
+    {
+        if (m_isFinished)
+            return true;
+
+        if (m_leases.empty())
+            continue;
+
+        const int strip = m_leases.front();
+        m_leases.pop_front();
+
+        if (!renderStrip(strip))
+            break;
+    }
+
+    std::cerr << "Lost the connection to the coordinator" << std::endl;
+    return false;
+}
+
+
+/// <summary>
+/// Connects to the coordinator, retrying for a while, so that workers can be
+/// started before it.
+/// </summary>
+/// <param name="host">The name or address of the coordinator's machine</param>
+/// <param name="port">The port the coordinator listens on</param>
+/// <returns>True if connected</returns>
+bool Worker::connect(const std::string& host, unsigned short port)
+{
+    const sf::IpAddress address(host);
+
+    for (int attempt = 0; attempt < CONNECT_ATTEMPTS; ++attempt)
+    {
+        if (m_socket.connect(address, port) == sf::Socket::Done)
+        {
+            std::cerr << "Connected to " << host << ":" << port << std::endl;
+            return true;
+        }
+
+        sf::sleep(sf::seconds(CONNECT_RETRY_SECONDS));
+    }
+
+    std::cerr << "Could not connect to " << host << ":" << port << std::endl;
+    return false;
+}
+
+
+/// <summary>
+/// Receives the job and prepares the engine for it, using the coordinator's
+/// reference orbit rather than iterating another.
+/// </summary>
+/// <returns>True if a valid job was received</returns>
+bool Worker::receiveJob()
+{
+    sf::Packet packet;
+    RenderProtocol::Message message;
+
+    if (m_socket.receive(packet) != sf::Socket::Done || !RenderProtocol::readMessage(packet, message) ||
+        message != RenderProtocol::Message::Job || !RenderProtocol::readJob(packet, m_job))
+    {
+        std::cerr << "The coordinator did not send a job this version can render" << std::endl;
+        return false;
+    }
+
+    m_engine.setBoundaryTracingIsEnabled(m_job.boundaryTracingIsEnabled);
+    m_engine.setSeriesApproximationIsEnabled(m_job.seriesApproximationIsEnabled);
+
+    if (m_job.orbit.empty())
+        m_engine.setReferenceIsLocked(false);
+    else
+        m_engine.setReferenceOrbit(m_job.view.getCentre(), m_job.orbit);
+
+    m_engine.prepare(m_job.view, m_job.maxIterations);
+    std::cerr << m_job.view << std::endl;
+    return true;
+}
+
+
+/// <summary>
+/// Receives every message the coordinator has sent, waiting for one if no
+/// strips are leased, adding the strips leased and removing those revoked.
+/// </summary>
+/// <returns>False if the connection was lost or a message was invalid</returns>
+bool Worker::receiveMessages()
+{
+    const int stripCount = RenderProtocol::countStrips(m_job.view.getScreenSize().y, m_job.stripHeight);
+    bool isValid = true;
+
+    // Only wait when there is nothing else to do
+    m_socket.setBlocking(m_leases.empty());
+
+    while (!m_isFinished)
+    {
+        sf::Packet packet;
+        RenderProtocol::Message message;
+        int strip;
+
+        const sf::Socket::Status status = m_socket.receive(packet);
+        if (status == sf::Socket::NotReady || status == sf::Socket::Partial)
+            break;
+
+        if (status != sf::Socket::Done || !RenderProtocol::readMessage(packet, message))
+        {
+            isValid = false;
+            break;
+        }
+
+        if (message == RenderProtocol::Message::Finished)
+        {
+            m_isFinished = true;
+        }
+        else if ((message == RenderProtocol::Message::Lease || message == RenderProtocol::Message::Revoke) &&
+                 RenderProtocol::readStrip(packet, strip) && strip < stripCount)
+        {
+            if (message == RenderProtocol::Message::Lease)
+                m_leases.push_back(strip);
+            else
+                m_leases.erase(std::remove(m_leases.begin(), m_leases.end(), strip), m_leases.end());
+        }
+        else
+        {
+            isValid = false;
+            break;
+        }
+
+        m_socket.setBlocking(false);
+    }
+
+    m_socket.setBlocking(true);
+    return isValid;
+}
+
+
+/// <summary>
+/// Renders a strip and sends it back, telling the coordinator when it
+/// begins, so its lease only runs while it is being rendered.
+/// </summary>
+/// <param name="strip">The number of the strip</param>
+/// <returns>False if the result could not be sent</returns>
+bool Worker::renderStrip(int strip)
+{
+    static const std::atomic<bool> NEVER_CANCELLING(false);
+
+    sf::Packet started;
+    RenderProtocol::writeStarted(started, strip);
+    if (m_socket.send(started) != sf::Socket::Done)
+        return false;
+
+    const PixelRect bounds = RenderProtocol::stripBounds(m_job.view, m_job.stripHeight, strip);
+    const int count = bounds.width * bounds.height;
+
+    // Boundary tracing only iterates pixels which have not been rendered
+    m_iterations.assign(count, MandelbrotEngine::UNRENDERED);
+    m_engine.setTarget(m_iterations.data(), bounds);
+    m_engine.render(std::vector<PixelRect>(1, bounds), Pixel(bounds.left + bounds.width / 2, bounds.top + bounds.height / 2),
+                    1, NEVER_CANCELLING, [](const PixelRect&) {});
+
+    sf::Packet packet;
+    RenderProtocol::writeResult(packet, strip, m_iterations.data(), count);
+    return m_socket.send(packet) == sf::Socket::Done;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+#include "MandelbrotEngine.hpp"
+#include "RenderProtocol.hpp"
+
+class Worker
+{
+public:
+    static constexpr int CONNECT_ATTEMPTS = 30;
+    static constexpr float CONNECT_RETRY_SECONDS = 1.0f;
+
+    Worker();
+    ~Worker();
+
+    MandelbrotEngine& getEngine();
+    bool run(const std::string& host, unsigned short port);
+
+private:
+    sf::TcpSocket m_socket;
+    MandelbrotEngine m_engine;
+    RenderProtocol::Job m_job;
+    std::vector<float> m_iterations;
+    std::deque<int> m_leases;
+    bool m_isFinished = false;
+
+    bool connect(const std::string& host, unsigned short port);
+    bool receiveJob();
+    bool receiveMessages();
+    bool renderStrip(int strip);
+};